@@ -0,0 +1,24 @@
+#include "allocation-count.h"
+
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+namespace {
+    std::atomic<uint64_t> Allocations = 0;
+}
+
+uint64_t Encore::AllocationCount() { return Allocations.load(std::memory_order_relaxed); }
+
+// The array and nothrow forms all end up here
+void *operator new(std::size_t size) {
+    Allocations.fetch_add(1, std::memory_order_relaxed);
+    if (void *ptr = std::malloc(size ? size : 1)) {
+        return ptr;
+    }
+    throw std::bad_alloc();
+}
+
+void operator delete(void *ptr) noexcept { std::free(ptr); }
+
+void operator delete(void *ptr, std::size_t) noexcept { std::free(ptr); }
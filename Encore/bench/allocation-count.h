@@ -0,0 +1,9 @@
+#pragma once
+
+#include <cstdint>
+
+namespace Encore {
+    /// How many times operator new has been called so far, on any thread. EncoreBench
+    /// replaces the global operator new to count them.
+    uint64_t AllocationCount();
+}
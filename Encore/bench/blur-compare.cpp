@@ -0,0 +1,82 @@
+#include "blur-compare.h"
+
+#include "raylib.h"
+#include "song/artcache.h"
+#include "util/image-blur.h"
+
+#include <cstdarg>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+
+namespace {
+    std::string Format(const char *format, ...) {
+        char buffer[256];
+        va_list args;
+        va_start(args, format);
+        vsnprintf(buffer, sizeof(buffer), format, args);
+        va_end(args);
+        return buffer;
+    }
+
+    // raylib runs its box blur four times, so nothing further in than this sees an edge
+    constexpr int EdgeMargin = 4 * ALBUM_ART_BLUR_RADIUS;
+}
+
+std::vector<uint8_t> Encore::MakeBlurTestImage(int width, int height) {
+    std::mt19937 rng((uint32_t)(width * 31 + height));
+    std::vector<uint8_t> pixels((size_t)width * height * 4);
+    for (int y = 0; y < height; y++) {
+        for (int x = 0; x < width; x++) {
+            uint8_t *pixel = &pixels[((size_t)y * width + x) * 4];
+            for (int channel = 0; channel < 3; channel++) {
+                pixel[channel] =
+                    (uint8_t)(((x * 3 + y * 5 * (channel + 1)) % 256) ^ (rng() & 15));
+            }
+            pixel[3] = 255;
+        }
+    }
+    return pixels;
+}
+
+std::string Encore::CompareBlurWithRaylib(int width, int height) {
+    std::vector<uint8_t> original = MakeBlurTestImage(width, height);
+    float sigma = GaussianSigmaForBlurSize(ALBUM_ART_BLUR_RADIUS);
+    std::vector<uint8_t> simd = original;
+    std::vector<uint8_t> scalar = original;
+    BlurRGBA8(simd.data(), width, height, sigma);
+    BlurRGBA8Scalar(scalar.data(), width, height, sigma);
+    for (size_t i = 0; i < simd.size(); i++) {
+        if (simd[i] != scalar[i]) {
+            return Format(
+                "BlurRGBA8 gives %i at pixel %zu channel %zu, scalar gives %i",
+                simd[i], i / 4, i % 4, scalar[i]
+            );
+        }
+    }
+
+    // ImageBlurGaussian replaces image.data, so it has to start out as raylib's own
+    Image source { original.data(), width, height, 1, PIXELFORMAT_UNCOMPRESSED_R8G8B8A8 };
+    Image raylibBlur = ImageCopy(source);
+    ImageBlurGaussian(&raylibBlur, ALBUM_ART_BLUR_RADIUS);
+    const uint8_t *reference = (const uint8_t *)raylibBlur.data;
+    std::string problem;
+    for (int y = EdgeMargin; y < height - EdgeMargin && problem.empty(); y++) {
+        for (int x = EdgeMargin; x < width - EdgeMargin && problem.empty(); x++) {
+            size_t pixel = ((size_t)y * width + x) * 4;
+            for (int channel = 0; channel < 4; channel++) {
+                int ours = simd[pixel + channel];
+                int theirs = reference[pixel + channel];
+                if (std::abs(ours - theirs) > MaxBlurDifference) {
+                    problem = Format(
+                        "BlurRGBA8 gives %i at (%i, %i) channel %i, raylib gives %i",
+                        ours, x, y, channel, theirs
+                    );
+                    break;
+                }
+            }
+        }
+    }
+    UnloadImage(raylibBlur);
+    return problem;
+}
@@ -0,0 +1,23 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace Encore {
+    /// An opaque width x height RGBA8 image of gradients with some noise on top, roughly
+    /// what a scaled down cover looks like to a blur. The same size always gives the
+    /// same pixels.
+    std::vector<uint8_t> MakeBlurTestImage(int width, int height);
+
+    /// Blurs a MakeBlurTestImage() the way the album art cache does, with BlurRGBA8,
+    /// BlurRGBA8Scalar and raylib's ImageBlurGaussian, and checks the SIMD result is
+    /// identical to the scalar one and, further than any blur reaches from the edges,
+    /// within MaxBlurDifference levels of raylib's. Returns the first difference, or an
+    /// empty string if there isn't one.
+    std::string CompareBlurWithRaylib(int width, int height);
+
+    /// Levels BlurRGBA8 may differ from raylib's blur by. The two handle the image edges
+    /// differently, so only pixels neither blur reaches an edge from are held to it.
+    constexpr int MaxBlurDifference = 2;
+}
@@ -0,0 +1,579 @@
+// Times song library startup against generated libraries:
+//
+//   EncoreBench [--songs 1000,10000,100000] [--runs 5] [--extras 10] [--dir path]
+//               [--keep] [--verbose] [--chart-notes 5000,20000] [--midi path]...
+//               [--midi-stress 20] [--blur 512,1024] [--info 1000]
+//
+// For each size it reports p50/p95 of a full ScanSongs, of LoadCache with a cache that
+// is missing the last few percent of songs (the extras scan), of LoadCache with a warm
+// cache, and of building the ordering for every SortType, then the peak RSS. On Linux
+// the peak is reset between sizes; elsewhere it covers everything run so far, so pass
+// one size at a time to compare memory.
+//
+// --chart-notes times Chart::parse() instead, on generated expert charts with that many
+// chords per part, for pad and classic drums and guitar, with the heap allocations one
+// parse makes. It also reads each generated chart as --midi does. Add --songs to run both.
+//
+// --midi reads a MIDI file, or every .mid under a directory, with midifile and with
+// SmfFile, fails if they disagree anywhere (see CompareWithMidifile), and times reading
+// the whole set both ways. midifile's time is with its tempo map, which SmfFile always
+// builds. --midi-stress does the same on that many generated files heavy with meta and
+// sysex bytes (see WriteStressMidi).
+//
+// --blur times BlurRGBA8, its scalar path and raylib's ImageBlurGaussian on generated
+// square images of each size, at the album art blur radius. It fails if the SIMD and
+// scalar results differ at all, or if BlurRGBA8 strays from raylib by more than
+// MaxBlurDifference away from the edges (see CompareBlurWithRaylib).
+//
+// --info times Song::LoadSong on the info.json of that many generated songs (the
+// song.ini ones are skipped), file read and hash included, and reports it per song. The
+// folders are listed before the clock starts.
+
+#include "song/artcache.h"
+#include "song/chart.h"
+#include "song/songlist.h"
+#include "allocation-count.h"
+#include "blur-compare.h"
+#include "midi-compare.h"
+#include "midifile/MidiFile.h"
+#include "peak-rss.h"
+#include "synthetic-library.h"
+#include "util/image-blur.h"
+
+#include <algorithm>
+#include <cctype>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <iostream>
+#include <string>
+#include <vector>
+
+SongList TheSongList;
+
+namespace {
+    struct BenchOptions {
+        std::vector<int> sizes = { 1000, 10000, 100000 };
+        std::vector<int> chartNotes;
+        std::vector<int> blurSizes;
+        std::vector<int> infoSongs;
+        std::vector<std::filesystem::path> midiPaths;
+        int midiStressFiles = 0;
+        int runs = 5;
+        int extrasPercent = 10;
+        std::filesystem::path dir = std::filesystem::temp_directory_path() / "encore-bench";
+        bool keep = false;
+        bool verbose = false;
+    };
+
+    class NullBuffer : public std::streambuf {
+    protected:
+        int overflow(int c) override { return c; }
+        std::streamsize xsputn(const char *, std::streamsize count) override { return count; }
+    };
+
+    // Keeps the per-song log lines out of the console, and out of the timings, unless
+    // --verbose was given
+    class QuietLogs {
+        NullBuffer null;
+        std::streambuf *out = nullptr;
+        std::streambuf *err = nullptr;
+
+    public:
+        explicit QuietLogs(bool verbose) {
+            if (!verbose) {
+                out = std::cout.rdbuf(&null);
+                err = std::cerr.rdbuf(&null);
+            }
+        }
+        ~QuietLogs() {
+            if (out) {
+                std::cout.rdbuf(out);
+                std::cerr.rdbuf(err);
+            }
+        }
+    };
+
+    double Milliseconds(std::chrono::steady_clock::duration duration) {
+        return std::chrono::duration<double, std::milli>(duration).count();
+    }
+
+    // Nearest rank, so p95 of five runs is the slowest one
+    double Percentile(std::vector<double> samples, double percent) {
+        std::sort(samples.begin(), samples.end());
+        size_t rank = (size_t)std::ceil(percent / 100.0 * samples.size());
+        return samples[std::clamp<size_t>(rank, 1, samples.size()) - 1];
+    }
+
+    void Report(
+        int songs,
+        const std::string &phase,
+        const std::vector<double> &samples,
+        uint64_t allocations = 0
+    ) {
+        printf(
+            "%-8i %-22s %5zu %12.2f %12.2f",
+            songs,
+            phase.c_str(),
+            samples.size(),
+            Percentile(samples, 50),
+            Percentile(samples, 95)
+        );
+        if (allocations) {
+            printf(" %12llu", (unsigned long long)allocations);
+        }
+        printf("\n");
+        fflush(stdout);
+    }
+
+    // Runs prepare() untimed and then body() timed, once per run. Each run gets a fresh
+    // SongList, and waits for its background work so it doesn't bleed into the next.
+    std::vector<double> TimeRuns(
+        const BenchOptions &options,
+        const std::function<void()> &prepare,
+        const std::function<void(SongList &)> &body
+    ) {
+        std::vector<double> samples;
+        for (int run = 0; run < options.runs; run++) {
+            prepare();
+            SongList list;
+            QuietLogs quiet(options.verbose);
+            auto start = std::chrono::steady_clock::now();
+            body(list);
+            samples.push_back(Milliseconds(std::chrono::steady_clock::now() - start));
+            list.WaitForBackgroundWork();
+        }
+        return samples;
+    }
+
+    void ReplaceDirectory(const std::filesystem::path &from, const std::filesystem::path &to) {
+        std::filesystem::remove_all(to);
+        std::filesystem::copy(from, to, std::filesystem::copy_options::recursive);
+    }
+
+    bool BenchSize(const BenchOptions &options, int songs) {
+        std::filesystem::path work = options.dir / std::to_string(songs);
+        std::filesystem::remove_all(work);
+        std::filesystem::create_directories(work);
+        // The cache lives in songCache/ under the working directory, same as the game
+        std::filesystem::current_path(work);
+        std::vector<std::filesystem::path> roots = { work / "songs" };
+        int extras = songs * options.extrasPercent / 100;
+        int cached = songs - extras;
+
+        auto start = std::chrono::steady_clock::now();
+        Encore::WriteSyntheticLibrary(roots[0], 0, cached);
+        {
+            // A cache that only knows the first songs, for the extras scan
+            SongList list;
+            QuietLogs quiet(options.verbose);
+            list.ScanSongs(roots);
+            list.WaitForBackgroundWork();
+        }
+        ReplaceDirectory(SONG_CACHE_DIR, "songCache-partial");
+        Encore::WriteSyntheticLibrary(roots[0], cached, extras);
+        printf(
+            "%-8i %-22s %5i %12.2f\n",
+            songs,
+            "generate (once)",
+            1,
+            Milliseconds(std::chrono::steady_clock::now() - start)
+        );
+        Encore::ResetPeakResident();
+
+        bool countsMatch = true;
+        auto checkCount = [&](SongList &list, const char *phase) {
+            if (list.songCount != songs) {
+                fprintf(stderr, "%s found %i songs, expected %i\n", phase, list.songCount, songs);
+                countsMatch = false;
+            }
+        };
+
+        Report(songs, "ScanSongs", TimeRuns(options, [] {}, [&](SongList &list) {
+            list.ScanSongs(roots);
+            checkCount(list, "ScanSongs");
+        }));
+
+        Report(songs, "LoadCache (extras)", TimeRuns(options, [] {
+            ReplaceDirectory("songCache-partial", SONG_CACHE_DIR);
+        }, [&](SongList &list) {
+            list.LoadCache(roots);
+            checkCount(list, "LoadCache (extras)");
+        }));
+
+        // The extras runs left a journal behind; start the warm runs from a full shard
+        {
+            SongList list;
+            QuietLogs quiet(options.verbose);
+            list.ScanSongs(roots);
+            list.WaitForBackgroundWork();
+        }
+        Report(songs, "LoadCache (warm)", TimeRuns(options, [] {}, [&](SongList &list) {
+            list.LoadCache(roots);
+            checkCount(list, "LoadCache (warm)");
+        }));
+
+        SongList loaded;
+        {
+            QuietLogs quiet(options.verbose);
+            loaded.LoadCache(roots);
+            loaded.WaitForBackgroundWork();
+        }
+        for (int type = (int)SortType::EnumStart; type < (int)SortType::EnumEnd; type++) {
+            std::vector<double> samples;
+            for (int run = 0; run < options.runs; run++) {
+                auto sortStart = std::chrono::steady_clock::now();
+                auto ordering = SongList::BuildOrdering(loaded.catalog, (SortType)type);
+                samples.push_back(Milliseconds(std::chrono::steady_clock::now() - sortStart));
+            }
+            Report(songs, "sortList " + sortTypes[type], samples);
+        }
+
+        printf(
+            "%-8i %-22s %.1f MiB\n\n",
+            songs,
+            "peak RSS",
+            Encore::PeakResidentBytes() / (1024.0 * 1024.0)
+        );
+        fflush(stdout);
+
+        std::filesystem::current_path(options.dir);
+        if (!options.keep) {
+            std::filesystem::remove_all(work);
+        }
+        return countsMatch;
+    }
+
+    // Every .mid under path, or path itself if it's a file
+    std::vector<std::filesystem::path> FindMidis(const std::filesystem::path &path) {
+        std::vector<std::filesystem::path> midis;
+        if (!std::filesystem::is_directory(path)) {
+            midis.push_back(path);
+            return midis;
+        }
+        for (const auto &entry : std::filesystem::recursive_directory_iterator(path)) {
+            std::string extension = entry.path().extension().string();
+            std::transform(extension.begin(), extension.end(), extension.begin(), ::tolower);
+            if (entry.is_regular_file() && extension == ".mid") {
+                midis.push_back(entry.path());
+            }
+        }
+        std::sort(midis.begin(), midis.end());
+        return midis;
+    }
+
+    bool BenchMidi(const BenchOptions &options, const std::vector<std::filesystem::path> &midis) {
+        int count = (int)midis.size();
+        bool matched = true;
+        for (const auto &path : midis) {
+            std::string problem = Encore::CompareWithMidifile(path);
+            if (!problem.empty()) {
+                fprintf(stderr, "%s: %s\n", path.string().c_str(), problem.c_str());
+                matched = false;
+            }
+        }
+
+        // Alternating runs, so anything else slowing the machine down hits both
+        std::vector<double> midifileSamples;
+        std::vector<double> smfSamples;
+        std::vector<double> partialSamples;
+        for (int run = 0; run < options.runs; run++) {
+            QuietLogs quiet(options.verbose);
+            auto start = std::chrono::steady_clock::now();
+            for (const auto &path : midis) {
+                smf::MidiFile midiFile;
+                midiFile.read(path.string());
+                midiFile.getTimeInSeconds(0);
+            }
+            midifileSamples.push_back(Milliseconds(std::chrono::steady_clock::now() - start));
+            start = std::chrono::steady_clock::now();
+            for (const auto &path : midis) {
+                SmfFile midiFile;
+                midiFile.Read(path);
+            }
+            smfSamples.push_back(Milliseconds(std::chrono::steady_clock::now() - start));
+            // The tempo track and one part, like loading a single player's chart
+            start = std::chrono::steady_clock::now();
+            for (const auto &path : midis) {
+                SmfFile midiFile;
+                midiFile.Read(path, [](int track, const std::string &) { return track <= 1; });
+            }
+            partialSamples.push_back(Milliseconds(std::chrono::steady_clock::now() - start));
+        }
+        Report(count, "read midifile", midifileSamples);
+        Report(count, "read SmfFile", smfSamples);
+        Report(count, "read SmfFile 2 tracks", partialSamples);
+        printf(
+            "%-8i %-22s %.1fx%s\n\n",
+            count,
+            "read speedup (p50)",
+            Percentile(midifileSamples, 50) / std::max(Percentile(smfSamples, 50), 1e-6),
+            matched ? "" : ", MISMATCHED"
+        );
+        fflush(stdout);
+        return matched;
+    }
+
+    bool BenchMidiStress(const BenchOptions &options) {
+        std::filesystem::path dir = options.dir / "midi-stress";
+        std::filesystem::remove_all(dir);
+        std::filesystem::create_directories(dir);
+        std::vector<std::filesystem::path> midis;
+        for (int file = 1; file <= options.midiStressFiles; file++) {
+            midis.push_back(dir / ("stress-" + std::to_string(file) + ".mid"));
+            Encore::WriteStressMidi(midis.back(), (uint32_t)file);
+        }
+        bool matched = BenchMidi(options, midis);
+        if (!options.keep) {
+            std::filesystem::remove_all(dir);
+        }
+        return matched;
+    }
+
+    bool BenchCharts(const BenchOptions &options, int notes) {
+        std::filesystem::create_directories(options.dir);
+        std::filesystem::path path = options.dir / ("dense-" + std::to_string(notes) + ".mid");
+        Encore::WriteDenseChart(path, notes);
+        SmfFile midiFile;
+        if (!midiFile.Read(path)) {
+            fprintf(stderr, "%s can't be read\n", path.string().c_str());
+            return false;
+        }
+
+        struct ChartCase {
+            const char *name;
+            int track;
+            int instrument;
+        };
+        const ChartCase cases[] = {
+            { "parse pad drums", 1, PartDrums },
+            { "parse classic drums", 1, PlasticDrums },
+            { "parse pad guitar", 2, PartGuitar },
+            { "parse classic guitar", 2, PlasticGuitar },
+        };
+        bool parsed = true;
+        for (const ChartCase &chartCase : cases) {
+            std::vector<double> samples;
+            uint64_t allocations = 0;
+            for (int run = 0; run < options.runs; run++) {
+                Chart chart;
+                chart.track = chartCase.track;
+                QuietLogs quiet(options.verbose);
+                uint64_t allocationsBefore = Encore::AllocationCount();
+                auto start = std::chrono::steady_clock::now();
+                chart.parse(midiFile, 3, chartCase.instrument, 170, true);
+                samples.push_back(Milliseconds(std::chrono::steady_clock::now() - start));
+                allocations = Encore::AllocationCount() - allocationsBefore;
+                parsed = parsed && !chart.notes.empty();
+            }
+            Report(notes, chartCase.name, samples, allocations);
+        }
+        printf("\n");
+        parsed = BenchMidi(options, { path }) && parsed;
+        if (!options.keep) {
+            std::filesystem::remove(path);
+        }
+        return parsed;
+    }
+
+    bool BenchBlur(const BenchOptions &options, int size) {
+        std::string problem = Encore::CompareBlurWithRaylib(size, size);
+        if (!problem.empty()) {
+            fprintf(stderr, "%ix%i blur: %s\n", size, size, problem.c_str());
+        }
+
+        std::vector<uint8_t> original = Encore::MakeBlurTestImage(size, size);
+        Image source { original.data(), size, size, 1, PIXELFORMAT_UNCOMPRESSED_R8G8B8A8 };
+        float sigma = Encore::GaussianSigmaForBlurSize(ALBUM_ART_BLUR_RADIUS);
+        std::vector<double> simdSamples;
+        std::vector<double> scalarSamples;
+        std::vector<double> raylibSamples;
+        for (int run = 0; run < options.runs; run++) {
+            std::vector<uint8_t> pixels = original;
+            auto start = std::chrono::steady_clock::now();
+            Encore::BlurRGBA8(pixels.data(), size, size, sigma);
+            simdSamples.push_back(Milliseconds(std::chrono::steady_clock::now() - start));
+            pixels = original;
+            start = std::chrono::steady_clock::now();
+            Encore::BlurRGBA8Scalar(pixels.data(), size, size, sigma);
+            scalarSamples.push_back(Milliseconds(std::chrono::steady_clock::now() - start));
+            Image image = ImageCopy(source);
+            start = std::chrono::steady_clock::now();
+            ImageBlurGaussian(&image, ALBUM_ART_BLUR_RADIUS);
+            raylibSamples.push_back(Milliseconds(std::chrono::steady_clock::now() - start));
+            UnloadImage(image);
+        }
+        Report(size, std::string("blur BlurRGBA8 ") + Encore::BlurRGBA8Path(), simdSamples);
+        Report(size, "blur scalar", scalarSamples);
+        Report(size, "blur ImageBlurGaussian", raylibSamples);
+        printf(
+            "%-8i %-22s %.1fx%s\n\n",
+            size,
+            "blur speedup (p50)",
+            Percentile(raylibSamples, 50) / std::max(Percentile(simdSamples, 50), 1e-6),
+            problem.empty() ? "" : ", MISMATCHED"
+        );
+        fflush(stdout);
+        return problem.empty();
+    }
+
+    bool BenchInfo(const BenchOptions &options, int songs) {
+        std::filesystem::path root = options.dir / ("info-" + std::to_string(songs));
+        std::filesystem::remove_all(root);
+        Encore::WriteSyntheticLibrary(root, 0, songs);
+        std::vector<SongFolderSnapshot> folders;
+        for (const auto &entry : std::filesystem::directory_iterator(root)) {
+            if (std::filesystem::exists(entry.path() / "info.json")) {
+                folders.emplace_back(entry.path());
+            }
+        }
+        std::sort(folders.begin(), folders.end(), [](const auto &a, const auto &b) {
+            return a.path() < b.path();
+        });
+
+        int count = (int)folders.size();
+        bool parsed = count > 0;
+        std::vector<double> samples;
+        for (int run = 0; run < options.runs; run++) {
+            QuietLogs quiet(options.verbose);
+            auto start = std::chrono::steady_clock::now();
+            for (const auto &folder : folders) {
+                Song song;
+                song.LoadSong(folder.path() / "info.json", folder);
+                parsed = parsed && !song.title.empty();
+            }
+            samples.push_back(Milliseconds(std::chrono::steady_clock::now() - start));
+        }
+        Report(count, "LoadSong info.json", samples);
+        printf(
+            "%-8i %-22s %.2f us%s\n\n",
+            count,
+            "per song (p50)",
+            Percentile(samples, 50) * 1000.0 / std::max(count, 1),
+            parsed ? "" : ", FAILED"
+        );
+        fflush(stdout);
+        if (!options.keep) {
+            std::filesystem::remove_all(root);
+        }
+        return parsed;
+    }
+
+    std::vector<int> ParseSizes(const std::string &list) {
+        std::vector<int> sizes;
+        size_t pos = 0;
+        while (pos <= list.size()) {
+            size_t comma = list.find(',', pos);
+            if (comma == std::string::npos) {
+                comma = list.size();
+            }
+            int size = std::atoi(list.substr(pos, comma - pos).c_str());
+            if (size > 0) {
+                sizes.push_back(size);
+            }
+            pos = comma + 1;
+        }
+        return sizes;
+    }
+
+    bool ParseArgs(int argc, char **argv, BenchOptions &options) {
+        bool songsGiven = false;
+        for (int i = 1; i < argc; i++) {
+            std::string arg = argv[i];
+            bool hasValue = i + 1 < argc;
+            if (arg == "--songs" && hasValue) {
+                options.sizes = ParseSizes(argv[++i]);
+                songsGiven = true;
+            } else if (arg == "--chart-notes" && hasValue) {
+                options.chartNotes = ParseSizes(argv[++i]);
+                if (options.chartNotes.empty()) {
+                    return false;
+                }
+            } else if (arg == "--blur" && hasValue) {
+                options.blurSizes = ParseSizes(argv[++i]);
+                if (options.blurSizes.empty()) {
+                    return false;
+                }
+            } else if (arg == "--info" && hasValue) {
+                options.infoSongs = ParseSizes(argv[++i]);
+                if (options.infoSongs.empty()) {
+                    return false;
+                }
+            } else if (arg == "--midi" && hasValue) {
+                options.midiPaths.push_back(std::filesystem::absolute(argv[++i]));
+            } else if (arg == "--midi-stress" && hasValue) {
+                options.midiStressFiles = std::atoi(argv[++i]);
+                if (options.midiStressFiles <= 0) {
+                    return false;
+                }
+            } else if (arg == "--runs" && hasValue) {
+                options.runs = std::max(1, std::atoi(argv[++i]));
+            } else if (arg == "--extras" && hasValue) {
+                options.extrasPercent = std::clamp(std::atoi(argv[++i]), 0, 100);
+            } else if (arg == "--dir" && hasValue) {
+                options.dir = std::filesystem::absolute(argv[++i]);
+            } else if (arg == "--keep") {
+                options.keep = true;
+            } else if (arg == "--verbose") {
+                options.verbose = true;
+            } else {
+                return false;
+            }
+        }
+        if ((!options.chartNotes.empty() || !options.midiPaths.empty()
+             || options.midiStressFiles > 0 || !options.blurSizes.empty()
+             || !options.infoSongs.empty())
+            && !songsGiven) {
+            options.sizes.clear();
+            return true;
+        }
+        return !options.sizes.empty();
+    }
+}
+
+int main(int argc, char **argv) {
+    BenchOptions options;
+    if (!ParseArgs(argc, argv, options)) {
+        fprintf(
+            stderr,
+            "usage: %s [--songs 1000,10000,100000] [--runs 5] [--extras 10] [--dir path] "
+            "[--keep] [--verbose] [--chart-notes 5000,20000] [--midi path]... "
+            "[--midi-stress 20] [--blur 512,1024] [--info 1000]\n",
+            argv[0]
+        );
+        return 2;
+    }
+    std::filesystem::create_directories(options.dir);
+
+    printf(
+        "%-8s %-22s %5s %12s %12s %12s\n", "size", "phase", "runs", "p50 ms", "p95 ms", "allocs"
+    );
+    bool ok = true;
+    for (int songs : options.sizes) {
+        ok = BenchSize(options, songs) && ok;
+    }
+    for (int notes : options.chartNotes) {
+        ok = BenchCharts(options, notes) && ok;
+    }
+    if (!options.midiPaths.empty()) {
+        std::vector<std::filesystem::path> midis;
+        for (const auto &path : options.midiPaths) {
+            std::vector<std::filesystem::path> found = FindMidis(path);
+            midis.insert(midis.end(), found.begin(), found.end());
+        }
+        ok = BenchMidi(options, midis) && ok;
+    }
+    if (options.midiStressFiles > 0) {
+        ok = BenchMidiStress(options) && ok;
+    }
+    for (int size : options.blurSizes) {
+        ok = BenchBlur(options, size) && ok;
+    }
+    for (int songs : options.infoSongs) {
+        ok = BenchInfo(options, songs) && ok;
+    }
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,151 @@
+#include "midi-compare.h"
+
+#include "midifile/MidiFile.h"
+#include "song/smffile.h"
+
+#include <algorithm>
+#include <cstdarg>
+#include <cstdio>
+#include <vector>
+
+namespace {
+    std::string Format(const char *format, ...) {
+        char buffer[256];
+        va_list args;
+        va_start(args, format);
+        vsnprintf(buffer, sizeof(buffer), format, args);
+        va_end(args);
+        return buffer;
+    }
+
+    // midifile interpolates with a linear scan, so lookups are sampled rather than run
+    // for every tick
+    constexpr int LookupSamples = 2000;
+}
+
+std::string Encore::CompareWithMidifile(const std::filesystem::path &path) {
+    smf::MidiFile midiFile;
+    SmfFile smfFile;
+    bool midifileRead = midiFile.read(path.string());
+    bool smfRead = smfFile.Read(path);
+    if (midifileRead != smfRead) {
+        return Format("midifile %s it, SmfFile %s it",
+                      midifileRead ? "reads" : "refuses", smfRead ? "reads" : "refuses");
+    }
+    if (!smfRead) {
+        return "";
+    }
+    if (midiFile.getTrackCount() != smfFile.TrackCount()) {
+        return Format("%i tracks, expected %i", smfFile.TrackCount(), midiFile.getTrackCount());
+    }
+    if (midiFile.getTicksPerQuarterNote() != smfFile.TicksPerQuarterNote()) {
+        return Format(
+            "%i ticks per quarter note, expected %i",
+            smfFile.TicksPerQuarterNote(),
+            midiFile.getTicksPerQuarterNote()
+        );
+    }
+    midiFile.doTimeAnalysis();
+
+    std::vector<int> ticks;
+    std::vector<double> seconds;
+    for (int track = 0; track < smfFile.TrackCount(); track++) {
+        const smf::MidiEventList &expected = midiFile[track];
+        if (expected.getEventCount() != smfFile.EventCount(track)) {
+            return Format(
+                "track %i has %i events, expected %i",
+                track,
+                smfFile.EventCount(track),
+                expected.getEventCount()
+            );
+        }
+        for (int i = 0; i < smfFile.EventCount(track); i++) {
+            SmfEvent event = smfFile.Event(track, i);
+            const smf::MidiEvent &want = expected[i];
+            if (event.tick != want.tick) {
+                return Format("track %i event %i at tick %i, expected %i", track, i, event.tick, want.tick);
+            }
+            if (event.getSize() != (int)want.size()) {
+                return Format("track %i event %i is %i bytes, expected %i",
+                              track, i, event.getSize(), (int)want.size());
+            }
+            for (int k = 0; k < event.getSize(); k++) {
+                if (event[k] != want[k]) {
+                    return Format("track %i event %i byte %i is %02x, expected %02x",
+                                  track, i, k, event[k], want[k]);
+                }
+            }
+            if (smfFile.Seconds(track, i) != midiFile.getTimeInSeconds(track, i)) {
+                return Format("track %i event %i at %.9f s, expected %.9f s", track, i,
+                              smfFile.Seconds(track, i), midiFile.getTimeInSeconds(track, i));
+            }
+            ticks.push_back(event.tick);
+            seconds.push_back(smfFile.Seconds(track, i));
+        }
+    }
+    if (ticks.empty()) {
+        return "";
+    }
+
+    // A spread of event ticks and times, the points just after them, and an even sweep
+    // from a little before the start to a little past the end
+    std::vector<int> sampleTicks;
+    std::vector<double> sampleSeconds;
+    size_t step = std::max<size_t>(1, ticks.size() / LookupSamples);
+    for (size_t i = 0; i < ticks.size(); i += step) {
+        sampleTicks.insert(sampleTicks.end(), { ticks[i], ticks[i] + 1 });
+        sampleSeconds.insert(sampleSeconds.end(), { seconds[i], seconds[i] + 0.0001 });
+    }
+    int lastTick = *std::max_element(ticks.begin(), ticks.end());
+    double lastSeconds = *std::max_element(seconds.begin(), seconds.end());
+    for (int i = -1; i <= LookupSamples + 1; i++) {
+        sampleTicks.push_back((int)((long long)lastTick * i / LookupSamples));
+        sampleSeconds.push_back(lastSeconds * i / LookupSamples);
+    }
+    for (int tick : sampleTicks) {
+        double got = smfFile.SecondsAtTick(tick);
+        double want = midiFile.getTimeInSeconds(tick);
+        if (got != want) {
+            return Format("tick %i at %.9f s, expected %.9f s", tick, got, want);
+        }
+    }
+    for (double time : sampleSeconds) {
+        double got = smfFile.TickAtSeconds(time);
+        double want = midiFile.getAbsoluteTickTime(time);
+        if (got != want) {
+            return Format("%.9f s at tick %.6f, expected %.6f", time, got, want);
+        }
+    }
+
+    // Decoding every other track has to leave those tracks and the timing as they were
+    SmfFile partial;
+    partial.Read(path, [](int track, const std::string &) { return track % 2 == 1; });
+    for (int track = 0; track < smfFile.TrackCount(); track++) {
+        if (partial.TrackName(track) != smfFile.TrackName(track)) {
+            return Format("track %i named differently when read partially", track);
+        }
+        int expectedCount = track % 2 == 1 ? smfFile.EventCount(track) : 0;
+        if (partial.EventCount(track) != expectedCount) {
+            return Format("track %i has %i events read partially, expected %i",
+                          track, partial.EventCount(track), expectedCount);
+        }
+        for (int i = 0; i < expectedCount; i++) {
+            SmfEvent event = partial.Event(track, i);
+            SmfEvent want = smfFile.Event(track, i);
+            bool same = event.tick == want.tick && event.getSize() == want.getSize()
+                && partial.Seconds(track, i) == smfFile.Seconds(track, i);
+            for (int k = 0; same && k < event.getSize(); k++) {
+                same = event[k] == want[k];
+            }
+            if (!same) {
+                return Format("track %i event %i differs when read partially", track, i);
+            }
+        }
+    }
+    for (int tick : sampleTicks) {
+        if (partial.SecondsAtTick(tick) != smfFile.SecondsAtTick(tick)) {
+            return Format("tick %i at a different time when read partially", tick);
+        }
+    }
+    return "";
+}
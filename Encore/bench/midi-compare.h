@@ -0,0 +1,13 @@
+#pragma once
+
+#include <filesystem>
+#include <string>
+
+namespace Encore {
+    /// Reads a MIDI with both midifile and SmfFile and checks they agree: whether it
+    /// reads at all, the track count, ticks per quarter note, every event's tick, bytes
+    /// and time in seconds, and a spread of tick and seconds lookups. A read decoding
+    /// only some tracks is checked against the full one. Returns the first difference,
+    /// or an empty string if there isn't one.
+    std::string CompareWithMidifile(const std::filesystem::path &path);
+}
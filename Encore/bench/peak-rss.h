@@ -0,0 +1,13 @@
+#pragma once
+
+#include <cstdint>
+
+namespace Encore {
+    /// Highest resident set size this process has reached, in bytes, or 0 if the
+    /// platform can't tell.
+    uint64_t PeakResidentBytes();
+
+    /// Starts the high-water mark over from the current size. Only Linux allows this;
+    /// elsewhere it returns false and the peak keeps covering the whole run.
+    bool ResetPeakResident();
+}
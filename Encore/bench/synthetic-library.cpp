@@ -0,0 +1,374 @@
+#include "synthetic-library.h"
+
+#include <algorithm>
+#include <array>
+#include <cstdio>
+#include <fstream>
+#include <random>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace {
+    // Words chosen so the sorts see articles, accents, non-Latin titles and a spread of
+    // leading letters
+    constexpr std::array<std::string_view, 16> Adjectives = {
+        "The Last", "Electric", "Broken",  "Silent", "Neon",   "A Hollow", "Golden",
+        "Über",     "Crimson",  "Distant", "Frozen", "Velvet", "Zero",     "Café",
+        "Wild",     "夜明けの"
+    };
+    constexpr std::array<std::string_view, 16> Nouns = {
+        "Highway", "Signal",  "Garden", "Echo",   "Machine", "Horizon", "Riot",   "Mirror",
+        "Anthem",  "Circuit", "Ocean",  "Letter", "Engine",  "Shadow",  "Parade", "空"
+    };
+    constexpr std::array<std::string_view, 12> ArtistWords = {
+        "The Static", "Synthfox",  "Ärger",   "Low Tide", "Nine Lamps", "Basement",
+        "Glasshouse", "Kite Club", "Ōkami",   "Paper",    "Verge",      "Yellow Line"
+    };
+    constexpr std::array<std::string_view, 6> Sources = {
+        "encore", "custom", "rb3", "gh3", "yarg", "ch"
+    };
+    constexpr std::array<std::string_view, 5> PadParts = {
+        "drums", "bass", "guitar", "keys", "vocals"
+    };
+
+    std::mt19937 SongRandom(uint32_t seed, int number) {
+        std::seed_seq seq { seed, (uint32_t)number };
+        return std::mt19937(seq);
+    }
+
+    struct SyntheticSong {
+        std::string title;
+        std::string artist;
+        std::string album;
+        std::string source;
+        std::string year;
+        int length;
+        std::array<int, 5> diffs;
+    };
+
+    SyntheticSong MakeSong(uint32_t seed, int number) {
+        std::mt19937 random = SongRandom(seed, number);
+        auto pick = [&random](const auto &words) {
+            return std::string(words[random() % words.size()]);
+        };
+
+        SyntheticSong song;
+        song.title = pick(Adjectives) + " " + pick(Nouns);
+        // Plenty of shared titles, but not so many that every sort ties
+        if (random() % 3 != 0) {
+            song.title += " " + std::to_string(number);
+        }
+        // Roughly eight songs per artist, so artist headers group like a real library
+        int artist = number / 8;
+        song.artist = std::string(ArtistWords[artist % ArtistWords.size()]) + " "
+            + std::to_string(artist);
+        song.album = pick(Nouns) + " Sessions";
+        song.source = pick(Sources);
+        song.year = random() % 10 == 0 ? "" : std::to_string(1960 + random() % 66);
+        song.length = 60 + (int)(random() % 540);
+        for (int &diff : song.diffs) {
+            diff = (int)(random() % 8) - 1;
+        }
+        return song;
+    }
+
+    void WriteText(const std::filesystem::path &path, const std::string &text) {
+        std::ofstream(path, std::ios::binary).write(text.data(), (std::streamsize)text.size());
+    }
+
+    void PutVarLen(std::vector<unsigned char> &out, uint32_t value) {
+        unsigned char bytes[5];
+        int count = 0;
+        do {
+            bytes[count++] = value & 0x7F;
+            value >>= 7;
+        } while (value);
+        while (count-- > 0) {
+            out.push_back(bytes[count] | (count ? 0x80 : 0));
+        }
+    }
+
+    void PutTrack(std::vector<unsigned char> &file, const std::vector<unsigned char> &events) {
+        uint32_t size = events.size() + 4;
+        file.insert(file.end(), { 'M', 'T', 'r', 'k' });
+        file.insert(file.end(), {
+            (unsigned char)(size >> 24), (unsigned char)(size >> 16),
+            (unsigned char)(size >> 8), (unsigned char)size
+        });
+        file.insert(file.end(), events.begin(), events.end());
+        file.insert(file.end(), { 0x00, 0xFF, 0x2F, 0x00 });
+    }
+
+    // A tempo track and a short PART DRUMS track, enough for the MIDI to parse
+    void WriteStubMidi(const std::filesystem::path &path) {
+        std::vector<unsigned char> file = {
+            'M', 'T', 'h', 'd', 0, 0, 0, 6, 0, 1, 0, 2, 0x01, 0xE0 // format 1, 480 tpq
+        };
+        PutTrack(file, { 0x00, 0xFF, 0x51, 0x03, 0x07, 0xA1, 0x20 }); // 120 BPM
+
+        std::vector<unsigned char> drums = { 0x00, 0xFF, 0x03, 10 };
+        for (char c : std::string_view("PART DRUMS")) {
+            drums.push_back(c);
+        }
+        for (int note = 0; note < 16; note++) {
+            PutVarLen(drums, note ? 360 : 480);
+            drums.insert(drums.end(), { 0x90, (unsigned char)(96 + note % 5), 100 });
+            PutVarLen(drums, 120);
+            drums.insert(drums.end(), { 0x80, (unsigned char)(96 + note % 5), 0 });
+        }
+        PutTrack(file, drums);
+        std::ofstream(path, std::ios::binary)
+            .write((const char *)file.data(), (std::streamsize)file.size());
+    }
+
+    struct MidiEvent {
+        uint32_t tick;
+        std::array<unsigned char, 3> bytes;
+    };
+
+    void PutNote(std::vector<MidiEvent> &events, uint32_t tick, uint32_t length, int pitch) {
+        events.push_back({ tick, { 0x90, (unsigned char)pitch, 100 } });
+        events.push_back({ tick + length, { 0x80, (unsigned char)pitch, 0 } });
+    }
+
+    // A marker note over every span'th run of length notes, like overdrive or solos
+    void PutPhrases(
+        std::vector<MidiEvent> &events,
+        const std::vector<uint32_t> &ticks,
+        int pitch,
+        int span,
+        int length,
+        int offset
+    ) {
+        for (size_t i = offset; i + length < ticks.size(); i += span) {
+            PutNote(events, ticks[i], ticks[i + length] - ticks[i], pitch);
+        }
+    }
+
+    // Note-offs go before note-ons on the same tick, so a note can start where the
+    // last one in its lane ended
+    std::vector<unsigned char> MakeTrack(std::string_view name, std::vector<MidiEvent> events) {
+        std::vector<unsigned char> track = { 0x00, 0xFF, 0x03, (unsigned char)name.size() };
+        track.insert(track.end(), name.begin(), name.end());
+        std::stable_sort(events.begin(), events.end(), [](const MidiEvent &a, const MidiEvent &b) {
+            if (a.tick != b.tick) {
+                return a.tick < b.tick;
+            }
+            return a.bytes[0] == 0x80 && b.bytes[0] != 0x80;
+        });
+        uint32_t last = 0;
+        for (const MidiEvent &event : events) {
+            PutVarLen(track, event.tick - last);
+            track.insert(track.end(), event.bytes.begin(), event.bytes.end());
+            last = event.tick;
+        }
+        return track;
+    }
+
+    void WriteInfoJson(const std::filesystem::path &dir, const SyntheticSong &song) {
+        std::string json = "{\n";
+        json += "\t\"title\": \"" + song.title + "\",\n";
+        json += "\t\"artist\": \"" + song.artist + "\",\n";
+        json += "\t\"album\": \"" + song.album + "\",\n";
+        json += "\t\"preview_start_time\": 30000,\n";
+        if (!song.year.empty()) {
+            json += "\t\"release_year\": \"" + song.year + "\",\n";
+        }
+        json += "\t\"source\": \"" + song.source + "\",\n";
+        json += "\t\"loading_phrase\": \"Generated for benchmarking\",\n";
+        json += "\t\"charters\": [\"Synthetic\"],\n";
+        json += "\t\"length\": " + std::to_string(song.length) + ",\n";
+        json += "\t\"diff\": {\n";
+        for (size_t part = 0; part < PadParts.size(); part++) {
+            json += "\t\t\"" + std::string(PadParts[part])
+                + "\": " + std::to_string(song.diffs[part]) + ",\n";
+        }
+        json += "\t\t\"plastic_drums\": -1\n\t},\n";
+        json += "\t\"midi\": \"notes.mid\",\n";
+        json += "\t\"stems\": {\n";
+        json += "\t\t\"drums\": \"drums.ogg\",\n\t\t\"bass\": \"bass.ogg\",\n";
+        json += "\t\t\"keys\": \"lead.ogg\",\n\t\t\"vocals\": \"vocals.ogg\",\n";
+        json += "\t\t\"backing\": \"backing.ogg\"\n\t}\n}\n";
+        WriteText(dir / "info.json", json);
+        for (const char *stem : { "drums.ogg", "bass.ogg", "lead.ogg", "vocals.ogg", "backing.ogg" }) {
+            WriteText(dir / stem, "");
+        }
+    }
+
+    void WriteSongIni(const std::filesystem::path &dir, const SyntheticSong &song) {
+        std::string ini = "[song]\n";
+        ini += "name = " + song.title + "\n";
+        ini += "artist = " + song.artist + "\n";
+        ini += "album = " + song.album + "\n";
+        ini += "charter = Synthetic\n";
+        ini += "icon = " + song.source + "\n";
+        if (!song.year.empty()) {
+            ini += "year = " + song.year + "\n";
+        }
+        ini += "song_length = " + std::to_string(song.length) + "\n";
+        for (size_t part = 0; part < PadParts.size(); part++) {
+            ini += "diff_" + std::string(PadParts[part])
+                + " = " + std::to_string(song.diffs[part]) + "\n";
+        }
+        WriteText(dir / "song.ini", ini);
+        for (const char *stem : { "song.ogg", "guitar.ogg", "bass.ogg", "drums.ogg", "vocals.ogg" }) {
+            WriteText(dir / stem, "");
+        }
+    }
+}
+
+void Encore::WriteSyntheticLibrary(
+    const std::filesystem::path &root, int first, int count, uint32_t seed
+) {
+    std::filesystem::create_directories(root);
+    for (int number = first; number < first + count; number++) {
+        SyntheticSong song = MakeSong(seed, number);
+        char name[16];
+        snprintf(name, sizeof(name), "song%07d", number);
+        std::filesystem::path dir = root / name;
+        std::filesystem::create_directories(dir);
+        if (number % 4 == 3) {
+            WriteSongIni(dir, song);
+        } else {
+            WriteInfoJson(dir, song);
+        }
+        WriteStubMidi(dir / "notes.mid");
+    }
+}
+
+void Encore::WriteDenseChart(const std::filesystem::path &path, int notes, uint32_t seed) {
+    std::mt19937 random = SongRandom(seed, notes);
+    constexpr uint32_t Sixteenth = 120; // at 480 ticks per quarter note
+
+    std::vector<MidiEvent> drums;
+    std::vector<uint32_t> drumTicks;
+    for (int i = 0; i < notes; i++) {
+        uint32_t tick = 480 + i * Sixteenth;
+        drumTicks.push_back(tick);
+        int first = 96 + (int)(random() % 5);
+        PutNote(drums, tick, Sixteenth / 2, first);
+        if (random() % 3 == 0) {
+            PutNote(drums, tick, Sixteenth / 2, 96 + (first - 95) % 5);
+        }
+        if (random() % 8 == 0) {
+            PutNote(drums, tick, Sixteenth / 2, 95); // double kick, sometimes on a kick
+        }
+        if (random() % 10 == 0) {
+            PutNote(drums, tick, Sixteenth / 2, 102 + (int)(random() % 5)); // lift
+        }
+    }
+    PutPhrases(drums, drumTicks, 110, 64, 32, 0); // yellow toms
+    PutPhrases(drums, drumTicks, 111, 64, 16, 8); // blue toms
+    PutPhrases(drums, drumTicks, 112, 64, 16, 40); // green toms
+    PutPhrases(drums, drumTicks, 116, 128, 16, 4); // overdrive
+    PutPhrases(drums, drumTicks, 101, 512, 64, 200); // pad solo
+    PutPhrases(drums, drumTicks, 103, 512, 64, 200); // plastic solo
+
+    std::vector<MidiEvent> guitar;
+    std::vector<uint32_t> guitarTicks;
+    uint32_t tick = 480;
+    for (int i = 0; i < notes; i++) {
+        guitarTicks.push_back(tick);
+        bool sustain = random() % 6 == 0;
+        uint32_t length = sustain ? 4 * Sixteenth : Sixteenth / 2;
+        int lanes = 1 + (int)(random() % 3);
+        int first = (int)(random() % 5);
+        for (int lane = 0; lane < lanes; lane++) {
+            PutNote(guitar, tick, length, 96 + (first + lane) % 5);
+        }
+        tick += sustain ? length + Sixteenth : Sixteenth;
+    }
+    PutPhrases(guitar, guitarTicks, 101, 64, 8, 0); // force on
+    PutPhrases(guitar, guitarTicks, 102, 64, 8, 24); // force off
+    PutPhrases(guitar, guitarTicks, 104, 64, 8, 48); // tap
+    PutPhrases(guitar, guitarTicks, 116, 128, 16, 4); // overdrive
+    PutPhrases(guitar, guitarTicks, 103, 512, 64, 200); // solo
+
+    std::vector<unsigned char> file = {
+        'M', 'T', 'h', 'd', 0, 0, 0, 6, 0, 1, 0, 3, 0x01, 0xE0 // format 1, 480 tpq
+    };
+    PutTrack(file, { 0x00, 0xFF, 0x51, 0x03, 0x07, 0xA1, 0x20 }); // 120 BPM
+    PutTrack(file, MakeTrack("PART DRUMS", std::move(drums)));
+    PutTrack(file, MakeTrack("PART GUITAR", std::move(guitar)));
+    std::ofstream(path, std::ios::binary)
+        .write((const char *)file.data(), (std::streamsize)file.size());
+}
+
+void Encore::WriteStressMidi(const std::filesystem::path &path, uint32_t seed) {
+    std::mt19937 random = SongRandom(seed, 0);
+    auto below = [&random](uint32_t limit) { return (uint32_t)(random() % limit); };
+    auto putText = [&](std::vector<unsigned char> &track, uint32_t length) {
+        PutVarLen(track, length);
+        for (uint32_t i = 0; i < length; i++) {
+            track.push_back((unsigned char)(' ' + below(95)));
+        }
+    };
+
+    int trackCount = 2 + (int)below(7);
+    std::vector<unsigned char> file = {
+        'M', 'T', 'h', 'd', 0, 0, 0, 6, 0, 1, 0, (unsigned char)trackCount, 0x01, 0xE0
+    };
+    for (int index = 0; index < trackCount; index++) {
+        std::vector<unsigned char> track = { 0x00, 0xFF, 0x03 };
+        putText(track, 4 + below(28));
+        int events = 1000 + (int)below(2000);
+        uint8_t running = 0;
+        for (int event = 0; event < events; event++) {
+            PutVarLen(track, below(4) == 0 ? 0 : below(240));
+            uint32_t kind = below(100);
+            if (kind < 45) {
+                // Note off/on, aftertouch, controller or pitch bend: two data bytes
+                static constexpr uint8_t TwoByteCommands[] = { 0x80, 0x90, 0xA0, 0xB0, 0xE0 };
+                uint8_t status = TwoByteCommands[below(5)] | (uint8_t)below(16);
+                if (status != running || below(3) == 0) {
+                    track.push_back(status);
+                }
+                running = status;
+                track.insert(track.end(), { (unsigned char)below(128), (unsigned char)below(128) });
+            } else if (kind < 55) {
+                // Program change or channel pressure: one data byte
+                uint8_t status = (below(2) ? 0xC0 : 0xD0) | (uint8_t)below(16);
+                if (status != running || below(3) == 0) {
+                    track.push_back(status);
+                }
+                running = status;
+                track.push_back((unsigned char)below(128));
+            } else if (kind < 75) {
+                // Text, lyric or marker
+                static constexpr uint8_t TextTypes[] = { 0x01, 0x05, 0x06 };
+                track.insert(track.end(), { 0xFF, TextTypes[below(3)] });
+                putText(track, 5 + below(100));
+                running = 0;
+            } else if (kind < 93) {
+                uint32_t length = 8 + below(248);
+                track.push_back(0xF0);
+                PutVarLen(track, length);
+                for (uint32_t i = 0; i + 1 < length; i++) {
+                    track.push_back((unsigned char)below(128));
+                }
+                track.push_back(0xF7);
+                running = 0;
+            } else if (kind < 96) {
+                // An escaped packet, sent as is
+                uint32_t length = 4 + below(60);
+                track.push_back(0xF7);
+                PutVarLen(track, length);
+                for (uint32_t i = 0; i < length; i++) {
+                    track.push_back((unsigned char)below(128));
+                }
+                running = 0;
+            } else {
+                uint32_t microseconds = 300000 + below(900000);
+                track.insert(track.end(), {
+                    0xFF, 0x51, 0x03, (unsigned char)(microseconds >> 16),
+                    (unsigned char)(microseconds >> 8), (unsigned char)microseconds
+                });
+                running = 0;
+            }
+        }
+        PutTrack(file, track);
+    }
+    std::ofstream(path, std::ios::binary)
+        .write((const char *)file.data(), (std::streamsize)file.size());
+}
@@ -0,0 +1,25 @@
+#pragma once
+
+#include <cstdint>
+#include <filesystem>
+
+namespace Encore {
+    /// Writes song folders numbered first to first + count - 1 into root. Every fourth
+    /// song uses song.ini instead of info.json; all of them get a small notes.mid and
+    /// empty stems. The same seed and number always give the same song, so a library
+    /// can be grown later by writing the next range.
+    void WriteSyntheticLibrary(
+        const std::filesystem::path &root, int first, int count, uint32_t seed = 1
+    );
+
+    /// Writes a MIDI with a PART DRUMS track (track 1) and a PART GUITAR track (track 2)
+    /// of about notes chords each on expert, with lifts, double kicks, tom and forcing
+    /// markers, taps, overdrive and solos mixed in, for timing the chart parsers.
+    void WriteDenseChart(const std::filesystem::path &path, int notes, uint32_t seed = 1);
+
+    /// Writes a MIDI of several tracks mixing every kind of channel message (with and
+    /// without running status) with text meta events, sysex messages of up to a few
+    /// hundred bytes, escaped sysex packets and tempo changes, so meta and sysex bytes
+    /// make up most of the file. The same seed always gives the same file.
+    void WriteStressMidi(const std::filesystem::path &path, uint32_t seed);
+}
@@ -42,4 +42,15 @@ public:
 
         return "";
     }
+
+    // For flags without a value; key=value counts too
+    static bool HasArg(string key) {
+        for (auto arg : arguments) {
+            if (split(arg, '=')[0] == key) {
+                return true;
+            }
+        }
+
+        return false;
+    }
 };
\ No newline at end of file
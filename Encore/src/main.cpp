@@ -30,6 +30,8 @@
 #include "arguments.h"
 #include "assets.h"
 #include "song/audio.h"
+#include "song/artcache.h"
+#include "song/chartprecompile.h"
 #include "gameplay/gameplayRenderer.h"
 
 #include "menus/uiUnits.h"
@@ -50,6 +52,7 @@
 MenuManager TheMenuManager;
 gameplayRenderer TheGameRenderer;
 SongList TheSongList;
+AlbumArtCache TheAlbumArtCache;
 PlayerManager ThePlayerManager;
 Assets &assets = Assets::getInstance();
 Encore::AudioManager TheAudioManager;
@@ -127,6 +130,11 @@ int main(int argc, char *argv[]) {
     }
 #endif
     TheSettingsInitializer.InitSettings(directory);
+    if (ArgumentList::HasArg("precompile-charts")) {
+        // Headless: the caches live next to the executable, same as in game
+        ChangeDirectory(GetApplicationDirectory());
+        return PrecompileCharts(TheGameSettings.SongPaths);
+    }
     ThePlayerManager.SetPlayerListSaveFileLocation(directory / "players.json");
     ThePlayerManager.LoadPlayerList();
 
@@ -213,10 +221,13 @@ int main(int argc, char *argv[]) {
             TheMenuManager.LoadMenu();
         }
 
+        TheAlbumArtCache.UploadDecoded(ALBUM_ART_UPLOAD_BUDGET);
         TheMenuManager.DrawMenu();
         EndDrawing();
         TheFrameManager.WaitForFrame();
     }
+    TheSongList.StopWatching();
+    TheAlbumArtCache.Shutdown();
     CloseWindow();
     return 0;
 }
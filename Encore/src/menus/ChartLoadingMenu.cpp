@@ -9,53 +9,74 @@
 #include "uiUnits.h"
 #include "gameplay/gameplayRenderer.h"
 #include "users/playerManager.h"
+#include "song/chartcache.h"
 
+#include <algorithm>
 #include <thread>
 
 bool StartLoading = true;
 bool FinishedLoading = false;
 
 void LoadCharts() {
-    smf::MidiFile midiFile;
-    midiFile.read(TheSongList.curSong->midiPath.string());
-    TheSongList.curSong->getTiming(midiFile, 0, midiFile[0]);
-    TheSongList.curSong->parseBeatLines(midiFile, TheSongList.curSong->BeatTrackID);
+    Song &song = *TheSongList.curSong;
+    // Charts compiled ahead of time (see PrecompileCharts) skip the MIDI entirely;
+    // anything missing from the cache is parsed as usual
+    CompiledSong compiled;
+    bool cached = LoadChartCache(song, compiled);
+    // Only the tracks this load uses are decoded: tempo, BEAT and EVENTS, the active
+    // players' parts, and the classic guitar and bass tracks getCodas looks for the
+    // big rock ending in
+    std::vector<int> playerTracks;
+    for (int playerNum = 0; playerNum < ThePlayerManager.PlayersActive; playerNum++) {
+        Player &player = ThePlayerManager.GetActivePlayer(playerNum);
+        const Chart &chart = song.parts[player.Instrument]->charts[player.Difficulty];
+        if (chart.valid) {
+            playerTracks.push_back(chart.track);
+        }
+    }
+    auto neededTrack = [&](int track, const std::string &name) {
+        if (track == 0 || track == song.BeatTrackID
+            || std::find(playerTracks.begin(), playerTracks.end(), track)
+                != playerTracks.end()) {
+            return true;
+        }
+        SongParts part = song.ini ? partFromStringINI(name) : partFromString(name);
+        return part == Events || part == PlasticBass || part == PlasticGuitar;
+    };
+    SmfFile midiFile;
+    bool midiRead = false;
+    auto readMidi = [&] {
+        if (!midiRead) {
+            midiFile.Read(song.midiPath, neededTrack);
+            midiRead = true;
+        }
+    };
+    if (cached) {
+        ApplyCompiledSong(compiled, song);
+    } else {
+        readMidi();
+        song.getTiming(MidiTrackView(midiFile, 0));
+        song.parseBeatLines(midiFile, song.BeatTrackID);
+    }
     for (int playerNum = 0; playerNum < ThePlayerManager.PlayersActive; playerNum++) {
         Player &player = ThePlayerManager.GetActivePlayer(playerNum);
         int diff = player.Difficulty;
         int inst = player.Instrument;
-        int track = TheSongList.curSong->parts[inst]->charts[diff].track;
         std::string trackName;
 
-        Chart &chart = TheSongList.curSong->parts[inst]->charts[diff];
+        Chart &chart = song.parts[inst]->charts[diff];
         if (chart.valid) {
             Encore::EncoreLog(
                 LOG_DEBUG,
                 TextFormat("Loading part %s, diff %01i", trackName.c_str(), diff)
             );
-            LoadingState = NOTE_PARSING;
-            if (inst < PitchedVocals && inst != PlasticDrums && inst > PartVocals) {
-                chart.plastic = true;
-                chart.parsePlasticNotes(
-                    midiFile, track, diff, inst, TheSongList.curSong->hopoThreshold
-                );
-            } else if (inst == PlasticDrums) {
-                chart.plastic = true;
-                chart.parsePlasticDrums(
-                    midiFile, track, midiFile[track], diff, inst, player.ProDrums, true
-                );
+            const CompiledChart *compiledChart =
+                cached ? compiled.Find(inst, diff, player.ProDrums) : nullptr;
+            if (compiledChart) {
+                chart = compiledChart->chart;
             } else {
-                chart.plastic = false;
-                chart.parseNotes(midiFile, track, midiFile[track], diff, inst);
-            }
-
-            if (!chart.plastic) {
-                LoadingState = EXTRA_PROCESSING;
-                int noteIdx = 0;
-                for (Note &note : chart.notes) {
-                    chart.notes_perlane[note.lane].push_back(noteIdx);
-                    noteIdx++;
-                }
+                readMidi();
+                chart.parse(midiFile, diff, inst, song.hopoThreshold, player.ProDrums);
             }
         }
 
@@ -64,7 +85,9 @@ void LoadCharts() {
         //}
     }
 
-    TheSongList.curSong->getCodas(midiFile);
+    if (!cached) {
+        song.getCodas(midiFile);
+    }
     LoadingState = READY;
     std::this_thread::sleep_for(std::chrono::seconds(1));
     FinishedLoading = true;
@@ -16,52 +16,6 @@ void ReadyUpMenu::KeyboardInputCallback(int key, int scancode, int action, int m
 
 }
 
-SongParts GetSongPart(smf::MidiEventList track) {
-    for (int events = 0; events < track.getSize(); events++) {
-        std::string trackName;
-        if (!track[events].isMeta())
-            continue;
-        if ((int)track[events][1] == 3) {
-            for (int k = 3; k < track[events].getSize(); k++) {
-                trackName += track[events][k];
-            }
-            if (TheSongList.curSong->ini)
-                return partFromStringINI(trackName);
-            return partFromString(trackName);
-        }
-    }
-    return Invalid;
-}
-
-std::vector<std::vector<int> > pDiffRangeNotes = {
-    { 60, 64 }, { 72, 76 }, { 84, 88 }, { 96, 100 }
-};
-
-void IsPartValid(smf::MidiEventList track, SongParts songPart, int trackNumber) {
-    if (songPart != SongParts::Invalid && songPart != PitchedVocals
-        && songPart != BeatLines) {
-        for (int diff = 0; diff < 4; diff++) {
-            bool StopSearching = false;
-            Chart newChart;
-            for (int i = 0; i < track.getSize(); i++) {
-                if (track[i].isNoteOn() && !track[i].isMeta()
-                    && (int)track[i][1] >= pDiffRangeNotes[diff][0]
-                    && (int)track[i][1] <= pDiffRangeNotes[diff][1] && !StopSearching) {
-                    newChart.valid = true;
-                    newChart.diff = diff;
-                    newChart.track = trackNumber;
-                    TheSongList.curSong->parts[(int)songPart]->hasPart = true;
-                    StopSearching = true;
-                }
-            }
-            if (songPart > PartVocals && songPart < PlasticVocals)
-                TheSongList.curSong->parts[songPart]->plastic = true;
-            if (songPart < PlasticVocals)
-                TheSongList.curSong->parts[(int)songPart]->charts.push_back(newChart);
-        }
-    }
-}
-
 void ReadyUpMenu::Draw() {
     Assets &assets = Assets::getInstance();
     Units &u = Units::getInstance();
@@ -139,15 +93,11 @@ void ReadyUpMenu::Draw() {
             continue;
         Player &player = ThePlayerManager.GetActivePlayer(playerInt);
         if (!TheGameRenderer.midiLoaded && !TheSongList.curSong->midiParsed) {
-            smf::MidiFile midiFile;
-            midiFile.read(TheSongList.curSong->midiPath.string());
-            for (int track = 0; track < midiFile.getTrackCount(); track++) {
-                SongParts songPart = GetSongPart(midiFile[track]);
-                IsPartValid(midiFile[track], songPart, track);
-                if (songPart == BeatLines) {
-                    TheSongList.curSong->BeatTrackID = track;
-                }
+            // Only reads the MIDI the first time a song is played or after it changed
+            if (TheSongList.curSong->UpdateChartSummary()) {
+                TheSongList.SaveChartSummary(*TheSongList.curSong);
             }
+            TheSongList.curSong->ApplyChartSummary();
 
             TheSongList.curSong->midiParsed = true;
             TheGameRenderer.midiLoaded = true;
@@ -156,8 +106,7 @@ void ReadyUpMenu::Draw() {
                 || !TheSongList.curSong->parts[player.Instrument]->hasPart) {
                 player.ReadyUpMenuState = Player::INSTRUMENT;
             } else if (!TheSongList.curSong->parts[player.Instrument]
-                            ->charts[player.Difficulty]
-                            .valid) {
+                            ->ValidDiffs[player.Difficulty]) {
                 player.ReadyUpMenuState = Player::DIFFICULTY;
             } else if (player.ReadiedUpBefore) {
                 player.ReadyUpMenuState = Player::PREVIEW;
@@ -265,9 +214,8 @@ void ReadyUpMenu::Draw() {
                               u.hinpct(0.05f) },
                             "Done"
                         )) {
-                        if (TheSongList.curSong->parts[player.Instrument]
-                                ->charts[player.Difficulty]
-                                .notes.empty()) {
+                        if (!TheSongList.curSong->parts[player.Instrument]
+                                 ->ValidDiffs[player.Difficulty]) {
                             player.ReadyUpMenuState = Player::DIFFICULTY;
                         } else {
                             player.ReadyUpMenuState = Player::PREVIEW;
@@ -286,13 +234,14 @@ void ReadyUpMenu::Draw() {
             }
             case Player::DIFFICULTY: {
                 {
-                    for (auto &chartDiff :
-                         TheSongList.curSong->parts[player.Instrument]->charts) {
-                        if (chartDiff.valid) {
+                    const SongPart &part =
+                        *TheSongList.curSong->parts[player.Instrument];
+                    for (int diff = 0; diff < 4; diff++) {
+                        if (part.ValidDiffs[diff]) {
                             GuiSetStyle(
                                 BUTTON,
                                 BASE_COLOR_NORMAL,
-                                chartDiff.diff == player.Difficulty && player.diffSelected
+                                diff == player.Difficulty && player.diffSelected
                                     ? ColorToInt(
                                           ColorBrightness(player.AccentColor, -0.25)
                                       )
@@ -301,19 +250,19 @@ void ReadyUpMenu::Draw() {
                             if (GuiButton(
                                     { xPosOfMenu,
                                       BottomOvershell - u.hinpct(0.05f)
-                                          - (u.hinpct(0.05f) * chartDiff.diff),
+                                          - (u.hinpct(0.05f) * diff),
                                       u.winpct(0.2f),
                                       u.hinpct(0.05f) },
-                                    diffList[chartDiff.diff].c_str()
+                                    diffList[diff].c_str()
                                 )) {
-                                player.Difficulty = chartDiff.diff;
+                                player.Difficulty = diff;
                                 player.diffSelected = true;
                             }
                         } else {
                             GuiButton(
                                 { xPosOfMenu,
                                   BottomOvershell - u.hinpct(0.05f)
-                                      - (u.hinpct(0.05f) * chartDiff.diff),
+                                      - (u.hinpct(0.05f) * diff),
                                   u.winpct(0.2f),
                                   u.hinpct(0.05f) },
                                 ""
@@ -321,7 +270,7 @@ void ReadyUpMenu::Draw() {
                             DrawRectangle(
                                 xPosOfMenu + 2,
                                 BottomOvershell + 2 - u.hinpct(0.05f)
-                                    - (u.hinpct(0.05f) * chartDiff.diff),
+                                    - (u.hinpct(0.05f) * diff),
                                 u.winpct(0.2f) - 4,
                                 u.hinpct(0.05f) - 4,
                                 Color { 0, 0, 0, 128 }
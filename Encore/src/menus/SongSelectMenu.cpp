@@ -46,18 +46,6 @@ void SongSelectMenu::Load() {
     selectionTime = 0.0;
     songTextMetrics.clear();
 
-    if (TheSongList.curSong && !TheSongList.curSong->AlbumArtLoaded) {
-        try {
-            TheSongList.curSong->LoadAlbumArt();
-            SetTextureWrap(TheSongList.curSong->albumArtBlur, TEXTURE_WRAP_REPEAT);
-            SetTextureFilter(TheSongList.curSong->albumArtBlur, TEXTURE_FILTER_ANISOTROPIC_16X);
-            TheSongList.curSong->AlbumArtLoaded = true;
-            TraceLog(LOG_DEBUG, "Loaded album art for %s", TheSongList.curSong->title.c_str());
-        } catch (const std::exception& e) {
-            TraceLog(LOG_ERROR, "Failed to load album art for %s: %s", TheSongList.curSong->title.c_str(), e.what());
-        }
-    }
-
     if (TheSongList.curSong) {
         TheSongList.SongSelectOffset = TheSongList.curSong->songListPos - 5;
         if (TheSongList.SongSelectOffset < 1) TheSongList.SongSelectOffset = 1;
@@ -65,7 +53,6 @@ void SongSelectMenu::Load() {
             TheSongList.SongSelectOffset = TheSongList.listMenuEntries.size() - 10;
         animatingSongID = TheSongList.curSong->songListPos - 1;
         animationStartTime = GetTime();
-        ComputeSongTextMetrics(*TheSongList.curSong);
     } else {
         Encore::EncoreLog(LOG_WARNING, "No current song selected for offset adjustment");
         TheSongList.SongSelectOffset = 1;
@@ -73,23 +60,13 @@ void SongSelectMenu::Load() {
 
     // TheGameRenderer.streamsLoaded = false;
     // TheGameRenderer.midiLoaded = false;
-    for (Song& song : TheSongList.songs) {
-        if (!song.ini) {
-            song.LoadInfo(song.songInfoPath);
-        } else {
-            song.LoadInfoINI(song.songInfoPath);
-        }
-        ComputeSongTextMetrics(song);
-    }
+    // Text metrics for the other rows are measured as they scroll into view
 }
 
 void SongSelectMenu::Unload() {
-    if (!TheAudioManager.loadedStreams.empty()) {
-        for (auto& stream : TheAudioManager.loadedStreams) {
-            TheAudioManager.StopPlayback(stream.handle);
-        }
-        TheAudioManager.loadedStreams.clear();
-    }
+    TheAudioManager.unloadStreams();
+    previewLoader.Clear();
+    previewWantedID = -1;
 }
 
 void SongSelectMenu::KeyboardInputCallback(int key, int scancode, int action, int mods) {
@@ -115,7 +92,83 @@ std::string SecondsToTimeFormat(int seconds) {
     return TextFormat("%d:%02d", minutes, remainingSeconds);
 }
 
-void SongSelectMenu::ComputeSongTextMetrics(Song& song) {
+void SongSelectMenu::UpdatePreviewLoads() {
+    const Song *song = TheSongList.curSong;
+    int songID = song ? TheSongList.curSongID : -1;
+    if (songID == previewWantedID && previewRequest == previewWantedRequest) {
+        return;
+    }
+    previewWantedID = songID;
+    previewWantedRequest = previewRequest;
+    if (!song) {
+        previewLoader.Clear();
+        return;
+    }
+    std::vector<Encore::PreviewSource> sources;
+    Encore::StemList stems = song->stemsPath;
+    sources.push_back({ song->songDir.string(), song->previewStartTime / 1000.0, [stems] { return stems; } });
+
+    // The songs either side too, so stepping through the list doesn't wait on the disk.
+    // They're only in the catalog, so their info file is read on the loader's thread.
+    const SongCatalog &catalog = TheSongList.catalog;
+    const auto &entries = TheSongList.listMenuEntries;
+    int cursor = song->songListPos - 1;
+    for (int direction : { 1, -1 }) {
+        int pos = cursor + direction;
+        while (pos >= 0 && pos < (int)entries.size() && entries[pos].isHeader) {
+            pos += direction;
+        }
+        if (cursor < 0 || pos < 0 || pos >= (int)entries.size()) {
+            continue;
+        }
+        auto neighbour = std::make_shared<Song>();
+        catalog.FillSong(entries[pos].songListID, *neighbour);
+        std::string key = neighbour->songDir.string();
+        double start = neighbour->previewStartTime / 1000.0;
+        sources.push_back({ key, start, [neighbour] {
+            try {
+                SongList::LoadSongFiles(SongFolderSnapshot(neighbour->songDir), *neighbour);
+            } catch (const std::exception &) {
+                return Encore::StemList();
+            }
+            return neighbour->stemsPath;
+        } });
+    }
+    previewLoader.SetWanted(std::move(sources));
+}
+
+void SongSelectMenu::UpdateAlbumArt() {
+    Song *song = TheSongList.curSong;
+    if (!song) {
+        return;
+    }
+    // Nearest first: the selected song, then outwards from it in list order
+    const SongCatalog &catalog = TheSongList.catalog;
+    const auto &entries = TheSongList.listMenuEntries;
+    std::vector<std::string> artPaths { song->albumArtPath };
+    int cursor = song->songListPos - 1;
+    for (int step = 1; step <= ALBUM_ART_PREFETCH_RADIUS; step++) {
+        for (int pos : { cursor + step, cursor - step }) {
+            if (pos >= 0 && pos < (int)entries.size() && !entries[pos].isHeader) {
+                artPaths.emplace_back(catalog.Get(entries[pos].songListID, SongCatalog::AlbumArtPath));
+            }
+        }
+    }
+    TheAlbumArtCache.Prefetch(artPaths);
+
+    // Shown once the decoder has it, instead of holding up this frame
+    if (!song->AlbumArtLoaded && TheAlbumArtCache.Find(song->albumArtPath)) {
+        song->LoadAlbumArt();
+        SetTextureWrap(song->albumArtBlur, TEXTURE_WRAP_REPEAT);
+        SetTextureFilter(song->albumArtBlur, TEXTURE_FILTER_ANISOTROPIC_16X);
+        song->AlbumArtLoaded = true;
+    }
+}
+
+void SongSelectMenu::ComputeSongTextMetrics(int songID) {
+    const SongCatalog &catalog = TheSongList.catalog;
+    const char *title = catalog.CStr(songID, SongCatalog::Title);
+    const char *artist = catalog.CStr(songID, SongCatalog::Artist);
     Units u = Units::getInstance();
     Assets& assets = Assets::getInstance();
 
@@ -125,26 +178,40 @@ void SongSelectMenu::ComputeSongTextMetrics(Song& song) {
 
     // i tried........ - Jaydenz
     metrics.titleFontSize = u.hinpct(0.035f);
-    metrics.titleTextWidth = MeasureTextEx(assets.rubikBold, song.title.c_str(), metrics.titleFontSize, 0).x;
+    metrics.titleTextWidth = MeasureTextEx(assets.rubikBold, title, metrics.titleFontSize, 0).x;
     if (metrics.titleTextWidth > songTitleWidth) {
         metrics.titleFontSize = (songTitleWidth / metrics.titleTextWidth) * u.hinpct(0.035f);
         const float minFontSize = u.hinpct(0.02f);
         if (metrics.titleFontSize < minFontSize) metrics.titleFontSize = minFontSize;
-        metrics.titleTextWidth = MeasureTextEx(assets.rubikBold, song.title.c_str(), metrics.titleFontSize, 0).x;
+        metrics.titleTextWidth = MeasureTextEx(assets.rubikBold, title, metrics.titleFontSize, 0).x;
     }
 
     metrics.artistFontSize = u.hinpct(0.025f);
-    metrics.artistTextWidth = MeasureTextEx(assets.josefinSansItalic, song.artist.c_str(), metrics.artistFontSize, 0).x;
+    metrics.artistTextWidth = MeasureTextEx(assets.josefinSansItalic, artist, metrics.artistFontSize, 0).x;
     if (metrics.artistTextWidth > songArtistWidth) {
         metrics.artistFontSize = (songArtistWidth / metrics.artistTextWidth) * u.hinpct(0.025f);
         const float minFontSize = u.hinpct(0.02f);
         if (metrics.artistFontSize < minFontSize) metrics.artistFontSize = minFontSize;
-        metrics.artistTextWidth = MeasureTextEx(assets.josefinSansItalic, song.artist.c_str(), metrics.artistFontSize, 0).x;
+        metrics.artistTextWidth = MeasureTextEx(assets.josefinSansItalic, artist, metrics.artistFontSize, 0).x;
     }
 
-    if (song.songListPos >= 0) {
-        songTextMetrics[song.songListPos] = metrics;
+    metrics.measured = true;
+    songTextMetrics[songID] = metrics;
+}
+
+const SongSelectMenu::TextMetrics &SongSelectMenu::SongTextMetrics(int songID) {
+    if (GetScreenWidth() != metricsScreenWidth || GetScreenHeight() != metricsScreenHeight) {
+        metricsScreenWidth = GetScreenWidth();
+        metricsScreenHeight = GetScreenHeight();
+        songTextMetrics.clear();
     }
+    if (songTextMetrics.size() != TheSongList.catalog.size()) {
+        songTextMetrics.resize(TheSongList.catalog.size());
+    }
+    if (!songTextMetrics[songID].measured) {
+        ComputeSongTextMetrics(songID);
+    }
+    return songTextMetrics[songID];
 }
 
 void SongSelectMenu::UpdatePreviewVolume(double currentTime) {
@@ -217,28 +284,59 @@ void SongSelectMenu::Draw() {
     Units u = Units::getInstance();
 
     double curTime = GetTime();
-    // -5 -4 -3 -2 -1 0 1 2 3 4 5 6
-    if (pendingSongID >= 0 && curTime - selectionTime >= 0.75) {
-        if (pendingSongID < TheSongList.songs.size()) {
-            try {
-                TheAudioManager.loadStreams(TheSongList.songs[pendingSongID].stemsPath);
-                float previewStartTimeSec = TheSongList.songs[pendingSongID].previewStartTime / 1000.0f;
-                TheAudioManager.seekStreams(previewStartTimeSec);
-                TheAudioManager.playStreams();
-                for (int j = 0; j < TheAudioManager.loadedStreams.size(); j++) {
-                    float volume = 0.0f;
-                    if (j == PartVocals) volume = 0;
-                    TheAudioManager.SetAudioStreamVolume(TheAudioManager.loadedStreams[j].handle, volume);
-                }
-                previewStartTime = curTime;
-                phaseStartTime = curTime;
+    if (TheSongList.UpdateSearch()) {
+        TheSongList.SongSelectOffset = 1;
+    }
+    bool selectionMoved = false;
+    std::vector<int> editedSongs;
+    if (TheSongList.ApplyLibraryChanges(selectionMoved, editedSongs)) {
+        // Song IDs stay put, so only edited songs need measuring again; list
+        // positions from before are stale though
+        for (int id : editedSongs) {
+            if (id < (int)songTextMetrics.size()) {
+                songTextMetrics[id] = {};
+            }
+        }
+        if (selectionMoved && TheSongList.curSong) {
+            // The selected song was deleted and a neighbour took its place
+            if (!TheAudioManager.loadedStreams.empty()) {
+                TheAudioManager.unloadStreams();
                 currentPreviewVolume = 0.0f;
                 previewState = PreviewState::FadeIn;
-            } catch (const std::exception& e) {
-                TraceLog(LOG_ERROR, "Failed to load preview audio for song %d: %s", pendingSongID, e.what());
             }
+            pendingSongID = TheSongList.curSongID;
+            previewRequest++;
+            selectionTime = curTime;
+        } else if (pendingSongID >= 0) {
+            pendingSongID = TheSongList.curSongID;
+        }
+        animatingSongID = TheSongList.curSong ? TheSongList.curSong->songListPos - 1 : -1;
+        prevAnimatingSongID = -1;
+        if (TheSongList.SongSelectOffset > (int)TheSongList.listMenuEntries.size() - 10)
+            TheSongList.SongSelectOffset = (int)TheSongList.listMenuEntries.size() - 10;
+        if (TheSongList.SongSelectOffset < 1) TheSongList.SongSelectOffset = 1;
+    }
+    // -5 -4 -3 -2 -1 0 1 2 3 4 5 6
+    UpdatePreviewLoads();
+    if (pendingSongID >= 0 && curTime - selectionTime >= 0.75) {
+        // The stems are opened and seeked on the loader's thread; until they're ready
+        // this just keeps waiting
+        std::vector<Encore::AudioManager::AudioStream> streams;
+        if (!TheSongList.curSong || pendingSongID != TheSongList.curSongID) {
+            pendingSongID = -1;
+        } else if (previewLoader.Take(TheSongList.curSong->songDir.string(), streams)) {
+            TheAudioManager.unloadStreams();
+            TheAudioManager.loadedStreams = std::move(streams);
+            for (int j = 0; j < TheAudioManager.loadedStreams.size(); j++) {
+                TheAudioManager.SetAudioStreamVolume(TheAudioManager.loadedStreams[j].handle, 0.0f);
+            }
+            TheAudioManager.playStreams();
+            previewStartTime = curTime;
+            phaseStartTime = curTime;
+            currentPreviewVolume = 0.0f;
+            previewState = PreviewState::FadeIn;
+            pendingSongID = -1;
         }
-        pendingSongID = -1;
     }
 
     UpdatePreviewVolume(curTime);
@@ -260,14 +358,11 @@ void SongSelectMenu::Draw() {
     if (TheSongList.SongSelectOffset >= TheSongList.listMenuEntries.size() - 10)
         TheSongList.SongSelectOffset = TheSongList.listMenuEntries.size() - 10;
 
-    // todo(3drosalia): clean this shit up after changing it
-    Song SongToDisplayInfo = TheSongList.curSong ? *TheSongList.curSong : Song();
-    if (TheSongList.curSong) {
-        if (TheSongList.curSong->ini)
-            TheSongList.curSong->LoadInfoINI(TheSongList.curSong->songInfoPath);
-        else
-            TheSongList.curSong->LoadInfo(TheSongList.curSong->songInfoPath);
-    }
+    UpdateAlbumArt();
+
+    // The selected song was fully loaded by SelectSong(), so nothing is re-read here
+    static const Song noSong = Song();
+    const Song &SongToDisplayInfo = TheSongList.curSong ? *TheSongList.curSong : noSong;
 
     BeginDrawing();
     ClearBackground(DARKGRAY);
@@ -301,8 +396,8 @@ void SongSelectMenu::Draw() {
     );
     DrawTextEx(
         assets.josefinSansItalic,
-        TextFormat("Songs loaded: %01i", TheSongList.songs.size()),
-        { AlbumX - (AlbumOuter * 2) - MeasureTextEx(assets.josefinSansItalic, TextFormat("Songs loaded: %01i", TheSongList.songs.size()), u.hinpct(0.03f), 0).x, u.hinpct(0.165f) },
+        TextFormat("Songs loaded: %01i", (int)TheSongList.catalog.SongCount()),
+        { AlbumX - (AlbumOuter * 2) - MeasureTextEx(assets.josefinSansItalic, TextFormat("Songs loaded: %01i", (int)TheSongList.catalog.SongCount()), u.hinpct(0.03f), 0).x, u.hinpct(0.165f) },
         u.hinpct(0.03f),
         0,
         WHITE
@@ -366,7 +461,7 @@ void SongSelectMenu::Draw() {
             cumulativeYOffset += baseSongEntryHeight;
         } else if (!TheSongList.listMenuEntries[i].hiddenEntry) {
             Font& artistFont = isCurSong ? assets.josefinSansItalic : assets.josefinSansItalic;
-            Song& songi = TheSongList.songs[TheSongList.listMenuEntries[i].songListID];
+            const SongCatalog &catalog = TheSongList.catalog;
             int songID = TheSongList.listMenuEntries[i].songListID;
 
             float songXPos = u.LeftSide + u.winpct(0.005f) - 2;
@@ -378,35 +473,16 @@ void SongSelectMenu::Draw() {
             }
             if (GuiButton(Rectangle{ 0, songYPos, (u.RightSide - u.winpct(0.25f)), currentEntryHeight }, "")) {
                 prevAnimatingSongID = TheSongList.curSong ? TheSongList.curSong->songListPos - 1 : -1;
-                TheSongList.curSong = &TheSongList.songs[songID];
+                TheSongList.SelectSong(songID);
                 animatingSongID = i;
                 animationStartTime = curTime;
-                ComputeSongTextMetrics(*TheSongList.curSong);
                 if (!TheAudioManager.loadedStreams.empty()) {
-                    for (auto& stream : TheAudioManager.loadedStreams) {
-                        TheAudioManager.StopPlayback(stream.handle);
-                    }
-                    TheAudioManager.loadedStreams.clear();
+                    TheAudioManager.unloadStreams();
                     currentPreviewVolume = 0.0f;
                     previewState = PreviewState::FadeIn;
                 }
-                if (!TheSongList.songs[songID].ini) {
-                    TheSongList.songs[songID].LoadInfo(TheSongList.songs[songID].songInfoPath);
-                } else {
-                    TheSongList.songs[songID].LoadInfoINI(TheSongList.songs[songID].songInfoPath);
-                }
-                if (!TheSongList.songs[songID].AlbumArtLoaded) {
-                    try {
-                        TheSongList.songs[songID].LoadAlbumArt();
-                        TheSongList.songs[songID].AlbumArtLoaded = true;
-                        SetTextureWrap(TheSongList.songs[songID].albumArtBlur, TEXTURE_WRAP_REPEAT);
-                        SetTextureFilter(TheSongList.songs[songID].albumArtBlur, TEXTURE_FILTER_ANISOTROPIC_16X);
-                        TraceLog(LOG_DEBUG, "Loaded album art for %s", TheSongList.songs[songID].title.c_str());
-                    } catch (const std::exception& e) {
-                        TraceLog(LOG_ERROR, "Failed to load album art for %s: %s", TheSongList.songs[songID].title.c_str(), e.what());
-                    }
-                }
                 pendingSongID = songID;
+                previewRequest++;
                 selectionTime = curTime;
             }
             GuiSetStyle(BUTTON, BASE_COLOR_NORMAL, 0x181827FF);
@@ -415,25 +491,16 @@ void SongSelectMenu::Draw() {
             int songArtistWidth = (u.winpct(0.25f)) - 6;
             int songLengthWidth = (u.winpct(0.1f)) - 6;
 
-            float titleFontSize = u.hinpct(0.035f);
-            float artistFontSize = u.hinpct(0.025f);
-            if (songTextMetrics.find(songi.songListPos) != songTextMetrics.end()) {
-                titleFontSize = songTextMetrics[songi.songListPos].titleFontSize;
-                artistFontSize = songTextMetrics[songi.songListPos].artistFontSize;
-            } else {
-                ComputeSongTextMetrics(songi);
-                if (songTextMetrics.find(songi.songListPos) != songTextMetrics.end()) {
-                    titleFontSize = songTextMetrics[songi.songListPos].titleFontSize;
-                    artistFontSize = songTextMetrics[songi.songListPos].artistFontSize;
-                }
-            }
+            const TextMetrics &metrics = SongTextMetrics(songID);
+            float titleFontSize = metrics.titleFontSize;
+            float artistFontSize = metrics.artistFontSize;
 
             float textXOffset = 10;
 
             auto LightText = Color{ 203, 203, 203, 255 };
             DrawTextEx(
                 assets.rubikBold,
-                songi.title.c_str(),
+                catalog.CStr(songID, SongCatalog::Title),
                 { songXPos + textXOffset, songYPos + (currentEntryHeight - titleFontSize) / 2 },
                 titleFontSize,
                 0,
@@ -441,7 +508,7 @@ void SongSelectMenu::Draw() {
             );
             DrawTextEx(
                 artistFont,
-                songi.artist.c_str(),
+                catalog.CStr(songID, SongCatalog::Artist),
                 { songXPos + textXOffset + songTitleWidth, songYPos + (currentEntryHeight - artistFontSize) / 2 },
                 artistFontSize,
                 0,
@@ -449,7 +516,7 @@ void SongSelectMenu::Draw() {
             );
             DrawTextEx(
                 assets.josefinSansItalic,
-                SecondsToTimeFormat(songi.length).c_str(),
+                SecondsToTimeFormat(catalog.Length(songID)).c_str(),
                 { songXPos + textXOffset + songTitleWidth + songArtistWidth + 10, songYPos + (currentEntryHeight - u.hinpct(0.025f)) / 2 },
                 u.hinpct(0.025f),
                 0,
@@ -476,7 +543,7 @@ void SongSelectMenu::Draw() {
     } else {
         DrawRectangle(AlbumX - AlbumInner, AlbumY, AlbumHeight, AlbumHeight, DARKGRAY);
     }
-    if (TheSongList.SongSelectOffset > 0) {
+    if (TheSongList.SongSelectOffset > 0 && TheSongList.SongSelectOffset < TheSongList.listMenuEntries.size()) {
         std::string SongTitleForCharThingyThatsTemporary = "";
         int songIndex = TheSongList.SongSelectOffset;
         if (TheSongList.listMenuEntries[songIndex].isHeader && songIndex > 0 && !TheSongList.listMenuEntries[songIndex - 1].isHeader) {
@@ -488,21 +555,27 @@ void SongSelectMenu::Draw() {
         }
 
         if (songIndex < TheSongList.listMenuEntries.size() && !TheSongList.listMenuEntries[songIndex].isHeader) {
+            const SongCatalog &catalog = TheSongList.catalog;
+            int headerSongID = TheSongList.listMenuEntries[songIndex].songListID;
+            std::string_view title = catalog.Get(headerSongID, SongCatalog::Title);
+            std::string_view artist = catalog.Get(headerSongID, SongCatalog::Artist);
+            std::string_view source = catalog.Get(headerSongID, SongCatalog::Source);
+            std::string_view releaseYear = catalog.Get(headerSongID, SongCatalog::ReleaseYear);
             switch (currentSortValue) {
                 case SortType::Title:
-                    SongTitleForCharThingyThatsTemporary = TheSongList.songs[TheSongList.listMenuEntries[songIndex].songListID].title.empty() ? "#" : std::string(1, TheSongList.songs[TheSongList.listMenuEntries[songIndex].songListID].title[0]);
+                    SongTitleForCharThingyThatsTemporary = title.empty() ? "#" : std::string(1, title[0]);
                     break;
                 case SortType::Artist:
-                    SongTitleForCharThingyThatsTemporary = TheSongList.songs[TheSongList.listMenuEntries[songIndex].songListID].artist.empty() ? "#" : std::string(1, TheSongList.songs[TheSongList.listMenuEntries[songIndex].songListID].artist[0]);
+                    SongTitleForCharThingyThatsTemporary = artist.empty() ? "#" : std::string(1, artist[0]);
                     break;
                 case SortType::Source:
-                    SongTitleForCharThingyThatsTemporary = TheSongList.songs[TheSongList.listMenuEntries[songIndex].songListID].source.empty() ? "Unknown" : TheSongList.songs[TheSongList.listMenuEntries[songIndex].songListID].source;
+                    SongTitleForCharThingyThatsTemporary = source.empty() ? "Unknown" : std::string(source);
                     break;
                 case SortType::Length:
                     SongTitleForCharThingyThatsTemporary = TheSongList.listMenuEntries[TheSongList.SongSelectOffset].headerChar;
                     break;
                 case SortType::Year:
-                    SongTitleForCharThingyThatsTemporary = TheSongList.songs[TheSongList.listMenuEntries[songIndex].songListID].releaseYear.empty() ? "Unknown Year" : TheSongList.songs[TheSongList.listMenuEntries[songIndex].songListID].releaseYear;
+                    SongTitleForCharThingyThatsTemporary = releaseYear.empty() ? "Unknown Year" : std::string(releaseYear);
                     break;
                 default:
                     SongTitleForCharThingyThatsTemporary = "";
@@ -558,72 +631,45 @@ void SongSelectMenu::Draw() {
     GuiSetStyle(BUTTON, BASE_COLOR_NORMAL, ColorToInt(ColorBrightness(AccentColor, -0.25)));
     if (GuiButton(Rectangle{ u.LeftSide, GetScreenHeight() - u.hpct(0.1475f), u.winpct(0.2f), u.hinpct(0.05f) }, "Play Song")) {
         if (TheSongList.curSong) {
-            if (!TheSongList.curSong->ini) {
-                TheSongList.curSong->LoadSong(TheSongList.curSong->songInfoPath);
-            } else {
-                TheSongList.curSong->LoadSongIni(TheSongList.curSong->songDir);
-            }
-            if (!TheAudioManager.loadedStreams.empty()) {
-                for (auto& stream : TheAudioManager.loadedStreams) {
-                    TheAudioManager.StopPlayback(stream.handle);
-                }
-                TheAudioManager.loadedStreams.clear();
-            }
+            TheAudioManager.unloadStreams();
             TheMenuManager.SwitchScreen(READY_UP);
         }
     }
     GuiSetStyle(BUTTON, BASE_COLOR_NORMAL, 0x181827FF);
 
     if (GuiButton(Rectangle{ u.LeftSide + u.winpct(0.4f) - 2, GetScreenHeight() - u.hpct(0.1475f), u.winpct(0.2f), u.hinpct(0.05f) }, "Sort")) {
-        int selectedSongIndex = -1;
-        if (TheSongList.curSong) {
-            for (size_t i = 0; i < TheSongList.songs.size(); i++) {
-                if (&TheSongList.songs[i] == TheSongList.curSong) {
-                    selectedSongIndex = i;
-                    break;
-                }
-            }
-        }
+        int selectedSongIndex = TheSongList.curSong ? TheSongList.curSongID : -1;
         prevAnimatingSongID = TheSongList.curSong ? TheSongList.curSong->songListPos - 1 : -1;
         currentSortValue = NextSortType(currentSortValue);
         TheSongList.sortList(currentSortValue, selectedSongIndex);
-        if (selectedSongIndex >= 0 && selectedSongIndex < TheSongList.songs.size()) {
-            TheSongList.curSong = &TheSongList.songs[selectedSongIndex];
+        if (TheSongList.SelectSong(selectedSongIndex)) {
             TheSongList.SongSelectOffset = TheSongList.curSong->songListPos - 5;
             if (TheSongList.SongSelectOffset < 1) TheSongList.SongSelectOffset = 1;
             if (TheSongList.SongSelectOffset > TheSongList.listMenuEntries.size() - 10)
                 TheSongList.SongSelectOffset = TheSongList.listMenuEntries.size() - 10;
-            if (!TheSongList.curSong->AlbumArtLoaded) {
-                try {
-                    TheSongList.curSong->LoadAlbumArt();
-                    TheSongList.curSong->AlbumArtLoaded = true;
-                    SetTextureWrap(TheSongList.curSong->albumArtBlur, TEXTURE_WRAP_REPEAT);
-                    SetTextureFilter(TheSongList.curSong->albumArtBlur, TEXTURE_FILTER_ANISOTROPIC_16X);
-                } catch (const std::exception& e) {
-                }
-            }
             if (!TheAudioManager.loadedStreams.empty()) {
-                for (auto& stream : TheAudioManager.loadedStreams) {
-                    TheAudioManager.StopPlayback(stream.handle);
-                }
-                TheAudioManager.loadedStreams.clear();
+                TheAudioManager.unloadStreams();
                 currentPreviewVolume = 0.0f;
                 previewState = PreviewState::FadeIn;
             }
             pendingSongID = selectedSongIndex;
+            previewRequest++;
             selectionTime = curTime;
             animatingSongID = TheSongList.curSong->songListPos - 1;
             animationStartTime = curTime;
-            ComputeSongTextMetrics(*TheSongList.curSong);
         }
     }
+    if (GuiTextBox(Rectangle{ u.LeftSide + u.winpct(0.6f) - 3, GetScreenHeight() - u.hpct(0.1475f), u.winpct(0.2f), u.hinpct(0.05f) }, searchText, sizeof(searchText), searchEditing)) {
+        searchEditing = !searchEditing;
+    }
+    if (TheSongList.SearchQuery() != searchText) {
+        TheSongList.SetSearchQuery(searchText);
+        TheSongList.SongSelectOffset = 1;
+        animatingSongID = TheSongList.curSong ? TheSongList.curSong->songListPos - 1 : -1;
+        prevAnimatingSongID = -1;
+    }
     if (GuiButton(Rectangle{ u.LeftSide + u.winpct(0.2f) - 1, GetScreenHeight() - u.hpct(0.1475f), u.winpct(0.2f), u.hinpct(0.05f) }, "Back")) {
-        if (!TheAudioManager.loadedStreams.empty()) {
-            for (auto& stream : TheAudioManager.loadedStreams) {
-                TheAudioManager.StopPlayback(stream.handle);
-            }
-            TheAudioManager.loadedStreams.clear();
-        }
+        TheAudioManager.unloadStreams();
         TheMenuManager.SwitchScreen(MAIN_MENU);
     }
     DrawOvershell();
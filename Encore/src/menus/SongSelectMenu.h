@@ -7,8 +7,9 @@
 #include "OvershellMenu.h"
 #include "uiUnits.h"
 #include "song/song.h"
+#include "song/previewloader.h"
 #include <filesystem>
-#include <map>
+#include <vector>
 
 class SongSelectMenu : public OvershellMenu {
 public:
@@ -40,15 +41,37 @@ private:
     int pendingSongID = -1;
     double selectionTime = 0.0;
     double seekPendingTime = -1.0;
+    char searchText[128] = "";
+    bool searchEditing = false;
     struct TextMetrics {
         float titleFontSize;
         float artistFontSize;
         float titleTextWidth;
         float artistTextWidth;
+        bool measured = false;
     };
-    std::map<int, TextMetrics> songTextMetrics;
+    // Indexed by song ID and filled in as rows are drawn. Fonts are sized off the
+    // window, so a resize throws them all away.
+    std::vector<TextMetrics> songTextMetrics;
+    int metricsScreenWidth = 0;
+    int metricsScreenHeight = 0;
 
-    void ComputeSongTextMetrics(Song& song);
+    Encore::PreviewLoader previewLoader;
+    // Bumped whenever a preview is asked for, since Take() drops the song from the
+    // loader and a repeat request for the same song has to point it back
+    int previewRequest = 0;
+    // The song ID and request previewLoader was last pointed at
+    int previewWantedID = -1;
+    int previewWantedRequest = -1;
+
+    void ComputeSongTextMetrics(int songID);
+    // Metrics for one row, measuring it the first time it's drawn
+    const TextMetrics &SongTextMetrics(int songID);
+    // Points previewLoader at the selected song and its neighbours when the selection
+    // changes or a preview is asked for again
+    void UpdatePreviewLoads();
+    // Prefetches art around the selected song and shows its art once it's uploaded
+    void UpdateAlbumArt();
     static void DrawAlbumArtBackgroundPro(const Texture2D& texture, const Rectangle sourceRect) {
         Units u = Units::getInstance();
         if (IsTextureValid(texture)) {
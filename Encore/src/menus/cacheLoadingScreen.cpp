@@ -45,6 +45,7 @@ bool started = false;
 void LoadCache() {
     SongList &list = TheSongList;
     list.LoadCache(TheGameSettings.SongPaths);
+    list.StartWatching();
     finished = true;
 }
 
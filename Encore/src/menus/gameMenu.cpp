@@ -185,15 +185,23 @@ void MainMenu::ChooseSplashText(std::filesystem::path directory) {
 }
 
 void MainMenu::PickRandomMenuSong() {
-    if (std::filesystem::exists("songCache.encr") && TheSongList.songs.size() > 0) {
+    if (!TheSongList.catalog.empty()) {
         AlbumArtBackground = menuAss.highwayTexture;
 
+        int my = GetRandomValue(0, (int)TheSongList.catalog.size() - 1);
+        // Songs deleted while the game runs leave empty IDs behind
+        while (TheSongList.catalog.IsRemoved(my)) {
+            my = (my + 1) % (int)TheSongList.catalog.size();
+        }
+        // Loads the song's info, stems and chart summary
+        TheSongList.SelectSong(my);
         try {
-            int my = GetRandomValue(0, (int)TheSongList.songs.size() - 1);
-            TheSongList.curSong = &TheSongList.songs[my];
             // ChosenSongInt = my;
 
-            TheSongList.curSong->LoadAlbumArt();
+            if (!TheSongList.curSong->AlbumArtLoaded) {
+                TheSongList.curSong->LoadAlbumArt();
+                TheSongList.curSong->AlbumArtLoaded = true;
+            }
             AlbumArtBackground = TheSongList.curSong->albumArtBlur;
             TraceLog(LOG_INFO, TheSongList.curSong->title.c_str());
             songChosen = true;
@@ -203,10 +211,6 @@ void MainMenu::PickRandomMenuSong() {
             AlbumArtBackground = menuAss.highwayTexture;
         };
 
-        if (TheSongList.curSong->ini)
-            TheSongList.curSong->LoadAudioINI(TheSongList.curSong->songDir);
-        else
-            TheSongList.curSong->LoadAudio(TheSongList.curSong->songInfoPath);
         TheAudioManager.loadStreams(TheSongList.curSong->stemsPath);
         streamsLoaded = true;
         for (int i = 0; i < TheAudioManager.loadedStreams.size(); i++) {
@@ -361,7 +365,7 @@ void MainMenu::MainMenuScreen() {
     if (GuiButton({ 0, u.hpct(0.8f), u.LeftSide + SplashWidth, u.hpct(0.05f) }, "")) {
         ChooseSplashText(directory);
     }
-    if (!TheSongList.songs.empty()) {
+    if (!TheSongList.catalog.empty()) {
         if (ThePlayerManager.PlayersActive != 0) {
             if (GuiButton(
                     { u.wpct(0.02f), u.hpct(0.3f), u.winpct(0.2f), u.hinpct(0.08f) },
@@ -370,14 +374,6 @@ void MainMenu::MainMenuScreen() {
                 TheAudioManager.unloadStreams();
                 streamsLoaded = false;
                 streamsPaused = false;
-                for (Song &songi : TheSongList.songs) {
-                    songi.titleScrollTime = GetTime();
-                    songi.titleTextWidth =
-                        menuAss.MeasureTextRubik(songi.title.c_str(), 24);
-                    songi.artistScrollTime = GetTime();
-                    songi.artistTextWidth =
-                        menuAss.MeasureTextRubik(songi.artist.c_str(), 20);
-                }
                 TheMenuManager.SwitchScreen(SONG_SELECT);
             }
         } else {
@@ -0,0 +1,310 @@
+#include "artcache.h"
+
+#include <algorithm>
+#include <atomic>
+#include <climits>
+#include <cstdio>
+#include <filesystem>
+#include <functional>
+#include "util/enclog.h"
+#include "util/file-stamp.h"
+#include "util/image-blur.h"
+
+namespace {
+    // Cache files without the extension, or an empty path if the art doesn't exist
+    std::filesystem::path AlbumArtCacheBase(const std::string &artPath) {
+        Encore::FileStamp stamp;
+        if (!Encore::GetFileStamp(artPath, stamp)) {
+            return {};
+        }
+        // FNV-1a over the path, size and mtime
+        uint64_t hash = 0xcbf29ce484222325ull;
+        auto mix = [&hash](const void *data, size_t size) {
+            for (size_t i = 0; i < size; i++) {
+                hash = (hash ^ ((const uint8_t *)data)[i]) * 0x100000001b3ull;
+            }
+        };
+        mix(artPath.data(), artPath.size());
+        mix(&stamp.size, sizeof(stamp.size));
+        mix(&stamp.modified, sizeof(stamp.modified));
+        char name[17];
+        std::snprintf(name, sizeof(name), "%016llx", (unsigned long long)hash);
+        return std::filesystem::path(ALBUM_ART_CACHE_DIR) / name;
+    }
+
+    bool LoadCachedImage(const std::filesystem::path &path, Image &image) {
+        if (!std::filesystem::exists(path)) {
+            return false;
+        }
+        image = LoadImage(path.string().c_str());
+        return image.data != nullptr;
+    }
+
+    // Exported next to the real name and renamed over it, so a half written file is
+    // never picked up. The temp name is unique to the call, since the decoder and the
+    // main thread, or two copies of the game, can be writing the same cover at once.
+    bool SaveCachedImage(const std::filesystem::path &path, const Image &image) {
+        static std::atomic<uint32_t> saveCounter = 0;
+        char suffix[48];
+        std::snprintf(
+            suffix, sizeof(suffix), ".%zx-%x.tmp.qoi",
+            std::hash<std::thread::id>()(std::this_thread::get_id()), (unsigned)saveCounter++
+        );
+        std::filesystem::path tempPath = path;
+        tempPath.replace_extension(suffix);
+        if (!ExportImage(image, tempPath.string().c_str())) {
+            return false;
+        }
+        std::error_code ec;
+        std::filesystem::rename(tempPath, path, ec);
+        if (ec) {
+            std::filesystem::remove(tempPath, ec);
+            return false;
+        }
+        return true;
+    }
+}
+
+bool LoadCachedAlbumArt(const std::string &artPath, Image &art, Image &blur) {
+    art = {};
+    blur = {};
+    std::filesystem::path base = AlbumArtCacheBase(artPath);
+    if (base.empty()) {
+        return false;
+    }
+    std::filesystem::path artCachePath = base;
+    artCachePath += ".qoi";
+    std::filesystem::path blurCachePath = base;
+    blurCachePath += "-blur.qoi";
+
+    if (LoadCachedImage(artCachePath, art)) {
+        if (LoadCachedImage(blurCachePath, blur)) {
+            return true;
+        }
+        UnloadImage(art);
+        art = {};
+    }
+
+    art = LoadImage(artPath.c_str());
+    if (art.data == nullptr) {
+        return false;
+    }
+    if (art.height > ALBUM_ART_SIZE) {
+        ImageResize(&art, ALBUM_ART_SIZE, ALBUM_ART_SIZE);
+    }
+    // QOI only stores 8-bit RGB(A)
+    ImageFormat(&art, PIXELFORMAT_UNCOMPRESSED_R8G8B8A8);
+    blur = ImageCopy(art);
+    Encore::BlurRGBA8(
+        (uint8_t *)blur.data, blur.width, blur.height,
+        Encore::GaussianSigmaForBlurSize(ALBUM_ART_BLUR_RADIUS)
+    );
+
+    std::error_code ec;
+    std::filesystem::create_directories(ALBUM_ART_CACHE_DIR, ec);
+    if (!SaveCachedImage(artCachePath, art) || !SaveCachedImage(blurCachePath, blur)) {
+        Encore::EncoreLogFormat(LOG_WARNING, "ART: Failed to cache album art for %s", artPath.c_str());
+    }
+    return true;
+}
+
+// The whole prefetch window has to fit, or covers would be evicted as they arrive and
+// decoded again forever
+static_assert(ALBUM_ART_TEXTURE_LIMIT > 2 * ALBUM_ART_PREFETCH_RADIUS + 1);
+
+AlbumArtCache::~AlbumArtCache() {
+    // The window is gone by now, so textures are left to the driver
+    StopDecoder();
+}
+
+void AlbumArtCache::StopDecoder() {
+    {
+        std::lock_guard lock(mutex);
+        stopping = true;
+        queue.clear();
+    }
+    wake.notify_all();
+    if (decoder.joinable()) {
+        decoder.join();
+    }
+    for (auto &image : decoded) {
+        UnloadImage(image.art);
+        UnloadImage(image.blur);
+    }
+    decoded.clear();
+}
+
+void AlbumArtCache::DecodeLoop() {
+    std::unique_lock lock(mutex);
+    while (true) {
+        wake.wait(lock, [this] { return stopping || !queue.empty(); });
+        if (stopping) {
+            return;
+        }
+        decoding = std::move(queue.front());
+        queue.pop_front();
+        lock.unlock();
+
+        Decoded image;
+        image.path = decoding;
+        // A cover that can't be loaded still comes back, empty, so it isn't retried
+        LoadCachedAlbumArt(image.path, image.art, image.blur);
+
+        lock.lock();
+        decoded.push_back(std::move(image));
+        decoding.clear();
+        decodeDone.notify_all();
+    }
+}
+
+AlbumArtTextures &AlbumArtCache::Insert(const std::string &path, Image &art, Image &blur) {
+    Resident &entry = resident[path];
+    if (art.data != nullptr) {
+        entry.textures.art = LoadTextureFromImage(art);
+        GenTextureMipmaps(&entry.textures.art);
+        SetTextureFilter(entry.textures.art, TEXTURE_FILTER_TRILINEAR);
+    }
+    if (blur.data != nullptr) {
+        entry.textures.blur = LoadTextureFromImage(blur);
+        GenTextureMipmaps(&entry.textures.blur);
+        SetTextureFilter(entry.textures.blur, TEXTURE_FILTER_TRILINEAR);
+    }
+    UnloadImage(art);
+    UnloadImage(blur);
+    art = {};
+    blur = {};
+    entry.lastUsed = ++useCounter;
+    return entry.textures;
+}
+
+void AlbumArtCache::Evict() {
+    while (resident.size() > ALBUM_ART_TEXTURE_LIMIT) {
+        auto victim = resident.end();
+        int victimDistance = -1;
+        for (auto it = resident.begin(); it != resident.end(); ++it) {
+            if (it->first == pinned) {
+                continue;
+            }
+            auto want = wanted.find(it->first);
+            int distance = want == wanted.end() ? INT_MAX : want->second;
+            if (distance > victimDistance
+                || (distance == victimDistance && it->second.lastUsed < victim->second.lastUsed)) {
+                victim = it;
+                victimDistance = distance;
+            }
+        }
+        if (victim == resident.end()) {
+            return;
+        }
+        UnloadTexture(victim->second.textures.art);
+        UnloadTexture(victim->second.textures.blur);
+        resident.erase(victim);
+    }
+}
+
+const AlbumArtTextures &AlbumArtCache::Acquire(const std::string &artPath) {
+    pinned = artPath;
+    if (auto it = resident.find(artPath); it != resident.end()) {
+        it->second.lastUsed = ++useCounter;
+        return it->second.textures;
+    }
+
+    // Already decoded by the prefetcher but not uploaded yet. If it's decoding this
+    // cover right now, waiting for it beats decoding, resizing and blurring it twice.
+    Decoded image;
+    {
+        std::unique_lock lock(mutex);
+        decodeDone.wait(lock, [&] { return decoding != artPath; });
+        auto ready = std::find_if(decoded.begin(), decoded.end(), [&](const Decoded &d) {
+            return d.path == artPath;
+        });
+        if (ready != decoded.end()) {
+            image = std::move(*ready);
+            decoded.erase(ready);
+        }
+    }
+    if (image.path.empty()) {
+        LoadCachedAlbumArt(artPath, image.art, image.blur);
+    }
+    AlbumArtTextures &textures = Insert(artPath, image.art, image.blur);
+    Evict();
+    return textures;
+}
+
+const AlbumArtTextures *AlbumArtCache::Find(const std::string &artPath) {
+    auto it = resident.find(artPath);
+    if (it == resident.end()) {
+        return nullptr;
+    }
+    it->second.lastUsed = ++useCounter;
+    return &it->second.textures;
+}
+
+void AlbumArtCache::Prefetch(const std::vector<std::string> &artPaths) {
+    wanted.clear();
+    std::vector<std::string> missing;
+    for (const auto &path : artPaths) {
+        if (path.empty() || !wanted.emplace(path, (int)wanted.size()).second) {
+            continue;
+        }
+        if (!resident.contains(path)) {
+            missing.push_back(path);
+        }
+    }
+    {
+        std::lock_guard lock(mutex);
+        // Anything left from the last call is further from the cursor than these
+        queue.clear();
+        for (auto &path : missing) {
+            bool pending = path == decoding
+                || std::any_of(decoded.begin(), decoded.end(), [&](const Decoded &d) {
+                       return d.path == path;
+                   });
+            if (!pending) {
+                queue.push_back(std::move(path));
+            }
+        }
+        if (queue.empty()) {
+            return;
+        }
+        if (!decoder.joinable()) {
+            stopping = false;
+            decoder = std::thread(&AlbumArtCache::DecodeLoop, this);
+        }
+    }
+    wake.notify_one();
+}
+
+void AlbumArtCache::UploadDecoded(double budget) {
+    double start = GetTime();
+    while (GetTime() - start < budget) {
+        Decoded image;
+        {
+            std::lock_guard lock(mutex);
+            if (decoded.empty()) {
+                return;
+            }
+            image = std::move(decoded.front());
+            decoded.erase(decoded.begin());
+        }
+        // Scrolled past before it finished; not worth the GPU memory
+        if (resident.contains(image.path) || !wanted.contains(image.path)) {
+            UnloadImage(image.art);
+            UnloadImage(image.blur);
+            continue;
+        }
+        Insert(image.path, image.art, image.blur);
+        Evict();
+    }
+}
+
+void AlbumArtCache::Shutdown() {
+    StopDecoder();
+    for (auto &[path, entry] : resident) {
+        UnloadTexture(entry.textures.art);
+        UnloadTexture(entry.textures.blur);
+    }
+    resident.clear();
+    wanted.clear();
+    pinned.clear();
+}
@@ -0,0 +1,98 @@
+#pragma once
+
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+#include "raylib.h"
+
+/*
+ * Album art thumbnail cache: artCache/<hash>.qoi holds a song's cover already scaled to
+ * at most 512px, and artCache/<hash>-blur.qoi the blurred copy used for backgrounds.
+ * The hash covers the art path and its size/mtime, so replacing the image gives it new
+ * files. QOI decodes several times faster than PNG or JPG, so after the first view a
+ * song's art costs one small file read each instead of a decode, resize and blur.
+ */
+
+#define ALBUM_ART_CACHE_DIR "artCache"
+#define ALBUM_ART_SIZE 512
+#define ALBUM_ART_BLUR_RADIUS 10
+// Songs on each side of the cursor whose art is decoded ahead of time
+#define ALBUM_ART_PREFETCH_RADIUS 6
+// Covers kept on the GPU at once, each a cover plus its blur
+#define ALBUM_ART_TEXTURE_LIMIT 16
+// Seconds per frame spent uploading prefetched art
+#define ALBUM_ART_UPLOAD_BUDGET 0.002
+
+/// Loads the cover and its blurred background for artPath, from the cache if it has
+/// them and otherwise by decoding the original and caching the result. Both images
+/// are RGBA and owned by the caller. Returns false (with both images empty) if the art
+/// can't be loaded at all. Doesn't touch the GPU.
+bool LoadCachedAlbumArt(const std::string &artPath, Image &art, Image &blur);
+
+struct AlbumArtTextures {
+    Texture art {};
+    Texture blur {};
+};
+
+/*
+ * Owns every album art texture. Menus prefetch the art around the cursor, which a
+ * background thread decodes (from the thumbnail cache when it can) and the main thread
+ * uploads a few at a time, so scrolling never waits on an image. Past
+ * ALBUM_ART_TEXTURE_LIMIT covers, the ones furthest from the cursor are unloaded; the
+ * last acquired cover is never unloaded, since the selected Song draws it.
+ */
+class AlbumArtCache {
+    struct Resident {
+        AlbumArtTextures textures;
+        uint64_t lastUsed = 0;
+    };
+    struct Decoded {
+        std::string path;
+        Image art {};
+        Image blur {};
+    };
+
+    // Main thread only
+    std::unordered_map<std::string, Resident> resident;
+    // Distance from the cursor of each path in the last Prefetch()
+    std::unordered_map<std::string, int> wanted;
+    std::string pinned;
+    uint64_t useCounter = 0;
+
+    // Shared with the decoder
+    std::mutex mutex;
+    std::condition_variable wake;
+    // Signalled each time the decoder finishes a cover
+    std::condition_variable decodeDone;
+    std::deque<std::string> queue;
+    std::string decoding;
+    std::vector<Decoded> decoded;
+    bool stopping = false;
+    std::thread decoder;
+
+    void DecodeLoop();
+    void StopDecoder();
+    AlbumArtTextures &Insert(const std::string &path, Image &art, Image &blur);
+    void Evict();
+
+public:
+    ~AlbumArtCache();
+
+    /// The textures for artPath, decoding and uploading them right away if they aren't
+    /// resident yet. Pins them until another cover is acquired.
+    const AlbumArtTextures &Acquire(const std::string &artPath);
+    /// The textures for artPath if they're already on the GPU, otherwise nullptr.
+    const AlbumArtTextures *Find(const std::string &artPath);
+    /// Replaces the decode queue with the given paths, nearest to the cursor first.
+    void Prefetch(const std::vector<std::string> &artPaths);
+    /// Uploads decoded art until budget seconds have passed. Call once per frame.
+    void UploadDecoded(double budget);
+    /// Stops the decoder and unloads every texture. Call before closing the window.
+    void Shutdown();
+};
+
+extern AlbumArtCache TheAlbumArtCache;
@@ -79,19 +79,24 @@ std::string Encore::AudioManager::GetStreamStatus(unsigned int handle) const {
 }
 
 
-void Encore::AudioManager::loadStreams(std::vector<std::pair<std::string, int> > &paths) {
-    int streams = 0;
+bool Encore::AudioManager::OpenStreams(
+    const std::vector<std::pair<std::string, int> > &paths,
+    std::vector<AudioStream> &streams,
+    const std::function<bool()> &cancelled
+) {
+    size_t first = streams.size();
     for (auto &path : paths) {
+        if (cancelled && cancelled()) {
+            return false;
+        }
         HSTREAM streamHandle = BASS_StreamCreateFile(false, path.first.c_str(), 0, 0, 0);
         if (streamHandle) {
             AudioStream audio_stream;
             audio_stream.handle = streamHandle;
             audio_stream.instrument = path.second;
-            loadedStreams.push_back(std::move(audio_stream));
-            if (streams != 0) {
-                BASS_ChannelSetLink(
-                    loadedStreams[0].handle, loadedStreams[streams].handle
-                );
+            streams.push_back(std::move(audio_stream));
+            if (streams.size() > first + 1) {
+                BASS_ChannelSetLink(streams[first].handle, streamHandle);
                 if (BASS_ChannelFlags(streamHandle, 0, 0) & BASS_SAMPLE_LOOP) // looping
                                                                               // is
                                                                               // currently
@@ -99,25 +104,41 @@ void Encore::AudioManager::loadStreams(std::vector<std::pair<std::string, int> >
                     BASS_ChannelFlags(streamHandle, 0, BASS_SAMPLE_LOOP); // remove the
                                                                           // LOOP flag
             }
-            streams++;
         } else {
             CHECK_BASS_ERROR2();
             std::cerr << "Failed to load stream: " << path.first << std::endl;
         }
     }
+    return true;
 }
 
-void Encore::AudioManager::unloadStreams() {
-    if (!loadedStreams.empty()) {
-        for (auto &stream : loadedStreams) {
-            StopPlayback(stream.handle);
-            BASS_StreamFree(stream.handle);
+void Encore::AudioManager::SeekStreams(const std::vector<AudioStream> &streams, double time) {
+    if (!streams.empty()) {
+        BASS_ChannelPause(streams[0].handle);
+        for (auto &stream : streams) {
+
+            int rewindTimeBytes = BASS_ChannelSeconds2Bytes(stream.handle, time);
+            BASS_ChannelSetPosition(stream.handle, rewindTimeBytes, BASS_POS_BYTE);
         }
-        loadedStreams = {};
-        loadedStreams.clear();
     }
 }
 
+void Encore::AudioManager::FreeStreams(std::vector<AudioStream> &streams) {
+    for (auto &stream : streams) {
+        StopPlayback(stream.handle);
+        BASS_StreamFree(stream.handle);
+    }
+    streams.clear();
+}
+
+void Encore::AudioManager::loadStreams(std::vector<std::pair<std::string, int> > &paths) {
+    OpenStreams(paths, loadedStreams);
+}
+
+void Encore::AudioManager::unloadStreams() {
+    FreeStreams(loadedStreams);
+}
+
 void Encore::AudioManager::pauseStreams() const {
     if (!loadedStreams.empty()) {
         for (auto stream : loadedStreams) {
@@ -143,14 +164,7 @@ void Encore::AudioManager::restartStreams() const {
     }
 }
 void Encore::AudioManager::seekStreams(double time) const {
-    if (!loadedStreams.empty()) {
-        BASS_ChannelPause(loadedStreams[0].handle);
-        for (auto &stream : loadedStreams) {
-
-            int rewindTimeBytes = BASS_ChannelSeconds2Bytes(stream.handle, time);
-            BASS_ChannelSetPosition(stream.handle, rewindTimeBytes, BASS_POS_BYTE);
-        }
-    }
+    SeekStreams(loadedStreams, time);
 }
 
 void Encore::AudioManager::unpauseStreams() const {
@@ -2,6 +2,7 @@
 
 #include <vector>
 #include <filesystem>
+#include <functional>
 #include <unordered_map>
 #include <string>
 namespace Encore {
@@ -17,6 +18,17 @@ namespace Encore {
         // Initialize the audio manager
         static bool Init();
 
+        // Opens the stems as one set, with the rest linked to the first so they play in
+        // sync. Stops early, returning false, once cancelled() says so. Safe to call from
+        // worker threads.
+        static bool OpenStreams(
+            const std::vector<std::pair<std::string, int> > &paths,
+            std::vector<AudioStream> &streams,
+            const std::function<bool()> &cancelled = {}
+        );
+        static void SeekStreams(const std::vector<AudioStream> &streams, double time);
+        static void FreeStreams(std::vector<AudioStream> &streams);
+
         // Load and manage audio streams
         void loadStreams(std::vector<std::pair<std::string, int> > &paths);
         void unloadStreams();
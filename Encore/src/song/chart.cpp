@@ -7,29 +7,30 @@
 #include "raylib.h"
 #include "song.h"
 
-void Chart::parseNotes(
-    smf::MidiFile &midiFile,
-    int trkidx,
-    smf::MidiEventList events,
-    int diff,
-    int instrument
-) {
+void Chart::parseNotes(MidiTrackView events, int diff, int instrument) {
     std::vector<bool> notesOn { false, false, false, false, false };
     bool odOn = false;
     bool soloOn = false;
     std::vector<double> noteOnTime { 0.0, 0.0, 0.0, 0.0, 0.0 };
     std::vector<int> noteOnTick { 0, 0, 0, 0, 0 };
+    // Index of the note each held lane started, for its note-off
+    std::vector<int> noteOnIdx { -1, -1, -1, -1, -1 };
     std::vector<int> notePitches = diffNotes[diff];
     int odNote = 116;
+    NoteLookup lookup;
+    lookup.Reserve(notes.size() + events.getSize() / 2);
+    for (int i = 0; i < notes.size(); i++) {
+        lookup.Add(notes[i].time, notes[i].lane, i);
+    }
     int curODPhrase = -1;
     int curSolo = -1;
     int curBPM = 0;
 
-    resolution = midiFile.getTicksPerQuarterNote();
+    resolution = events.TicksPerQuarterNote();
     for (int i = 0; i < events.getSize(); i++) {
         if (events[i].isNoteOn()) {
-            double time = midiFile.getTimeInSeconds(trkidx, i);
-            int tick = midiFile.getAbsoluteTickTime(time);
+            double time = events.Seconds(i);
+            int tick = events.TickAt(time);
             if ((int)events[i][1] >= notePitches[0]
                 && (int)events[i][1] <= notePitches[1]) {
                 int lane = (int)events[i][1] - notePitches[0];
@@ -37,7 +38,7 @@ void Chart::parseNotes(
                     noteOnTime[lane] = time;
                     noteOnTick[lane] = tick;
                     notesOn[lane] = true;
-                    int noteIdx = findNoteIdx(time, lane);
+                    int noteIdx = lookup.Find(time, lane);
                     if (noteIdx != -1) {
                         notes[noteIdx].valid = true;
                     } else {
@@ -45,13 +46,16 @@ void Chart::parseNotes(
                         newNote.time = time;
                         newNote.lane = lane;
                         newNote.valid = true;
+                        noteIdx = notes.size();
+                        lookup.Add(time, lane, noteIdx);
                         notes.push_back(newNote);
                     }
+                    noteOnIdx[lane] = noteIdx;
                 }
             } else if ((int)events[i][1] >= notePitches[2]
                        && (int)events[i][1] <= notePitches[3]) {
                 int lane = (int)events[i][1] - notePitches[2];
-                int noteIdx = findNoteIdx(time, lane);
+                int noteIdx = lookup.Find(time, lane);
                 if (noteIdx != -1) {
                     notes[noteIdx].lift = true;
                 } else {
@@ -60,6 +64,7 @@ void Chart::parseNotes(
                     newNote.valid = false;
                     newNote.lane = lane;
                     newNote.lift = true;
+                    lookup.Add(time, lane, notes.size());
                     notes.push_back(newNote);
                 }
             } else if ((int)events[i][1] == odNote) {
@@ -83,16 +88,16 @@ void Chart::parseNotes(
                 }
             }
         } else if (events[i].isNoteOff()) {
-            double time = midiFile.getTimeInSeconds(trkidx, i);
-            int tick = midiFile.getAbsoluteTickTime(time);
+            double time = events.Seconds(i);
+            int tick = events.TickAt(time);
             if ((int)events[i][1] >= notePitches[0]
                 && (int)events[i][1] <= notePitches[1]) {
                 int lane = (int)events[i][1] - notePitches[0];
                 if (notesOn[lane] == true) {
-                    int noteIdx = findNoteIdx(noteOnTime[lane], lane);
+                    int noteIdx = noteOnIdx[lane];
                     if (noteIdx != -1) {
                         notes[noteIdx].beatsLen = (tick - noteOnTick[lane])
-                            / (float)midiFile.getTicksPerQuarterNote();
+                            / (float)events.TicksPerQuarterNote();
                         if (notes[noteIdx].beatsLen > 0.25) {
                             notes[noteIdx].len = time - notes[noteIdx].time;
                         } else {
@@ -102,6 +107,7 @@ void Chart::parseNotes(
                     }
                     noteOnTick[lane] = 0;
                     noteOnTime[lane] = 0;
+                    noteOnIdx[lane] = -1;
                     notesOn[lane] = false;
                 }
             } else if ((int)events[i][1] == odNote) {
@@ -119,9 +125,7 @@ void Chart::parseNotes(
             }
         }
     }
-    Encore::EncoreLog(
-        LOG_DEBUG, TextFormat("ENC: Processed base notes for %01i", instrument)
-    );
+    Encore::EncoreLogFormat(LOG_DEBUG, "ENC: Processed base notes for %01i", instrument);
 
     curODPhrase = 0;
     if (overdrive.events.size() > 0) {
@@ -135,9 +139,7 @@ void Chart::parseNotes(
                 overdrive[curODPhrase].NoteCount++;
         }
     }
-    Encore::EncoreLog(
-        LOG_DEBUG, TextFormat("ENC: Processed overdrive for %01i", instrument)
-    );
+    Encore::EncoreLogFormat(LOG_DEBUG, "ENC: Processed overdrive for %01i", instrument);
 
     curSolo = 0;
     if (solos.events.size() > 0) {
@@ -150,43 +152,41 @@ void Chart::parseNotes(
                 solos[curSolo].NoteCount++;
         }
     }
-    Encore::EncoreLog(LOG_DEBUG, TextFormat("ENC: Processed solos for %01i", instrument));
+    Encore::EncoreLogFormat(LOG_DEBUG, "ENC: Processed solos for %01i", instrument);
     int mult = 1;
     int multCtr = 0;
     int noteIdx = 0;
     bool isBassOrVocal = (instrument == 1 || instrument == 3);
-    for (auto it = notes.begin(); it != notes.end();) {
-        LoadingState = BASE_SCORE;
-        Note &note = *it;
+    LoadingState = BASE_SCORE;
+    for (Note &note : notes) {
         if (!note.valid) {
-            it = notes.erase(it);
-        } else {
-            baseScore += (36 * mult);
-            baseScore += (note.beatsLen * 12) * mult;
-            if (noteIdx == 9)
-                mult = 2;
-            else if (noteIdx == 19)
-                mult = 3;
-            else if (noteIdx == 29)
-                mult = 4;
-            else if (noteIdx == 39 && isBassOrVocal)
-                mult = 5;
-            else if (noteIdx == 49 && isBassOrVocal)
-                mult = 6;
-            noteIdx++;
-            ++it;
+            continue;
         }
+        baseScore += (36 * mult);
+        baseScore += (note.beatsLen * 12) * mult;
+        if (noteIdx == 9)
+            mult = 2;
+        else if (noteIdx == 19)
+            mult = 3;
+        else if (noteIdx == 29)
+            mult = 4;
+        else if (noteIdx == 39 && isBassOrVocal)
+            mult = 5;
+        else if (noteIdx == 49 && isBassOrVocal)
+            mult = 6;
+        noteIdx++;
     }
-    Encore::EncoreLog(
-        LOG_DEBUG, TextFormat("ENC: Processed base score for %01i", instrument)
-    );
+    // Lifts with no note under them. Erasing them one by one is quadratic on charts
+    // with a lot of them.
+    std::erase_if(notes, [](const Note &note) { return !note.valid; });
+    Encore::EncoreLogFormat(LOG_DEBUG, "ENC: Processed base score for %01i", instrument);
 
     LoadingState = NOTE_SORTING;
     std::sort(notes.begin(), notes.end(), compareNotes);
-    Encore::EncoreLog(LOG_DEBUG, TextFormat("ENC: Processed notes for %01i", instrument));
+    Encore::EncoreLogFormat(LOG_DEBUG, "ENC: Processed notes for %01i", instrument);
 }
 void Chart::parsePlasticNotes(
-    smf::MidiFile &midiFile, int trkidx, int diff, int instrument, int hopoThresh
+    MidiTrackView events, int diff, int instrument, int hopoThresh
 ) {
     std::vector<forceOnPhrase> forcedOnPhrases;
     std::vector<tapPhrase> tapPhrases;
@@ -201,9 +201,14 @@ void Chart::parsePlasticNotes(
     std::vector<double> noteOnTime { 0.0, 0.0, 0.0, 0.0, 0.0 };
     std::vector<int> noteOnTick { 0, 0, 0, 0, 0 };
     std::vector<bool> notesOn { false, false, false, false, false };
+    // Index of the note each held lane's note-off applies to
+    std::vector<int> noteOnIdx { -1, -1, -1, -1, -1 };
 
-    midiFile.linkNotePairs();
-    smf::MidiEventList events = midiFile[trkidx];
+    NoteLookup lookup;
+    lookup.Reserve(notesPre.size() + events.getSize() / 2);
+    for (int i = 0; i < notesPre.size(); i++) {
+        lookup.Add(notesPre[i].time, notesPre[i].lane, i);
+    }
     int odNote = 116;
     int curNote = -1;
     int curFOn = -1;
@@ -212,20 +217,20 @@ void Chart::parsePlasticNotes(
     int curODPhrase = -1;
     int curSolo = -1;
     int curBPM = 0;
-    smf::uchar psOpen = 0x01;
-    smf::uchar psTap = 0x04;
-    smf::uchar psStart = 0x01;
-    smf::uchar psEnd = 0x00;
-    std::vector<smf::uchar> psDiff { 0x00, 0x01, 0x02, 0x03 };
-    resolution = midiFile.getTicksPerQuarterNote();
+    uint8_t psOpen = 0x01;
+    uint8_t psTap = 0x04;
+    uint8_t psStart = 0x01;
+    uint8_t psEnd = 0x00;
+    std::vector<uint8_t> psDiff { 0x00, 0x01, 0x02, 0x03 };
+    resolution = events.TicksPerQuarterNote();
     if (instrument == PlasticGuitar || instrument == PlasticBass
         || instrument == PlasticKeys) {
         for (int i = 0; i < events.getSize(); i++) {
             if (events[i][0] == 0xF0) {
                 // 'P' 'S' '\0' -- phase shift event
                 if (events[i][1] == 'P' && events[i][2] == 'S' && events[i][3] == '\0') {
-                    double time = midiFile.getTimeInSeconds(trkidx, i);
-                    int tick = midiFile.getAbsoluteTickTime(time);
+                    double time = events.Seconds(i);
+                    int tick = events.TickAt(time);
                     if ((events[i][5] == psDiff[diff] || events[i][5] == 0xFF)) {
                         if (events[i][6] == psTap) {
                             if (events[i][7] == psStart && !tapOn) {
@@ -253,8 +258,8 @@ void Chart::parsePlasticNotes(
             }
             if (events[i].isNoteOn()) {
                 if (events[i][1] >= notePitches[0] && events[i][1] <= notePitches[4]) {
-                    double time = midiFile.getTimeInSeconds(trkidx, i);
-                    int tick = midiFile.getAbsoluteTickTime(time);
+                    double time = events.Seconds(i);
+                    int tick = events.TickAt(time);
                     int pitch = events[i][1];
                     int lane = pitch - notePitches[0];
                     if (!notesOn[lane]) {
@@ -262,7 +267,10 @@ void Chart::parsePlasticNotes(
                         newNote.lane = lane;
                         newNote.tick = tick;
                         newNote.time = time;
+                        lookup.Add(time, lane, notesPre.size());
                         notesPre.push_back(newNote);
+                        // A zero length note earlier at the same time keeps the length
+                        noteOnIdx[lane] = lookup.Find(time, lane);
                         notesOn[lane] = true;
                         noteOnTick[lane] = tick;
                         noteOnTime[lane] = time;
@@ -271,7 +279,7 @@ void Chart::parsePlasticNotes(
                 } else if ((int)events[i][1] == pTapNote) {
                     if (!tapOn) {
                         tapPhrase newPhrase;
-                        newPhrase.StartSec = midiFile.getTimeInSeconds(trkidx, i);
+                        newPhrase.StartSec = events.Seconds(i);
                         tapPhrases.push_back(newPhrase);
                         tapOn = true;
                         curTap++;
@@ -279,7 +287,7 @@ void Chart::parsePlasticNotes(
                 } else if ((int)events[i][1] == pForceOn) {
                     if (!forceOn) {
                         forceOnPhrase newPhrase;
-                        newPhrase.StartSec = midiFile.getTimeInSeconds(trkidx, i);
+                        newPhrase.StartSec = events.Seconds(i);
                         forcedOnPhrases.push_back(newPhrase);
                         forceOn = true;
                         curFOn++;
@@ -287,7 +295,7 @@ void Chart::parsePlasticNotes(
                 } else if ((int)events[i][1] == pForceOff) {
                     if (!forceOff) {
                         forceOffPhrase newPhrase;
-                        newPhrase.StartSec = midiFile.getTimeInSeconds(trkidx, i);
+                        newPhrase.StartSec = events.Seconds(i);
                         forcedOffPhrases.push_back(newPhrase);
                         forceOff = true;
                         curFOff++;
@@ -296,7 +304,7 @@ void Chart::parsePlasticNotes(
                     if (!odOn) {
                         odOn = true;
                         odPhrase newPhrase;
-                        newPhrase.StartSec = midiFile.getTimeInSeconds(trkidx, i);
+                        newPhrase.StartSec = events.Seconds(i);
                         overdrive.events.push_back(newPhrase);
                         curODPhrase++;
                     }
@@ -305,22 +313,22 @@ void Chart::parsePlasticNotes(
                     if (!soloOn) {
                         soloOn = true;
                         solo newSolo;
-                        newSolo.StartSec = midiFile.getTimeInSeconds(trkidx, i);
+                        newSolo.StartSec = events.Seconds(i);
                         solos.events.push_back(newSolo);
                         curSolo++;
                     }
                 }
             } else if (events[i].isNoteOff()) {
-                double time = midiFile.getTimeInSeconds(trkidx, i);
-                int tick = midiFile.getAbsoluteTickTime(time);
+                double time = events.Seconds(i);
+                int tick = events.TickAt(time);
                 if ((int)events[i][1] >= notePitches[0]
                     && (int)events[i][1] <= notePitches[4]) {
                     int lane = (int)events[i][1] - notePitches[0];
                     if (notesOn[lane]) {
-                        int noteIdx = findNotePreIdx(noteOnTime[lane], lane);
+                        int noteIdx = noteOnIdx[lane];
                         if (noteIdx != -1) {
                             notesPre[noteIdx].beatsLen = (tick - notesPre[noteIdx].tick)
-                                / float(midiFile.getTicksPerQuarterNote());
+                                / float(events.TicksPerQuarterNote());
                             if (notesPre[noteIdx].beatsLen > 0.25) {
                                 notesPre[noteIdx].len = time - notesPre[noteIdx].time;
                             } else {
@@ -330,6 +338,7 @@ void Chart::parsePlasticNotes(
                         }
                         noteOnTick[lane] = 0;
                         noteOnTime[lane] = 0;
+                        noteOnIdx[lane] = -1;
                         notesOn[lane] = false;
                     }
                 } else if ((int)events[i][1] == pTapNote) {
@@ -363,41 +372,58 @@ void Chart::parsePlasticNotes(
             }
         }
     };
-    Encore::EncoreLog(
-        LOG_DEBUG, TextFormat("ENC: Loaded base notes for %01i", instrument)
-    );
+    Encore::EncoreLogFormat(LOG_DEBUG, "ENC: Loaded base notes for %01i", instrument);
+    LoadingState = NOTE_SORTING;
+    // A chord's notes share a tick, so in tick order each chord is one run of notesPre.
+    // Stable, so the notes in a chord stay in MIDI order.
+    std::stable_sort(notesPre.begin(), notesPre.end(), [](const Note &a, const Note &b) {
+        return a.tick < b.tick;
+    });
+    Encore::EncoreLogFormat(LOG_DEBUG, "ENC: Sorted notes for %01i", instrument);
     LoadingState = PLASTIC_CALC;
-    for (int i = 0; i < notesPre.size(); i++) {
-        Note note = notesPre[i];
+    // HOPOs are checked against the previous chord's tick and its last note's first
+    // lane, which is that chord's first note in another lane
+    bool hasLastNote = !notes.empty();
+    int lastTick = hasLastNote ? notes.back().tick : 0;
+    int lastLane = hasLastNote ? notes.back().pLanes[0].lane : 0;
+    notes.reserve(notes.size() + notesPre.size());
+    for (size_t chordStart = 0; chordStart < notesPre.size();) {
+        size_t chordEnd = chordStart + 1;
+        while (chordEnd < notesPre.size()
+               && notesPre[chordEnd].tick == notesPre[chordStart].tick) {
+            chordEnd++;
+        }
+        const Note &note = notesPre[chordStart];
         Note newNote;
         newNote.chordSize = 1;
         newNote.mask = PlasticFrets[note.lane];
-        for (Note noteMatching : notesPre) {
-            if (noteMatching.tick == note.tick && noteMatching.lane != note.lane) {
-                newNote.pLanes.push_back(
-                    { noteMatching.len, noteMatching.beatsLen, noteMatching.lane }
-                );
-                newNote.mask += PlasticFrets[noteMatching.lane];
-                newNote.chord = true;
-                newNote.chordSize++;
-                if (noteMatching.beatsLen > note.beatsLen) {
-                    newNote.beatsLen = noteMatching.beatsLen;
-                } else {
-                    newNote.beatsLen = note.beatsLen;
-                }
+        for (size_t i = chordStart; i < chordEnd; i++) {
+            const Note &noteMatching = notesPre[i];
+            if (noteMatching.lane == note.lane) {
+                continue;
+            }
+            newNote.pLanes.push_back(
+                { noteMatching.len, noteMatching.beatsLen, noteMatching.lane }
+            );
+            newNote.mask += PlasticFrets[noteMatching.lane];
+            newNote.chord = true;
+            newNote.chordSize++;
+            if (noteMatching.beatsLen > note.beatsLen) {
+                newNote.beatsLen = noteMatching.beatsLen;
+            } else {
+                newNote.beatsLen = note.beatsLen;
             }
         }
         newNote.pLanes.push_back({ note.len, note.beatsLen, note.lane });
         newNote.tick = note.tick;
-        if (notes.size() > 0) {
-            Note lastNote = notes[notes.size() - 1];
+        if (hasLastNote) {
             if (instrument != PlasticKeys) {
-                if (lastNote.tick >= newNote.tick - hopoThresh
-                    && lastNote.pLanes[0].lane != newNote.pLanes[0].lane && !newNote.chord) {
+                if (lastTick >= newNote.tick - hopoThresh
+                    && lastLane != newNote.pLanes[0].lane && !newNote.chord) {
                     newNote.phopo = true;
-                    }
+                }
             } else {
-                if (lastNote.tick >= newNote.tick - hopoThresh) {
+                if (lastTick >= newNote.tick - hopoThresh) {
                     newNote.phopo = true;
                 }
             }
@@ -405,19 +431,24 @@ void Chart::parsePlasticNotes(
         newNote.len = note.len;
         newNote.time = note.time;
         newNote.valid = true;
-        notes.push_back(newNote);
+        notes.push_back(std::move(newNote));
+
+        const Note &chordLast = notesPre[chordEnd - 1];
+        hasLastNote = true;
+        lastTick = chordLast.tick;
+        lastLane = chordLast.lane;
+        for (size_t i = chordStart; i < chordEnd; i++) {
+            if (notesPre[i].lane != chordLast.lane) {
+                lastLane = notesPre[i].lane;
+                break;
+            }
+        }
+        chordStart = chordEnd;
     }
 
-    Encore::EncoreLog(
-        LOG_DEBUG, TextFormat("ENC: Processed classic notes for %01i", instrument)
+    Encore::EncoreLogFormat(
+        LOG_DEBUG, "ENC: Processed classic notes for %01i", instrument
     );
-    LoadingState = NOTE_SORTING;
-    auto it = std::unique(notes.begin(), notes.end(), areNotesEqual);
-    notes.erase(it, notes.end());
-    std::sort(notes.begin(), notes.end(), compareNotes);
-    auto again = std::unique(notes.begin(), notes.end(), areNotesEqual);
-    notes.erase(again, notes.end());
-    Encore::EncoreLog(LOG_DEBUG, TextFormat("ENC: Sorted notes for %01i", instrument));
     curTap = 0;
     LoadingState = NOTE_MODIFIERS;
     if (tapPhrases.size() > 0) {
@@ -431,7 +462,7 @@ void Chart::parsePlasticNotes(
             }
         }
     }
-    Encore::EncoreLog(LOG_DEBUG, TextFormat("ENC: Processed taps for %01i", instrument));
+    Encore::EncoreLogFormat(LOG_DEBUG, "ENC: Processed taps for %01i", instrument);
     curFOff = 0;
     if (forcedOffPhrases.size() > 0) {
         for (Note &note : notes) {
@@ -470,7 +501,7 @@ void Chart::parsePlasticNotes(
         }
     }
 
-    Encore::EncoreLog(LOG_DEBUG, TextFormat("ENC: Processed hopos for %01i", instrument));
+    Encore::EncoreLogFormat(LOG_DEBUG, "ENC: Processed hopos for %01i", instrument);
     LoadingState = OVERDRIVE;
     curODPhrase = 0;
     if (overdrive.events.size() > 0) {
@@ -483,9 +514,7 @@ void Chart::parsePlasticNotes(
                 overdrive[curODPhrase].NoteCount++;
         }
     }
-    Encore::EncoreLog(
-        LOG_DEBUG, TextFormat("ENC: Processed overdrive for %01i", instrument)
-    );
+    Encore::EncoreLogFormat(LOG_DEBUG, "ENC: Processed overdrive for %01i", instrument);
 
     LoadingState = SOLOS;
     curSolo = 0;
@@ -497,7 +526,7 @@ void Chart::parsePlasticNotes(
                 solos[curSolo].NoteCount++;
         }
     }
-    Encore::EncoreLog(LOG_DEBUG, TextFormat("ENC: Processed solos for %01i", instrument));
+    Encore::EncoreLogFormat(LOG_DEBUG, "ENC: Processed solos for %01i", instrument);
     int esc = 0;
     LoadingState = PLASTIC_CALC;
     if (notes.size() > 0) {
@@ -508,8 +537,8 @@ void Chart::parsePlasticNotes(
             }
         }
     }
-    Encore::EncoreLog(
-        LOG_DEBUG, TextFormat("ENC: Processed extEndSeced sustains for %01i", instrument)
+    Encore::EncoreLogFormat(
+        LOG_DEBUG, "ENC: Processed extEndSeced sustains for %01i", instrument
     );
 
     int mult = 1;
@@ -538,13 +567,11 @@ void Chart::parsePlasticNotes(
             ++noteIt;
         }
     }
-    Encore::EncoreLog(
-        LOG_DEBUG, TextFormat("ENC: Processed base score for %01i", instrument)
-    );
+    Encore::EncoreLogFormat(LOG_DEBUG, "ENC: Processed base score for %01i", instrument);
 
-    Encore::EncoreLog(LOG_DEBUG, TextFormat("ENC: Base score: %01i", baseScore));
-    Encore::EncoreLog(
-        LOG_DEBUG, TextFormat("ENC: Processed plastic chart for %01i", instrument)
+    Encore::EncoreLogFormat(LOG_DEBUG, "ENC: Base score: %01i", baseScore);
+    Encore::EncoreLogFormat(
+        LOG_DEBUG, "ENC: Processed plastic chart for %01i", instrument
     );
 }
 /*
@@ -876,9 +903,7 @@ instrument));
 }
 */
 void Chart::parsePlasticDrums(
-    smf::MidiFile &midiFile,
-    int trkidx,
-    smf::MidiEventList events,
+    MidiTrackView events,
     int diff,
     int instrument,
     bool proDrums,
@@ -906,7 +931,8 @@ void Chart::parsePlasticDrums(
     std::vector<int> fillNotes = { 120, 121, 122, 123, 124 };
     std::vector<int> notePitches = pDiffNotes[diff];
 
-    midiFile.linkNotePairs();
+    NoteLookup lookup;
+    lookup.Reserve(events.getSize() / 2);
     int odNote = 116;
 
     int yellowTom = 110;
@@ -920,7 +946,7 @@ void Chart::parsePlasticDrums(
     int curSolo = -1;
     int curBPM = 0;
     int curFill = -1;
-    resolution = midiFile.getTicksPerQuarterNote();
+    resolution = events.TicksPerQuarterNote();
     for (int i = 0; i < events.getSize(); i++) {
         if (proDrums) {
             if (events[i].isMeta() && (int)events[i][1] == 1) {
@@ -946,11 +972,11 @@ void Chart::parsePlasticDrums(
         }
         if (events[i].isNoteOn()) {
             if (events[i][1] >= notePitches[0] && events[i][1] <= notePitches[4]) {
-                double time = midiFile.getTimeInSeconds(trkidx, i);
-                int tick = midiFile.getAbsoluteTickTime(time);
+                double time = events.Seconds(i);
+                int tick = events.TickAt(time);
                 int pitch = events[i][1];
                 int lane = pitch - notePitches[0];
-                if (lane == 0 && doubleKick && findNoteIdx(time, lane) != -1) {
+                if (lane == 0 && doubleKick && lookup.Find(time, lane) != -1) {
                     continue;
                 }
                 Note newNote;
@@ -971,13 +997,14 @@ void Chart::parsePlasticDrums(
                 newNote.time = time;
                 newNote.len = 0;
                 newNote.valid = true;
+                lookup.Add(time, lane, notes.size());
                 notes.push_back(newNote);
                 curNote++;
             } else if (events[i][1] == doubleKickPitch && doubleKick) {
-                double time = midiFile.getTimeInSeconds(trkidx, i);
-                int tick = midiFile.getAbsoluteTickTime(time);
+                double time = events.Seconds(i);
+                int tick = events.TickAt(time);
                 int lane = 0;
-                if (findNoteIdx(time, lane) != -1) {
+                if (lookup.Find(time, lane) != -1) {
                     continue;
                 }
                 Note newNote;
@@ -986,12 +1013,13 @@ void Chart::parsePlasticDrums(
                 newNote.time = time;
                 newNote.len = 0;
                 newNote.valid = true;
+                lookup.Add(time, lane, notes.size());
                 notes.push_back(newNote);
                 curNote++;
             } else if ((int)events[i][1] == yellowTom) {
                 if (!tapOn) {
                     tapPhrase newPhrase;
-                    newPhrase.StartSec = midiFile.getTimeInSeconds(trkidx, i);
+                    newPhrase.StartSec = events.Seconds(i);
                     tapPhrases.push_back(newPhrase);
                     tapOn = true;
                     curTap++;
@@ -999,7 +1027,7 @@ void Chart::parsePlasticDrums(
             } else if ((int)events[i][1] == blueTom) {
                 if (!forceOn) {
                     forceOnPhrase newPhrase;
-                    newPhrase.StartSec = midiFile.getTimeInSeconds(trkidx, i);
+                    newPhrase.StartSec = events.Seconds(i);
                     forcedOnPhrases.push_back(newPhrase);
                     forceOn = true;
                     curFOn++;
@@ -1007,7 +1035,7 @@ void Chart::parsePlasticDrums(
             } else if ((int)events[i][1] == greenTom) {
                 if (!forceOff) {
                     forceOffPhrase newPhrase;
-                    newPhrase.StartSec = midiFile.getTimeInSeconds(trkidx, i);
+                    newPhrase.StartSec = events.Seconds(i);
                     forcedOffPhrases.push_back(newPhrase);
                     forceOff = true;
                     curFOff++;
@@ -1016,7 +1044,7 @@ void Chart::parsePlasticDrums(
                 if (!odOn) {
                     odOn = true;
                     odPhrase newPhrase;
-                    newPhrase.StartSec = midiFile.getTimeInSeconds(trkidx, i);
+                    newPhrase.StartSec = events.Seconds(i);
                     overdrive.events.push_back(newPhrase);
                     curODPhrase++;
                 }
@@ -1026,7 +1054,7 @@ void Chart::parsePlasticDrums(
                 if (!soloOn) {
                     soloOn = true;
                     solo newSolo;
-                    newSolo.StartSec = midiFile.getTimeInSeconds(trkidx, i);
+                    newSolo.StartSec = events.Seconds(i);
                     solos.events.push_back(newSolo);
                     curSolo++;
                 }
@@ -1034,14 +1062,14 @@ void Chart::parsePlasticDrums(
                 if (!drumFill) {
                     drumFill = true;
                     DrumFill newFill;
-                    newFill.StartSec = midiFile.getTimeInSeconds(trkidx, i);
+                    newFill.StartSec = events.Seconds(i);
                     fills.events.push_back(newFill);
                     curFill++;
                 }
             }
         } else if (events[i].isNoteOff()) {
-            double time = midiFile.getTimeInSeconds(trkidx, i);
-            int tick = midiFile.getAbsoluteTickTime(time);
+            double time = events.Seconds(i);
+            int tick = events.TickAt(time);
             if ((int)events[i][1] == yellowTom) {
                 if (tapOn) {
                     tapPhrases[curTap].EndSec = time;
@@ -1075,13 +1103,11 @@ void Chart::parsePlasticDrums(
             }
         }
     }
-    Encore::EncoreLog(
-        LOG_DEBUG, TextFormat("ENC: Loaded base notes for %01i", instrument)
-    );
+    Encore::EncoreLogFormat(LOG_DEBUG, "ENC: Loaded base notes for %01i", instrument);
 
     // LoadingState = NOTE_SORTING;
     std::sort(notes.begin(), notes.end(), compareNotesTL);
-    Encore::EncoreLog(LOG_DEBUG, TextFormat("ENC: Sorted notes for %01i", instrument));
+    Encore::EncoreLogFormat(LOG_DEBUG, "ENC: Sorted notes for %01i", instrument);
     curTap = 0;
     if (proDrums) {
         // LoadingState = NOTE_MODIFIERS;
@@ -1101,8 +1127,8 @@ void Chart::parsePlasticDrums(
                 }
             }
         }
-        Encore::EncoreLog(
-            LOG_DEBUG, TextFormat("ENC: Processed yellow toms for %01i", instrument)
+        Encore::EncoreLogFormat(
+            LOG_DEBUG, "ENC: Processed yellow toms for %01i", instrument
         );
 
         curFOn = 0;
@@ -1122,8 +1148,8 @@ void Chart::parsePlasticDrums(
                 }
             }
         }
-        Encore::EncoreLog(
-            LOG_DEBUG, TextFormat("ENC: Processed blue toms for %01i", instrument)
+        Encore::EncoreLogFormat(
+            LOG_DEBUG, "ENC: Processed blue toms for %01i", instrument
         );
 
         curFOff = 0;
@@ -1143,8 +1169,8 @@ void Chart::parsePlasticDrums(
                 }
             }
         }
-        Encore::EncoreLog(
-            LOG_DEBUG, TextFormat("ENC: Processed green toms for %01i", instrument)
+        Encore::EncoreLogFormat(
+            LOG_DEBUG, "ENC: Processed green toms for %01i", instrument
         );
     }
     // LoadingState = OVERDRIVE;
@@ -1173,9 +1199,7 @@ void Chart::parsePlasticDrums(
         }
     }
 
-    Encore::EncoreLog(
-        LOG_DEBUG, TextFormat("ENC: Processed overdrive for %01i", instrument)
-    );
+    Encore::EncoreLogFormat(LOG_DEBUG, "ENC: Processed overdrive for %01i", instrument);
 
     // LoadingState = SOLOS;
     curSolo = 0;
@@ -1187,12 +1211,12 @@ void Chart::parsePlasticDrums(
                 solos[curSolo].NoteCount++;
         }
     }
-    Encore::EncoreLog(LOG_DEBUG, TextFormat("ENC: Processed solos for %01i", instrument));
+    Encore::EncoreLogFormat(LOG_DEBUG, "ENC: Processed solos for %01i", instrument);
     int esc = 0;
     int mult = 1;
     int multCtr = 0;
     int noteIdx = 0;
-    Encore::EncoreLog(LOG_DEBUG, TextFormat("ENC: NoteCount: %01i", notes.size()));
+    Encore::EncoreLogFormat(LOG_DEBUG, "ENC: NoteCount: %01i", (int)notes.size());
     // LoadingState = BASE_SCORE;
     for (auto it = notes.begin(); it != notes.end();) {
         Note &note = *it;
@@ -1212,12 +1236,37 @@ void Chart::parsePlasticDrums(
             ++it;
         }
     }
-    Encore::EncoreLog(
-        LOG_DEBUG, TextFormat("ENC: Processed base score for %01i", instrument)
-    );
+    Encore::EncoreLogFormat(LOG_DEBUG, "ENC: Processed base score for %01i", instrument);
 
-    Encore::EncoreLog(LOG_DEBUG, TextFormat("ENC: Base score: %01i", baseScore));
-    Encore::EncoreLog(
-        LOG_DEBUG, TextFormat("ENC: Processed plastic chart for %01i", instrument)
+    Encore::EncoreLogFormat(LOG_DEBUG, "ENC: Base score: %01i", baseScore);
+    Encore::EncoreLogFormat(
+        LOG_DEBUG, "ENC: Processed plastic chart for %01i", instrument
     );
 }
+
+void Chart::parse(
+    const SmfFile &midiFile, int diff, int instrument, int hopoThresh, bool proDrums
+) {
+    LoadingState = NOTE_PARSING;
+    if (instrument < PitchedVocals && instrument != PlasticDrums && instrument > PartVocals) {
+        plastic = true;
+        parsePlasticNotes(MidiTrackView(midiFile, track), diff, instrument, hopoThresh);
+    } else if (instrument == PlasticDrums) {
+        plastic = true;
+        parsePlasticDrums(
+            MidiTrackView(midiFile, track), diff, instrument, proDrums, true
+        );
+    } else {
+        plastic = false;
+        parseNotes(MidiTrackView(midiFile, track), diff, instrument);
+    }
+
+    if (!plastic) {
+        LoadingState = EXTRA_PROCESSING;
+        int noteIdx = 0;
+        for (Note &note : notes) {
+            notes_perlane[note.lane].push_back(noteIdx);
+            noteIdx++;
+        }
+    }
+}
@@ -1,13 +1,14 @@
 #pragma once
 #include <vector>
 #include <string>
-#include "midifile/MidiFile.h"
+#include "miditrack.h"
 // #include "song.h"
 #include "util/enclog.h"
 #include "raylib.h"
 #include "events/EncEventVects/EventVectors.h"
 
 #include <atomic>
+#include <unordered_map>
 #include <algorithm>
 #include <iso646.h>
 
@@ -105,6 +106,35 @@ static bool compareNotesTL(const Note &a, const Note &b) {
 }
 static bool areNotesEqual(const Note &a, const Note &b) { return a.tick == b.tick; }
 
+/// The first note the parsers added at each time and lane, so matching a MIDI event
+/// to its note is a hash lookup instead of a scan of every note so far. Gives the
+/// same answers as findNoteIdx() on a list that's only appended to.
+class NoteLookup {
+    struct Key {
+        double time;
+        int lane;
+        bool operator==(const Key &other) const {
+            return time == other.time && lane == other.lane;
+        }
+    };
+    struct KeyHash {
+        size_t operator()(const Key &key) const {
+            return std::hash<double>()(key.time) * 31 + key.lane;
+        }
+    };
+    std::unordered_map<Key, int, KeyHash> first;
+
+public:
+    /// Index of the first note added at time in lane, or -1.
+    int Find(double time, int lane) const {
+        auto it = first.find({ time, lane });
+        return it == first.end() ? -1 : it->second;
+    }
+    /// Records the note at idx, unless an earlier one already has its time and lane.
+    void Add(double time, int lane, int idx) { first.try_emplace({ time, lane }, idx); }
+    void Reserve(size_t count) { first.reserve(count); }
+};
+
 class Chart {
 private:
 
@@ -129,13 +159,12 @@ public:
 
     std::vector<Note> notesPre;
 
-    void getSections(smf::MidiFile &midiFile, int trkidx) {
+    void getSections(MidiTrackView events) {
         int Section = 0;
-        smf::MidiEventList events = midiFile[trkidx];
         for (int i = 0; i < events.getSize(); i++) {
             if (events[i].isMeta() && (int)events[i][1] == 1) {
-                double time = midiFile.getTimeInSeconds(trkidx, i);
-                int tick = midiFile.getAbsoluteTickTime(time);
+                double time = events.Seconds(i);
+                int tick = events.TickAt(time);
                 section newSection;
                 std::string Name;
                 for (int k = 3; k < events[i].getSize(); k++) {
@@ -146,7 +175,7 @@ public:
                     newSection.StartSec = time;
                     newSection.Name = Name.substr(5);
                     newSection.Name.pop_back();
-                    Encore::EncoreLog(LOG_DEBUG, TextFormat("New section: %s at %5.4f", newSection.Name.c_str(), newSection.StartSec));
+                    Encore::EncoreLogFormat(LOG_DEBUG, "New section: %s at %5.4f", newSection.Name.c_str(), newSection.StartSec);
 
                     if (Section > 0) {
                         sections.events[Section - 1].EndSec = time;
@@ -159,7 +188,7 @@ public:
                     newSection.StartSec = time;
                     newSection.Name = Name.substr(9);
                     newSection.Name.pop_back();
-                    Encore::EncoreLog(LOG_DEBUG, TextFormat("New section: %s at %5.4f", newSection.Name.c_str(), newSection.StartSec));
+                    Encore::EncoreLogFormat(LOG_DEBUG, "New section: %s at %5.4f", newSection.Name.c_str(), newSection.StartSec);
 
                     if (Section > 0) {
                         sections.events[Section - 1].EndSec = time;
@@ -222,25 +251,11 @@ public:
 
 
     int resolution = 480;
-    void parseNotes(
-        smf::MidiFile &midiFile,
-        int trkidx,
-        smf::MidiEventList events,
-        int diff,
-        int instrument
-    );
-    void parsePlasticNotes(
-        smf::MidiFile &midiFile, int trkidx, int diff, int instrument, int hopoThresh
-    );
-    void parseSection(
-        smf::MidiFile &midiFile,
-        int trkidx,
-        smf::MidiEventList events,
-        int diff,
-        int instrument
-    );
+    void parseNotes(MidiTrackView events, int diff, int instrument);
+    void parsePlasticNotes(MidiTrackView events, int diff, int instrument, int hopoThresh);
+    void parseSection(MidiTrackView events, int diff, int instrument);
     void parsePlasticSection(
-        smf::MidiFile &midiFile,
+        const SmfFile &midiFile,
         int trkidx,
         int start,
         int end,
@@ -249,15 +264,19 @@ public:
         int hopoThresh
     );
     void parsePlasticDrums(
-        smf::MidiFile &midiFile,
-        int trkidx,
-        smf::MidiEventList events,
+        MidiTrackView events,
         int diff,
         int instrument,
         bool proDrums,
         bool doubleKick
     );
 
+    // Parses this chart's track the way it gets played: classic parts through the
+    // plastic parsers, everything else as pad notes indexed by lane
+    void parse(
+        const SmfFile &midiFile, int diff, int instrument, int hopoThresh, bool proDrums
+    );
+
     void resetNotes() {
         notes.clear();
 
@@ -0,0 +1,438 @@
+#include "chartcache.h"
+
+#include <cmath>
+#include <cstring>
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+#include "util/binary.h"
+#include "util/enclog.h"
+
+namespace {
+    // Built in memory so the payload can be checksummed before it's written
+    class ChartPayload : public encore::bin_ostream_native<std::ostringstream> {
+    public:
+        ChartPayload() : bin_ostream(std::ios::binary) {}
+        [[nodiscard]]
+        std::string str() const { return mStream->str(); }
+    };
+
+    using ChartReader = encore::bin_istream_native<std::istringstream>;
+
+    uint32_t PayloadChecksum(std::string_view payload) {
+        uint32_t hash = 0x811c9dc5u;
+        for (char c : payload) {
+            hash = (hash ^ (uint8_t)c) * 0x01000193u;
+        }
+        return hash;
+    }
+
+    // Counts are checked against what's left, so a bad count fails instead of
+    // allocating
+    bool ReadCount(ChartReader &in, uint32_t &count, size_t remaining) {
+        in >> count;
+        return in && count <= remaining;
+    }
+
+    void WriteEvent(ChartPayload &out, const EncChartEvent &event) {
+        out << event.StartSec << event.EndSec;
+        out << (int32_t)event.StartTick << (int32_t)event.EndTick;
+        out << (int32_t)event.NoteCount;
+    }
+
+    void ReadEvent(ChartReader &in, EncChartEvent &event) {
+        in >> event.StartSec >> event.EndSec;
+        in >> event.StartTick >> event.EndTick;
+        in >> event.NoteCount;
+    }
+
+    template <typename Events>
+    void WriteEvents(ChartPayload &out, const Events &events) {
+        out << (uint32_t)events.events.size();
+        for (const auto &event : events.events) {
+            WriteEvent(out, event);
+        }
+    }
+
+    template <typename Events>
+    bool ReadEvents(ChartReader &in, Events &events, size_t remaining) {
+        uint32_t count = 0;
+        if (!ReadCount(in, count, remaining)) {
+            return false;
+        }
+        events.events.resize(count);
+        for (auto &event : events.events) {
+            ReadEvent(in, event);
+        }
+        return (bool)in;
+    }
+
+    // Only what the parsers set; hit state and the like start out at their defaults
+    void WriteNote(ChartPayload &out, const Note &note) {
+        out << note.time << note.len << note.beatsLen << note.sustainThreshold;
+        out << (int32_t)note.lane << (int32_t)note.tick << (int32_t)note.chordSize;
+        out << note.mask;
+        out << note.lift << note.valid << note.chord << note.renderAsOD;
+        out << note.pForceOn << note.pForceOff << note.phopo << note.extendedSustain;
+        out << note.pDrumTom << note.pSnare << note.pDrumAct << note.pTap << note.pOpen;
+        out << (uint32_t)note.pLanes.size();
+        for (const ClassicLane &lane : note.pLanes) {
+            out << lane.length << lane.beatsLen << (int32_t)lane.lane;
+        }
+    }
+
+    bool ReadNote(ChartReader &in, Note &note, size_t remaining) {
+        in >> note.time >> note.len >> note.beatsLen >> note.sustainThreshold;
+        in >> note.lane >> note.tick >> note.chordSize;
+        in >> note.mask;
+        in >> note.lift >> note.valid >> note.chord >> note.renderAsOD;
+        in >> note.pForceOn >> note.pForceOff >> note.phopo >> note.extendedSustain;
+        in >> note.pDrumTom >> note.pSnare >> note.pDrumAct >> note.pTap >> note.pOpen;
+        uint32_t lanes = 0;
+        if (!ReadCount(in, lanes, remaining)) {
+            return false;
+        }
+        note.pLanes.clear();
+        note.pLanes.reserve(lanes);
+        for (uint32_t i = 0; i < lanes; i++) {
+            double length = 0.0, beatsLen = 0.0;
+            int lane = 0;
+            in >> length >> beatsLen >> lane;
+            note.pLanes.emplace_back(length, beatsLen, lane);
+        }
+        return (bool)in;
+    }
+
+    void WriteChart(ChartPayload &out, const CompiledChart &compiled) {
+        const Chart &chart = compiled.chart;
+        out << (int32_t)compiled.part << (int32_t)compiled.diff << compiled.proDrums;
+        out << (int32_t)chart.track << chart.plastic << (int32_t)chart.resolution << (int32_t)chart.baseScore;
+        out << (uint32_t)chart.notes.size();
+        for (const Note &note : chart.notes) {
+            WriteNote(out, note);
+        }
+        out << (uint32_t)chart.notes_perlane.size();
+        for (const auto &lane : chart.notes_perlane) {
+            out << (uint32_t)lane.size();
+            for (int noteIdx : lane) {
+                out << (int32_t)noteIdx;
+            }
+        }
+        WriteEvents(out, chart.solos);
+        WriteEvents(out, chart.overdrive);
+        WriteEvents(out, chart.fills);
+        WriteEvents(out, chart.sections);
+        for (const section &section : chart.sections.events) {
+            out << section.Name;
+        }
+    }
+
+    bool ReadChart(ChartReader &in, CompiledChart &compiled, size_t remaining) {
+        Chart &chart = compiled.chart;
+        in >> compiled.part >> compiled.diff >> compiled.proDrums;
+        // Only valid charts get compiled
+        chart.valid = true;
+        chart.diff = compiled.diff;
+        in >> chart.track >> chart.plastic >> chart.resolution >> chart.baseScore;
+        uint32_t count = 0;
+        if (!ReadCount(in, count, remaining)) {
+            return false;
+        }
+        chart.notes.resize(count);
+        for (Note &note : chart.notes) {
+            if (!ReadNote(in, note, remaining)) {
+                return false;
+            }
+        }
+        if (!ReadCount(in, count, remaining)) {
+            return false;
+        }
+        chart.notes_perlane.resize(count);
+        for (auto &lane : chart.notes_perlane) {
+            uint32_t size = 0;
+            if (!ReadCount(in, size, remaining)) {
+                return false;
+            }
+            lane.resize(size);
+            for (int &noteIdx : lane) {
+                in >> noteIdx;
+                if (noteIdx < 0 || noteIdx >= (int)chart.notes.size()) {
+                    return false;
+                }
+            }
+        }
+        if (!ReadEvents(in, chart.solos, remaining)
+            || !ReadEvents(in, chart.overdrive, remaining)
+            || !ReadEvents(in, chart.fills, remaining)
+            || !ReadEvents(in, chart.sections, remaining)) {
+            return false;
+        }
+        for (section &section : chart.sections.events) {
+            in >> section.Name;
+        }
+        return (bool)in;
+    }
+
+    std::string Describe(const char *format, double time) {
+        char message[128];
+        std::snprintf(message, sizeof(message), format, time);
+        return message;
+    }
+
+    template <typename Events>
+    std::string ValidateEvents(const Events &events, const char *name) {
+        for (const auto &event : events.events) {
+            if (!std::isfinite(event.StartSec) || event.EndSec < event.StartSec) {
+                return std::string(name) + Describe(" phrase at %.3fs never ends", event.StartSec);
+            }
+        }
+        return {};
+    }
+
+    // Catches what would trip up gameplay later: unsorted or impossible notes and
+    // phrases without an end
+    std::string ValidateChart(const Chart &chart) {
+        if (chart.notes.empty()) {
+            return "no notes";
+        }
+        double previous = 0.0;
+        for (const Note &note : chart.notes) {
+            if (!std::isfinite(note.time) || note.time < previous) {
+                return Describe("note at %.3fs is out of order", note.time);
+            }
+            if (!std::isfinite(note.len) || note.len < 0.0) {
+                return Describe("note at %.3fs has a negative length", note.time);
+            }
+            if (note.lane < 0 || note.lane >= (int)chart.notes_perlane.size()) {
+                return Describe("note at %.3fs is outside the lanes", note.time);
+            }
+            previous = note.time;
+        }
+        std::string error = ValidateEvents(chart.overdrive, "overdrive");
+        if (error.empty()) {
+            error = ValidateEvents(chart.solos, "solo");
+        }
+        if (error.empty()) {
+            error = ValidateEvents(chart.fills, "drum fill");
+        }
+        return error;
+    }
+}
+
+const CompiledChart *CompiledSong::Find(int part, int diff, bool proDrums) const {
+    for (const CompiledChart &compiled : charts) {
+        if (compiled.part == part && compiled.diff == diff
+            && (part != PlasticDrums || compiled.proDrums == proDrums)) {
+            return &compiled;
+        }
+    }
+    return nullptr;
+}
+
+std::filesystem::path ChartCachePath(const std::string &midiHash) {
+    return std::filesystem::path(CHART_CACHE_DIR) / (midiHash + ".encc");
+}
+
+bool CompileSongCharts(
+    const Song &song, CompiledSong &compiled, std::vector<std::string> &problems
+) {
+    compiled = {};
+    SmfFile midiFile;
+    if (!midiFile.Read(song.midiPath) || midiFile.TrackCount() == 0) {
+        problems.push_back("MIDI can't be read");
+        return false;
+    }
+    if (song.BeatTrackID < 0 || song.BeatTrackID >= midiFile.TrackCount()
+        || midiFile.EventCount(song.BeatTrackID) == 0) {
+        problems.push_back("beat track is missing");
+        return false;
+    }
+
+    try {
+        // getTiming() and friends fill in a Song, so run them on a scratch one
+        Song timing;
+        timing.ini = song.ini;
+        timing.getTiming(MidiTrackView(midiFile, 0));
+        timing.parseBeatLines(midiFile, song.BeatTrackID);
+        timing.getCodas(midiFile);
+        compiled.bpms = std::move(timing.bpms);
+        compiled.timesigs = std::move(timing.timesigs);
+        compiled.beatLines = std::move(timing.beatLines);
+        compiled.BRE = timing.BRE;
+    } catch (const std::exception &e) {
+        problems.push_back(std::string("tempo map can't be read: ") + e.what());
+        return false;
+    }
+
+    for (int part = 0; part < (int)song.parts.size() && part <= PitchedVocals; part++) {
+        for (const Chart &chart : song.parts[part]->charts) {
+            if (!chart.valid) {
+                continue;
+            }
+            std::string name = songPartsList[part] + " " + diffList[chart.diff];
+            if (chart.track < 0 || chart.track >= midiFile.TrackCount()) {
+                problems.push_back(name + ": track is missing");
+                continue;
+            }
+            for (bool proDrums : { false, true }) {
+                if (proDrums && part != PlasticDrums) {
+                    continue;
+                }
+                CompiledChart result;
+                result.part = part;
+                result.diff = chart.diff;
+                result.proDrums = proDrums;
+                result.chart = chart;
+                std::string problem;
+                try {
+                    result.chart.parse(
+                        midiFile, chart.diff, part, song.hopoThreshold, proDrums
+                    );
+                    problem = ValidateChart(result.chart);
+                } catch (const std::exception &e) {
+                    problem = std::string("parsing failed: ") + e.what();
+                }
+                if (!problem.empty()) {
+                    problems.push_back(name + (proDrums ? " (pro): " : ": ") + problem);
+                    continue;
+                }
+                compiled.charts.push_back(std::move(result));
+            }
+        }
+    }
+    return true;
+}
+
+bool WriteChartCache(const Song &song, const CompiledSong &compiled) {
+    if (song.chartSummary.midiHash.empty()) {
+        return false;
+    }
+    ChartPayload payload;
+    payload << song.chartSummary.midiHash;
+    payload << song.ini << (int32_t)song.hopoThreshold;
+    payload << (uint32_t)compiled.bpms.size();
+    for (const BPM &bpm : compiled.bpms) {
+        payload << bpm.time << bpm.bpm << (int32_t)bpm.tick;
+    }
+    payload << (uint32_t)compiled.timesigs.size();
+    for (const TimeSig &sig : compiled.timesigs) {
+        payload << sig.time << (int32_t)sig.numer << (int32_t)sig.denom;
+    }
+    payload << (uint32_t)compiled.beatLines.size();
+    for (const Beat &beat : compiled.beatLines) {
+        payload << beat.Time << beat.Major << beat.Clapped << (int32_t)beat.Tick;
+    }
+    WriteEvent(payload, compiled.BRE);
+    payload << compiled.BRE.exists;
+    payload << (uint32_t)compiled.charts.size();
+    for (const CompiledChart &chart : compiled.charts) {
+        WriteChart(payload, chart);
+    }
+    std::string data = payload.str();
+
+    std::filesystem::path path = ChartCachePath(song.chartSummary.midiHash);
+    std::filesystem::path tempPath = path;
+    tempPath.replace_extension(".tmp");
+    std::error_code ec;
+    std::filesystem::create_directories(path.parent_path(), ec);
+    {
+        encore::bin_ofstream_native out(tempPath, std::ios::binary | std::ios::trunc);
+        out << (uint32_t)CHART_CACHE_HEADER;
+        out << (uint32_t)CHART_CACHE_VERSION;
+        out << (uint32_t)data.size();
+        out << PayloadChecksum(data);
+        out.write_raw(data.data(), (std::streamsize)data.size());
+        if (!out) {
+            out.close();
+            std::filesystem::remove(tempPath, ec);
+            return false;
+        }
+    }
+    std::filesystem::rename(tempPath, path, ec);
+    if (ec) {
+        std::filesystem::remove(tempPath, ec);
+        return false;
+    }
+    return true;
+}
+
+bool LoadChartCache(const Song &song, CompiledSong &compiled) {
+    compiled = {};
+    if (song.chartSummary.midiHash.empty()) {
+        return false;
+    }
+    std::ifstream file(ChartCachePath(song.chartSummary.midiHash), std::ios::binary);
+    if (!file) {
+        return false;
+    }
+    std::string data((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+    if (data.size() < 4 * sizeof(uint32_t)) {
+        return false;
+    }
+    uint32_t header[4];
+    std::memcpy(header, data.data(), sizeof(header));
+    std::string_view payload = std::string_view(data).substr(sizeof(header));
+    if (header[0] != CHART_CACHE_HEADER || header[1] != CHART_CACHE_VERSION
+        || header[2] != payload.size() || header[3] != PayloadChecksum(payload)) {
+        Encore::EncoreLog(LOG_WARNING, "CHARTS: Ignoring damaged or outdated chart cache");
+        return false;
+    }
+
+    size_t remaining = payload.size();
+    ChartReader in(std::string(payload), std::ios::binary);
+    std::string midiHash;
+    bool ini = false;
+    int hopoThreshold = 0;
+    in >> midiHash >> ini >> hopoThreshold;
+    if (!in || midiHash != song.chartSummary.midiHash || ini != song.ini
+        || hopoThreshold != song.hopoThreshold) {
+        return false;
+    }
+
+    uint32_t count = 0;
+    if (!ReadCount(in, count, remaining)) {
+        return false;
+    }
+    compiled.bpms.resize(count);
+    for (BPM &bpm : compiled.bpms) {
+        in >> bpm.time >> bpm.bpm >> bpm.tick;
+    }
+    if (!ReadCount(in, count, remaining)) {
+        return false;
+    }
+    compiled.timesigs.resize(count);
+    for (TimeSig &sig : compiled.timesigs) {
+        in >> sig.time >> sig.numer >> sig.denom;
+    }
+    if (!ReadCount(in, count, remaining)) {
+        return false;
+    }
+    compiled.beatLines.resize(count);
+    for (Beat &beat : compiled.beatLines) {
+        in >> beat.Time >> beat.Major >> beat.Clapped >> beat.Tick;
+    }
+    ReadEvent(in, compiled.BRE);
+    in >> compiled.BRE.exists;
+    if (!ReadCount(in, count, remaining)) {
+        return false;
+    }
+    compiled.charts.resize(count);
+    for (CompiledChart &chart : compiled.charts) {
+        if (!ReadChart(in, chart, remaining)) {
+            compiled = {};
+            return false;
+        }
+    }
+    return true;
+}
+
+void ApplyCompiledSong(const CompiledSong &compiled, Song &song) {
+    song.bpms.insert(song.bpms.end(), compiled.bpms.begin(), compiled.bpms.end());
+    song.timesigs.insert(
+        song.timesigs.end(), compiled.timesigs.begin(), compiled.timesigs.end()
+    );
+    song.beatLines.insert(
+        song.beatLines.end(), compiled.beatLines.begin(), compiled.beatLines.end()
+    );
+    song.BRE = compiled.BRE;
+}
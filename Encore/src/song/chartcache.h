@@ -0,0 +1,67 @@
+#pragma once
+
+#include <filesystem>
+#include <string>
+#include <vector>
+
+#include "song.h"
+#include "songcache.h"
+
+// Same YY_MM_DD_RR scheme as SONG_CACHE_VERSION. Bump it whenever the chart parsers
+// change what they produce, or old caches would keep the old behaviour.
+#define CHART_CACHE_VERSION 26101701
+#define CHART_CACHE_HEADER 0x43434E45 // "ENCC"
+
+/*
+ * Compiled charts live next to the song cache, one file per MIDI: songCache/charts/
+ * <MIDI hash>.encc. Each holds a checksummed payload with the song's tempo map, beat
+ * lines and codas, then every chart in the MIDI exactly as Chart::parse() left it.
+ * Like the song cache, it's in native endianness and not meant to be portable.
+ */
+
+#define CHART_CACHE_DIR SONG_CACHE_DIR "/charts"
+
+/// One parsed chart. Classic drums are compiled with and without pro drums, since
+/// that's a player setting.
+struct CompiledChart {
+    int part = 0;
+    int diff = 0;
+    bool proDrums = false;
+    Chart chart;
+};
+
+/// Everything chart loading gets out of a MIDI, for every part and difficulty in it.
+struct CompiledSong {
+    std::vector<BPM> bpms;
+    std::vector<TimeSig> timesigs;
+    std::vector<Beat> beatLines;
+    Coda BRE {};
+    std::vector<CompiledChart> charts;
+
+    /// The chart a player with these settings would get, or nullptr if it wasn't
+    /// compiled.
+    [[nodiscard]]
+    const CompiledChart *Find(int part, int diff, bool proDrums) const;
+};
+
+/// Where the compiled charts for a MIDI with this hash live.
+std::filesystem::path ChartCachePath(const std::string &midiHash);
+
+/// Reads song's MIDI and parses every valid chart in it with Chart::parse(). The song's
+/// parts have to be set up by ApplyChartSummary() first. Charts that fail validation
+/// are left out and described in problems; returns false if the MIDI itself can't be
+/// used. Safe to call from worker threads.
+bool CompileSongCharts(
+    const Song &song, CompiledSong &compiled, std::vector<std::string> &problems
+);
+
+/// Writes compiled for song's current MIDI, replacing any older file atomically.
+bool WriteChartCache(const Song &song, const CompiledSong &compiled);
+
+/// Loads the compiled charts for song's current MIDI. Returns false if there are none,
+/// or the file is damaged or was built from another MIDI, song settings or version.
+bool LoadChartCache(const Song &song, CompiledSong &compiled);
+
+/// Appends the tempo map and beat lines to song and sets its coda, the same as
+/// Song::getTiming(), parseBeatLines() and getCodas() would.
+void ApplyCompiledSong(const CompiledSong &compiled, Song &song);
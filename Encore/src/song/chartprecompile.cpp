@@ -0,0 +1,122 @@
+#include "chartprecompile.h"
+
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <thread>
+#include "chartcache.h"
+#include "songlist.h"
+#include "util/enclog.h"
+#include "util/work-queue.h"
+
+namespace {
+    struct PrecompileResult {
+        int id;
+        std::string songDir;
+        bool summaryChanged = false;
+        ChartSummary summary;
+        std::vector<std::string> problems;
+    };
+
+    // What a complete cache for this song holds: every valid chart, and classic drums
+    // once per pro drums setting
+    size_t ExpectedChartCount(const Song &song) {
+        size_t count = 0;
+        for (int part = 0; part < (int)song.parts.size() && part <= PitchedVocals; part++) {
+            for (const Chart &chart : song.parts[part]->charts) {
+                if (chart.valid) {
+                    count += part == PlasticDrums ? 2 : 1;
+                }
+            }
+        }
+        return count;
+    }
+}
+
+int PrecompileCharts(const std::vector<std::filesystem::path> &songPaths) {
+    auto start = std::chrono::steady_clock::now();
+    TheSongList.LoadCache(songPaths);
+    const SongCatalog &catalog = TheSongList.catalog;
+    Encore::EncoreLogFormat(LOG_INFO, "CHARTS: Compiling charts for %01i songs", (int)catalog.size());
+
+    Encore::WorkQueue<int> jobs;
+    for (int id = 0; id < (int)catalog.size(); id++) {
+        jobs.Push(id);
+    }
+    jobs.Close();
+
+    std::mutex resultsMutex;
+    std::vector<PrecompileResult> results;
+    std::atomic_int compiledSongs = 0;
+    std::atomic_int upToDateSongs = 0;
+    std::vector<std::thread> workers;
+    for (unsigned int i = 0; i < Encore::LibraryWorkerCount(); i++) {
+        workers.emplace_back([&] {
+            while (std::optional<int> id = jobs.Pop()) {
+                PrecompileResult result;
+                result.id = *id;
+                Song song;
+                catalog.FillSong(*id, song);
+                result.songDir = song.songDir.string();
+                try {
+                    SongList::LoadSongFiles(SongFolderSnapshot(song.songDir), song);
+                } catch (const std::exception &e) {
+                    result.problems.push_back(std::string("song can't be loaded: ") + e.what());
+                }
+                if (result.problems.empty() && song.midiPath.empty()) {
+                    result.problems.push_back("no MIDI");
+                }
+                if (result.problems.empty()) {
+                    // Same as ready-up, so the summary the cache is keyed on is current
+                    result.summaryChanged = song.UpdateChartSummary();
+                    result.summary = song.chartSummary;
+                    song.ApplyChartSummary();
+
+                    CompiledSong compiled;
+                    if (!result.summaryChanged && LoadChartCache(song, compiled)
+                        && compiled.charts.size() == ExpectedChartCount(song)) {
+                        upToDateSongs++;
+                    } else if (CompileSongCharts(song, compiled, result.problems)) {
+                        if (WriteChartCache(song, compiled)) {
+                            compiledSongs++;
+                        } else {
+                            result.problems.push_back("chart cache can't be written");
+                        }
+                    }
+                }
+                if (result.summaryChanged || !result.problems.empty()) {
+                    std::lock_guard lock(resultsMutex);
+                    results.push_back(std::move(result));
+                }
+            }
+        });
+    }
+    for (auto &worker : workers) {
+        worker.join();
+    }
+
+    std::vector<std::pair<int, ChartSummary> > summaries;
+    int brokenCharts = 0;
+    int brokenSongs = 0;
+    for (const PrecompileResult &result : results) {
+        if (result.summaryChanged) {
+            summaries.emplace_back(result.id, result.summary);
+        }
+        if (!result.problems.empty()) {
+            brokenSongs++;
+        }
+        for (const std::string &problem : result.problems) {
+            brokenCharts++;
+            Encore::EncoreLogFormat(LOG_WARNING, "CHARTS: %s: %s", result.songDir.c_str(), problem.c_str());
+        }
+    }
+    // Ready-up would otherwise read every changed MIDI again just for its summary
+    if (!summaries.empty()) {
+        TheSongList.SaveChartSummaries(summaries);
+    }
+    TheSongList.WaitForBackgroundWork();
+
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    Encore::EncoreLogFormat(LOG_INFO, "CHARTS: Compiled %01i songs, %01i already up to date, %01i problems in %01i songs (%.1fs)", compiledSongs.load(), upToDateSongs.load(), brokenCharts, brokenSongs, seconds);
+    return brokenCharts == 0 ? 0 : 1;
+}
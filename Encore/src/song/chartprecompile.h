@@ -0,0 +1,10 @@
+#pragma once
+
+#include <filesystem>
+#include <vector>
+
+/// Headless mode behind the precompile-charts argument. Loads the song cache for
+/// songPaths, compiles the charts of every song on worker threads and writes them to
+/// the chart cache, so chart loading never has to parse MIDI. Broken charts are logged.
+/// Returns the exit code: 0 if every chart compiled, 1 if any are broken.
+int PrecompileCharts(const std::vector<std::filesystem::path> &songPaths);
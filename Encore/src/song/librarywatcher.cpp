@@ -0,0 +1,302 @@
+#include "librarywatcher.h"
+
+#include <chrono>
+#include <cstdio>
+#include "songlist.h"
+#include "util/enclog.h"
+
+#ifdef __linux__
+#include <cerrno>
+#include <poll.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+#endif
+
+// How often the polling fallback re-stats every song folder
+constexpr auto LIBRARY_POLL_INTERVAL = std::chrono::seconds(5);
+// A copy into the library produces a burst of events; wait this long for quiet before
+// parsing anything
+constexpr int LIBRARY_SETTLE_MS = 500;
+
+SongLibraryWatcher::~SongLibraryWatcher() {
+    Stop();
+}
+
+void SongLibraryWatcher::Start(
+    const std::vector<std::filesystem::path> &songRoots, const SongCatalog &catalog
+) {
+    Stop();
+    roots = songRoots;
+    known.clear();
+    for (int id = 0; id < (int)catalog.size(); id++) {
+        if (catalog.IsRemoved(id)) {
+            continue;
+        }
+        known[std::string(catalog.Get(id, SongCatalog::SongDir))] = catalog.InfoStamp(id);
+    }
+    running = true;
+    thread = std::thread(&SongLibraryWatcher::Run, this);
+}
+
+void SongLibraryWatcher::Stop() {
+    running = false;
+    if (thread.joinable()) {
+        thread.join();
+    }
+}
+
+std::vector<LibraryChange> SongLibraryWatcher::TakeChanges() {
+    std::lock_guard lock(changesMutex);
+    return std::move(changes);
+}
+
+void SongLibraryWatcher::Publish(LibraryChange change) {
+    // On the watcher thread, so not through raylib's shared TextFormat buffers
+    Encore::EncoreLogFormat(LOG_INFO, "LIBRARY: %s %s", change.type == LibraryChange::Removed ? "Removed" : change.type == LibraryChange::Added ? "Added" : "Updated", change.songDir.string().c_str());
+    std::lock_guard lock(changesMutex);
+    changes.push_back(std::move(change));
+}
+
+void SongLibraryWatcher::CheckFolder(const std::filesystem::path &folder) {
+    std::string key = folder.string();
+    auto it = known.find(key);
+
+    Encore::FileStamp stamp;
+    bool hasInfo = Encore::GetFileStamp(folder / "info.json", stamp)
+        || Encore::GetFileStamp(folder / "song.ini", stamp);
+    if (hasInfo && it != known.end() && it->second == stamp) {
+        return;
+    }
+
+    SongCatalogEntry entry;
+    bool loaded = false;
+    if (hasInfo) {
+        try {
+            loaded = SongList::LoadSongFolder(SongFolderSnapshot(folder), entry);
+        } catch (const std::exception &e) {
+            Encore::EncoreLogFormat(LOG_ERROR, "LIBRARY: Failed to load %s: %s", key.c_str(), e.what());
+        }
+    }
+
+    if (!loaded) {
+        // A root that went offline takes its folders with it, but its songs stay in
+        // the library until it's back
+        std::error_code error;
+        if (it != known.end() && std::filesystem::is_directory(folder.parent_path(), error)) {
+            known.erase(it);
+            Publish({ LibraryChange::Removed, folder, SongCatalogEntry() });
+        }
+        return;
+    }
+
+    LibraryChange::Type type =
+        it == known.end() ? LibraryChange::Added : LibraryChange::Modified;
+    known[key] = entry.infoStamp;
+    Publish({ type, folder, std::move(entry) });
+}
+
+void SongLibraryWatcher::Poll() {
+    std::unordered_set<std::string> seen;
+    // Roots listed all the way through. Songs under any other root are left alone
+    // rather than reported removed, so an unplugged drive keeps its cached songs.
+    std::unordered_set<std::string> listedRoots;
+    for (const auto &root : roots) {
+        std::error_code error;
+        if (!std::filesystem::is_directory(root, error)) {
+            continue;
+        }
+        // A read error partway through (a drive or share dropping out) ends the walk
+        // rather than throwing out of the thread
+        std::filesystem::directory_iterator it(root, error);
+        for (; !error && it != std::filesystem::directory_iterator(); it.increment(error)) {
+            if (!running) {
+                return;
+            }
+            std::error_code typeError;
+            if (!it->is_directory(typeError)) {
+                continue;
+            }
+            seen.insert(it->path().string());
+            CheckFolder(it->path());
+        }
+        if (!error) {
+            listedRoots.insert(root.string());
+        }
+    }
+
+    std::vector<std::string> missing;
+    for (const auto &[dir, stamp] : known) {
+        if (!seen.contains(dir)
+            && listedRoots.contains(std::filesystem::path(dir).parent_path().string())) {
+            missing.push_back(dir);
+        }
+    }
+    for (const auto &dir : missing) {
+        known.erase(dir);
+        Publish({ LibraryChange::Removed, dir, SongCatalogEntry() });
+    }
+}
+
+void SongLibraryWatcher::Run() {
+    if (!StartInotify()) {
+        Encore::EncoreLog(LOG_INFO, "LIBRARY: Watching song folders by polling");
+    }
+
+    auto lastPoll = std::chrono::steady_clock::now();
+    while (running) {
+        if (inotifyFd >= 0) {
+            std::unordered_set<std::string> dirty;
+            WaitForInotify(dirty);
+            for (const auto &dir : dirty) {
+                if (!running) {
+                    break;
+                }
+                CheckFolder(dir);
+            }
+            continue;
+        }
+
+        std::this_thread::sleep_for(std::chrono::milliseconds(250));
+        if (std::chrono::steady_clock::now() - lastPoll >= LIBRARY_POLL_INTERVAL) {
+            Poll();
+            lastPoll = std::chrono::steady_clock::now();
+        }
+    }
+    StopInotify();
+}
+
+#ifdef __linux__
+bool SongLibraryWatcher::WatchFolder(const std::filesystem::path &folder, bool isRoot) {
+    uint32_t mask = IN_CREATE | IN_DELETE | IN_MOVED_FROM | IN_MOVED_TO | IN_ONLYDIR;
+    if (!isRoot) {
+        mask |= IN_CLOSE_WRITE;
+    }
+    int wd = inotify_add_watch(inotifyFd, folder.c_str(), mask);
+    if (wd < 0) {
+        // Out of watches means we can't trust inotify to see everything; anything
+        // else is a folder that vanished in the meantime
+        return errno != ENOSPC;
+    }
+    watches[wd] = folder;
+    if (isRoot) {
+        rootWatches.insert(wd);
+    }
+    return true;
+}
+
+bool SongLibraryWatcher::StartInotify() {
+    inotifyFd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (inotifyFd < 0) {
+        return false;
+    }
+    for (const auto &root : roots) {
+        std::error_code error;
+        if (!std::filesystem::is_directory(root, error)) {
+            continue;
+        }
+        bool ok = WatchFolder(root, true);
+        std::filesystem::directory_iterator it(root, error);
+        for (; ok && !error && it != std::filesystem::directory_iterator();
+             it.increment(error)) {
+            std::error_code typeError;
+            if (it->is_directory(typeError)) {
+                ok = WatchFolder(it->path(), false);
+            }
+        }
+        if (!ok) {
+            Encore::EncoreLog(LOG_WARNING, "LIBRARY: Ran out of inotify watches");
+            StopInotify();
+            return false;
+        }
+    }
+    return true;
+}
+
+void SongLibraryWatcher::StopInotify() {
+    if (inotifyFd >= 0) {
+        close(inotifyFd);
+    }
+    inotifyFd = -1;
+    watches.clear();
+    rootWatches.clear();
+}
+
+void SongLibraryWatcher::WaitForInotify(std::unordered_set<std::string> &dirty) {
+    alignas(inotify_event) char buffer[16384];
+    bool overflowed = false;
+    bool watchesExhausted = false;
+    // Short timeout until the first event so Stop() is noticed, then wait for a quiet
+    // period before returning the batch
+    int timeout = 250;
+
+    while (running) {
+        pollfd pfd { inotifyFd, POLLIN, 0 };
+        if (poll(&pfd, 1, timeout) <= 0) {
+            break;
+        }
+        ssize_t length = read(inotifyFd, buffer, sizeof(buffer));
+        for (ssize_t offset = 0; offset < length;) {
+            const inotify_event *event = reinterpret_cast<const inotify_event *>(buffer + offset);
+            offset += sizeof(inotify_event) + event->len;
+
+            if (event->mask & IN_Q_OVERFLOW) {
+                overflowed = true;
+                continue;
+            }
+            auto watch = watches.find(event->wd);
+            if (watch == watches.end()) {
+                continue;
+            }
+            if (event->mask & IN_IGNORED) {
+                rootWatches.erase(event->wd);
+                watches.erase(watch);
+                continue;
+            }
+            if (!rootWatches.contains(event->wd)) {
+                // Something inside a song folder changed
+                dirty.insert(watch->second.string());
+                continue;
+            }
+            if (event->len == 0) {
+                continue;
+            }
+            std::filesystem::path folder = watch->second / event->name;
+            dirty.insert(folder.string());
+            if ((event->mask & IN_ISDIR) && (event->mask & (IN_CREATE | IN_MOVED_TO))) {
+                watchesExhausted |= !WatchFolder(folder, false);
+            } else if ((event->mask & IN_ISDIR) && (event->mask & IN_MOVED_FROM)) {
+                for (auto it = watches.begin(); it != watches.end(); ++it) {
+                    if (it->second == folder) {
+                        inotify_rm_watch(inotifyFd, it->first);
+                        break;
+                    }
+                }
+            }
+        }
+        timeout = LIBRARY_SETTLE_MS;
+    }
+
+    if (watchesExhausted) {
+        Encore::EncoreLog(LOG_WARNING, "LIBRARY: Ran out of inotify watches, switching to polling");
+        StopInotify();
+        overflowed = true;
+    }
+    if (overflowed) {
+        // Events were lost, so fall back to comparing everything once
+        dirty.clear();
+        Poll();
+    }
+}
+#else
+bool SongLibraryWatcher::WatchFolder(const std::filesystem::path &, bool) {
+    return false;
+}
+
+bool SongLibraryWatcher::StartInotify() {
+    return false;
+}
+
+void SongLibraryWatcher::StopInotify() {}
+
+void SongLibraryWatcher::WaitForInotify(std::unordered_set<std::string> &) {}
+#endif
@@ -0,0 +1,70 @@
+#pragma once
+
+#include <atomic>
+#include <filesystem>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include "songcatalog.h"
+
+/// A song folder that appeared, disappeared or whose info file changed on disk.
+struct LibraryChange {
+    enum Type {
+        Added,
+        Removed,
+        Modified
+    } type;
+    std::filesystem::path songDir;
+    SongCatalogEntry entry; // parsed on the watcher thread; empty for Removed
+};
+
+/// Watches the song roots on a background thread and parses changed song folders
+/// there, so the render thread only has to splice finished songs into the list.
+/// Uses inotify on Linux and falls back to polling elsewhere, or when inotify runs out
+/// of watches.
+class SongLibraryWatcher {
+    std::vector<std::filesystem::path> roots;
+    // Song folder -> stamp of its info file, as last seen by the watcher thread
+    std::unordered_map<std::string, Encore::FileStamp> known;
+
+    std::thread thread;
+    std::atomic_bool running = false;
+    std::mutex changesMutex;
+    std::vector<LibraryChange> changes;
+
+    int inotifyFd = -1;
+    std::unordered_map<int, std::filesystem::path> watches;
+    std::unordered_set<int> rootWatches;
+
+    void Run();
+    bool StartInotify();
+    void StopInotify();
+    bool WatchFolder(const std::filesystem::path &folder, bool isRoot);
+    void WaitForInotify(std::unordered_set<std::string> &dirty);
+    void Poll();
+    void CheckFolder(const std::filesystem::path &folder);
+    void Publish(LibraryChange change);
+
+public:
+    SongLibraryWatcher() = default;
+    ~SongLibraryWatcher();
+
+    SongLibraryWatcher(const SongLibraryWatcher &) = delete;
+    SongLibraryWatcher &operator=(const SongLibraryWatcher &) = delete;
+
+    /// Starts watching. `catalog` is the library as loaded, used as the baseline so
+    /// only later changes are reported.
+    void Start(
+        const std::vector<std::filesystem::path> &songRoots, const SongCatalog &catalog
+    );
+    void Stop();
+    [[nodiscard]]
+    bool IsRunning() const { return thread.joinable(); }
+
+    /// Changes found since the last call, oldest first.
+    std::vector<LibraryChange> TakeChanges();
+};
@@ -0,0 +1,26 @@
+#pragma once
+
+#include "smffile.h"
+
+/*
+ * One track of a parsed MIDI, for the chart and song parsers. It borrows the track
+ * from the file instead of copying it, and carries the file along for its tempo map.
+ * The file has to outlive it.
+ */
+class MidiTrackView {
+    const SmfFile *midiFile;
+    int trackIndex;
+
+public:
+    MidiTrackView(const SmfFile &midiFile, int track)
+        : midiFile(&midiFile), trackIndex(track) {}
+
+    int getSize() const { return midiFile->EventCount(trackIndex); }
+    SmfEvent operator[](int index) const { return midiFile->Event(trackIndex, index); }
+
+    /// When the event at index happens, in seconds.
+    double Seconds(int index) const { return midiFile->Seconds(trackIndex, index); }
+    /// The tick a time in seconds lands on.
+    int TickAt(double seconds) const { return (int)midiFile->TickAtSeconds(seconds); }
+    int TicksPerQuarterNote() const { return midiFile->TicksPerQuarterNote(); }
+};
@@ -44,14 +44,14 @@ public:
     bool renderAsOD = false;
     bool hitInFrontend = false;
     double hitTime = 0;
-    int tick;
+    int tick = 0;
 
     // CLASSIC
     // 0-4 for grybo, helps with chords
     int strumCount = 0;
     int chordSize = 0;
     bool hitWithFAS = false;
-    uint8_t mask;
+    uint8_t mask = 0;
     bool chord = false;
     std::vector<ClassicLane> pLanes;
     bool pForceOn = false;
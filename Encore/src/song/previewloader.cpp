@@ -0,0 +1,109 @@
+#include "previewloader.h"
+
+#include <algorithm>
+
+Encore::PreviewLoader::~PreviewLoader() {
+    {
+        std::lock_guard lock(mutex);
+        stopping = true;
+        wanted.clear();
+    }
+    wake.notify_all();
+    if (worker.joinable()) {
+        worker.join();
+    }
+    for (auto &[key, streams] : ready) {
+        AudioManager::FreeStreams(streams);
+    }
+}
+
+bool Encore::PreviewLoader::IsWanted(const std::string &key) const {
+    return std::any_of(wanted.begin(), wanted.end(), [&](const PreviewSource &source) {
+        return source.key == key;
+    });
+}
+
+void Encore::PreviewLoader::Run() {
+    std::unique_lock lock(mutex);
+    while (true) {
+        auto next = wanted.end();
+        wake.wait(lock, [&] {
+            next = std::find_if(wanted.begin(), wanted.end(), [&](const PreviewSource &source) {
+                return !ready.contains(source.key);
+            });
+            return stopping || next != wanted.end();
+        });
+        if (stopping) {
+            return;
+        }
+        PreviewSource source = *next;
+        lock.unlock();
+
+        auto cancelled = [this, &source] {
+            std::lock_guard check(mutex);
+            return stopping || !IsWanted(source.key);
+        };
+        std::vector<AudioManager::AudioStream> streams;
+        bool complete = !cancelled()
+            && AudioManager::OpenStreams(source.stems(), streams, cancelled);
+        if (complete) {
+            AudioManager::SeekStreams(streams, source.startSeconds);
+        }
+
+        lock.lock();
+        if (complete && !stopping && IsWanted(source.key)) {
+            ready[source.key] = std::move(streams);
+        } else {
+            lock.unlock();
+            AudioManager::FreeStreams(streams);
+            lock.lock();
+        }
+    }
+}
+
+void Encore::PreviewLoader::SetWanted(std::vector<PreviewSource> sources) {
+    std::vector<std::vector<AudioManager::AudioStream> > stale;
+    {
+        std::lock_guard lock(mutex);
+        wanted = std::move(sources);
+        for (auto it = ready.begin(); it != ready.end();) {
+            if (IsWanted(it->first)) {
+                ++it;
+            } else {
+                stale.push_back(std::move(it->second));
+                it = ready.erase(it);
+            }
+        }
+        if (!worker.joinable() && !wanted.empty()) {
+            worker = std::thread(&PreviewLoader::Run, this);
+        }
+    }
+    wake.notify_one();
+    for (auto &streams : stale) {
+        AudioManager::FreeStreams(streams);
+    }
+}
+
+bool Encore::PreviewLoader::Take(
+    const std::string &key, std::vector<AudioManager::AudioStream> &streams
+) {
+    std::lock_guard lock(mutex);
+    auto it = ready.find(key);
+    if (it == ready.end()) {
+        return false;
+    }
+    streams = std::move(it->second);
+    ready.erase(it);
+    // Taken streams aren't loaded again while this key stays wanted
+    wanted.erase(
+        std::remove_if(wanted.begin(), wanted.end(), [&](const PreviewSource &source) {
+            return source.key == key;
+        }),
+        wanted.end()
+    );
+    return true;
+}
+
+void Encore::PreviewLoader::Clear() {
+    SetWanted({});
+}
@@ -0,0 +1,53 @@
+#pragma once
+
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "audio.h"
+
+namespace Encore {
+    using StemList = std::vector<std::pair<std::string, int> >;
+
+    /// One song's preview: where it starts, and how to find its stems. stems runs on
+    /// the loader's thread, so it can read the song's info file.
+    struct PreviewSource {
+        std::string key; // song folder
+        double startSeconds = 0.0;
+        std::function<StemList()> stems;
+    };
+
+    /// Opens preview streams on a worker thread, seeked and paused at the preview start,
+    /// so starting a preview on the render thread is only a play call. Only the sources
+    /// from the last SetWanted() are loaded or kept; a load that stops being wanted is
+    /// abandoned between stems.
+    class PreviewLoader {
+        std::mutex mutex;
+        std::condition_variable wake;
+        std::vector<PreviewSource> wanted; // most important first
+        std::unordered_map<std::string, std::vector<AudioManager::AudioStream> > ready;
+        bool stopping = false;
+        std::thread worker;
+
+        void Run();
+        [[nodiscard]]
+        bool IsWanted(const std::string &key) const;
+
+    public:
+        ~PreviewLoader();
+
+        /// Replaces what should be loaded: the selected song first, then its neighbours.
+        /// Ready streams for anything else are freed.
+        void SetWanted(std::vector<PreviewSource> sources);
+        /// Moves the streams for key into streams if they're ready. The set may be
+        /// empty if the song has no playable stems.
+        bool Take(const std::string &key, std::vector<AudioManager::AudioStream> &streams);
+        /// Drops every wanted and ready preview.
+        void Clear();
+    };
+}
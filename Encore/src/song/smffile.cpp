@@ -0,0 +1,418 @@
+#include "smffile.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+
+namespace {
+    uint32_t ReadBigEndian(const uint8_t *data, int count) {
+        uint32_t value = 0;
+        for (int i = 0; i < count; i++) {
+            value = (value << 8) | data[i];
+        }
+        return value;
+    }
+
+    // Variable length quantity of at most maxBytes bytes. midifile allows five for delta
+    // times and sysex lengths and four for meta lengths.
+    bool ReadVLV(const uint8_t *&data, const uint8_t *end, int maxBytes, uint32_t &value) {
+        // Most deltas and lengths fit in one byte
+        if (data != end && *data < 0x80) {
+            value = *data++;
+            return true;
+        }
+        uint64_t result = 0;
+        for (int i = 0; i < maxBytes && data != end; i++) {
+            uint8_t byte = *data++;
+            result = (result << 7) | (byte & 0x7F);
+            if (byte < 0x80) {
+                value = (uint32_t)result;
+                return true;
+            }
+        }
+        return false;
+    }
+
+    bool IsDataByte(uint8_t byte) { return byte < 0x80; }
+}
+
+void SmfFile::Clear() {
+    events.clear();
+    eventSeconds.clear();
+    trackStarts.assign(1, 0);
+    source = nullptr;
+    timeMap.clear();
+    directory.clear();
+    ticksPerQuarterNote = 0;
+}
+
+bool SmfFile::Read(const std::filesystem::path &path, const TrackFilter &decodeTrack) {
+    if (!file.Open(path)) {
+        Clear();
+        return false;
+    }
+    if (!Decode(file.data(), file.size(), decodeTrack)) {
+        file.Close();
+        return false;
+    }
+    return true;
+}
+
+bool SmfFile::Read(const uint8_t *data, size_t size, const TrackFilter &decodeTrack) {
+    file.Close();
+    return Decode(data, size, decodeTrack);
+}
+
+bool SmfFile::Decode(const uint8_t *data, size_t size, const TrackFilter &decodeTrack) {
+    Clear();
+    source = data;
+    const uint8_t *end = data + size;
+    if (size < 14 || memcmp(data, "MThd", 4) != 0 || ReadBigEndian(data + 4, 4) != 6) {
+        return false;
+    }
+    // Long messages are found by a 32-bit offset
+    if (size > UINT32_MAX) {
+        return false;
+    }
+    uint32_t format = ReadBigEndian(data + 8, 2);
+    uint32_t trackCount = ReadBigEndian(data + 10, 2);
+    uint32_t division = ReadBigEndian(data + 12, 2);
+    if (format > 1 || (format == 0 && trackCount != 1)) {
+        return false;
+    }
+    if (division >= 0x8000) {
+        // SMPTE timing, which midifile turns into ticks per second
+        int framesPerSecond = 255 - ((division >> 8) & 0xFF) + 1;
+        ticksPerQuarterNote = framesPerSecond * (int)(division & 0xFF);
+    } else {
+        ticksPerQuarterNote = (int)division;
+    }
+
+    // Without a filter every track is decoded as it's found. With one, this pass only
+    // builds the directory and gathers timing, and the chosen tracks are decoded after.
+    bool decodeAll = !decodeTrack;
+    if (decodeAll) {
+        // Every event takes at least two bytes in the file
+        events.reserve(size / 3);
+    }
+    directory.resize(trackCount);
+    trackStarts.reserve(trackCount + 1);
+    TimingEvents timing;
+    timing.ticks.reserve(size / 3);
+    const uint8_t *pos = data + 14;
+    for (uint32_t track = 0; track < trackCount; track++) {
+        if (end - pos < 4 || memcmp(pos, "MTrk", 4) != 0) {
+            Clear();
+            return false;
+        }
+        pos += 4;
+        TrackEntry &entry = directory[track];
+        entry.decoded = decodeAll;
+        timing.runStarts.push_back(timing.ticks.size());
+        // Chunk lengths are often wrong in the wild, so like midifile this ignores them
+        // and reads up to the end-of-track event. A file that ends inside the length is
+        // read as an empty track.
+        if (end - pos < 4) {
+            pos = end;
+            entry.offset = size;
+        } else {
+            pos += 4;
+            entry.offset = (size_t)(pos - data);
+            if (!ReadTrack(pos, end, entry, &timing, decodeAll)) {
+                Clear();
+                return false;
+            }
+            entry.length = (size_t)(pos - data) - entry.offset;
+        }
+        if (decodeAll) {
+            trackStarts.push_back((uint32_t)events.size());
+        }
+    }
+
+    if (!decodeAll) {
+        size_t decodedBytes = 0;
+        for (uint32_t track = 0; track < trackCount; track++) {
+            TrackEntry &entry = directory[track];
+            entry.decoded = decodeTrack((int)track, entry.name);
+            if (entry.decoded) {
+                decodedBytes += entry.length;
+            }
+        }
+        events.reserve(decodedBytes / 3);
+        for (TrackEntry &entry : directory) {
+            // Already read once, so this can't fail
+            const uint8_t *trackPos = data + entry.offset;
+            if (entry.decoded && entry.length > 0) {
+                ReadTrack(trackPos, end, entry, nullptr, true);
+            }
+            trackStarts.push_back((uint32_t)events.size());
+        }
+    }
+    BuildTimeMap(timing);
+    return true;
+}
+
+bool SmfFile::ReadTrack(
+    const uint8_t *&pos, const uint8_t *end, TrackEntry &track, TimingEvents *timing, bool store
+) {
+    uint8_t runningCommand = 0;
+    uint32_t tick = 0;
+    bool named = false;
+    while (true) {
+        uint32_t delta;
+        if (!ReadVLV(pos, end, 5, delta) || pos == end) {
+            return false;
+        }
+        // Ticks wrap the way midifile's int sum of deltas does
+        tick += delta;
+        if (timing
+            && (timing->ticks.size() == timing->runStarts.back()
+                || timing->ticks.back() != (int)tick)) {
+            timing->ticks.push_back((int)tick);
+        }
+        uint8_t byte = *pos++;
+        bool running = IsDataByte(byte);
+        if (running) {
+            // Meta and sysex events can't be repeated with running status
+            if (runningCommand == 0 || runningCommand >= 0xF0) {
+                return false;
+            }
+        } else {
+            runningCommand = byte;
+        }
+
+        uint8_t message[2] = { byte, 0 };
+        switch (runningCommand & 0xF0) {
+        case 0x80:
+        case 0x90:
+        case 0xA0:
+        case 0xB0:
+        case 0xE0: {
+            int needed = running ? 1 : 2;
+            if (end - pos < needed || !IsDataByte(pos[0])
+                || (needed == 2 && !IsDataByte(pos[1]))) {
+                return false;
+            }
+            if (running) {
+                message[1] = pos[0];
+            } else {
+                message[0] = pos[0];
+                message[1] = pos[1];
+            }
+            pos += needed;
+            if (store) {
+                AddEvent((int)tick, runningCommand, message, 2);
+            }
+            break;
+        }
+        case 0xC0:
+        case 0xD0:
+            if (!running) {
+                if (pos == end || !IsDataByte(*pos)) {
+                    return false;
+                }
+                message[0] = *pos++;
+            }
+            if (store) {
+                AddEvent((int)tick, runningCommand, message, 1);
+            }
+            break;
+        default:
+            if (runningCommand == 0xFF) {
+                // Kept as is: type, length and data
+                const uint8_t *start = pos;
+                uint32_t length;
+                if (pos == end) {
+                    return false;
+                }
+                uint8_t type = *pos++;
+                if (!ReadVLV(pos, end, 4, length) || (size_t)(end - pos) < length) {
+                    return false;
+                }
+                pos += length;
+                if (store) {
+                    AddEvent((int)tick, 0xFF, start, (uint32_t)(pos - start));
+                }
+                if (type == 0x03 && !named && timing) {
+                    track.name.assign((const char *)pos - length, length);
+                    named = true;
+                }
+                // midifile takes any six byte 0x51 meta event as a tempo
+                if (type == 0x51 && pos - start == 5 && timing) {
+                    int microseconds = (start[2] << 16) + (start[3] << 8) + start[4];
+                    timing->tempos.push_back(
+                        { (int)tick, (double)microseconds / 1000000.0 / ticksPerQuarterNote }
+                    );
+                }
+                if (type == 0x2F) {
+                    return true;
+                }
+            } else if (runningCommand == 0xF0 || runningCommand == 0xF7) {
+                // Sysex loses its length
+                uint32_t length;
+                if (!ReadVLV(pos, end, 5, length) || (size_t)(end - pos) < length) {
+                    return false;
+                }
+                if (store) {
+                    AddEvent((int)tick, runningCommand, pos, length);
+                }
+                pos += length;
+            } else if (store) {
+                AddEvent((int)tick, runningCommand, nullptr, 0);
+            }
+            break;
+        }
+    }
+}
+
+void SmfFile::AddEvent(int tick, uint8_t status, const uint8_t *data, uint32_t size) {
+    EventHeader &header = events.emplace_back();
+    header.tick = tick;
+    header.size = size + 1;
+    header.inlineBytes[0] = status;
+    if (header.size <= InlineBytes) {
+        if (size > 0) {
+            memcpy(header.inlineBytes + 1, data, size);
+        }
+    } else {
+        // Only meta and sysex events get this long, and their bytes are in the file
+        header.payload = (uint32_t)(data - source);
+    }
+}
+
+void SmfFile::BuildTimeMap(TimingEvents &timing) {
+    // midifile's map has an entry for every tick any event is on, starts at 120 BPM,
+    // and changes tempo after the entry for a tempo event's tick. When several tempo
+    // events share a tick, the last one in track order wins.
+    //
+    // Each track is in tick order, so the map's ticks are a merge of the tracks' runs,
+    // done pairwise. Ticks past INT_MAX wrap around, which midifile's sort puts back
+    // in order.
+    std::vector<int> &ticks = timing.ticks;
+    std::vector<size_t> runStarts = timing.runStarts;
+    runStarts.push_back(ticks.size());
+    bool ordered = true;
+    for (size_t run = 0; ordered && run + 1 < runStarts.size(); run++) {
+        ordered = std::is_sorted(
+            ticks.begin() + runStarts[run], ticks.begin() + runStarts[run + 1]
+        );
+    }
+    if (ordered) {
+        while (runStarts.size() > 2) {
+            std::vector<size_t> merged;
+            for (size_t run = 0; run + 2 < runStarts.size(); run += 2) {
+                std::inplace_merge(
+                    ticks.begin() + runStarts[run],
+                    ticks.begin() + runStarts[run + 1],
+                    ticks.begin() + runStarts[run + 2]
+                );
+                merged.push_back(runStarts[run]);
+            }
+            if (runStarts.size() % 2 == 0) {
+                merged.push_back(runStarts[runStarts.size() - 2]);
+            }
+            merged.push_back(ticks.size());
+            runStarts = std::move(merged);
+        }
+    } else {
+        std::sort(ticks.begin(), ticks.end());
+    }
+    ticks.erase(std::unique(ticks.begin(), ticks.end()), ticks.end());
+    std::vector<TempoChange> &tempos = timing.tempos;
+    std::stable_sort(tempos.begin(), tempos.end(), [](const TempoChange &a, const TempoChange &b) {
+        return a.tick < b.tick;
+    });
+
+    timeMap.reserve(ticks.size());
+    double secondsPerTick = 60.0 / (120.0 * ticksPerQuarterNote);
+    int lastTick = 0;
+    double lastSeconds = 0.0;
+    size_t tempo = 0;
+    for (int tick : ticks) {
+        double seconds = lastSeconds + (tick - lastTick) * secondsPerTick;
+        timeMap.push_back({ tick, seconds });
+        lastTick = tick;
+        lastSeconds = seconds;
+        for (; tempo < tempos.size() && tempos[tempo].tick == tick; tempo++) {
+            secondsPerTick = tempos[tempo].secondsPerTick;
+        }
+    }
+
+    // Tracks are in tick order, so each one is a walk along the map
+    eventSeconds.resize(events.size());
+    for (int track = 0; track < TrackCount(); track++) {
+        auto entry = timeMap.begin();
+        for (uint32_t i = trackStarts[track]; i < trackStarts[track + 1]; i++) {
+            int tick = events[i].tick;
+            if (entry->tick > tick) {
+                entry = timeMap.begin();
+            }
+            while (entry->tick < tick) {
+                ++entry;
+            }
+            eventSeconds[i] = entry->seconds;
+        }
+    }
+}
+
+double SmfFile::SecondsAtTick(int tick) const {
+    // Same answers as midifile, quirks included: outside the map is -1, and the
+    // backwards search it uses for the second half of the song never interpolates
+    // from the first entry
+    if (timeMap.empty()) {
+        return -1.0;
+    }
+    auto after = std::upper_bound(
+        timeMap.begin(), timeMap.end(), tick,
+        [](int tick, const TickTime &entry) { return tick < entry.tick; }
+    );
+    int before = (int)(after - timeMap.begin()) - 1;
+    if (before >= 0 && timeMap[before].tick == tick) {
+        return timeMap[before].seconds;
+    }
+    if (tick < 0 || tick > timeMap.back().tick) {
+        return -1.0;
+    }
+    if (tick >= timeMap.back().tick / 2.0 && before < 1) {
+        return -1.0;
+    }
+    if (before < 0 || before >= (int)timeMap.size() - 1) {
+        return -1.0;
+    }
+    double x1 = timeMap[before].tick;
+    double x2 = timeMap[before + 1].tick;
+    double y1 = timeMap[before].seconds;
+    double y2 = timeMap[before + 1].seconds;
+    return (tick - x1) * ((y2 - y1) / (x2 - x1)) + y1;
+}
+
+double SmfFile::TickAtSeconds(double seconds) const {
+    // Same answers as midifile, quirks included: its backwards search for the second
+    // half of the song interpolates one entry later than it should
+    if (timeMap.empty()) {
+        return -1.0;
+    }
+    auto after = std::upper_bound(
+        timeMap.begin(), timeMap.end(), seconds,
+        [](double seconds, const TickTime &entry) { return seconds < entry.seconds; }
+    );
+    int before = (int)(after - timeMap.begin()) - 1;
+    if (before >= 0 && timeMap[before].seconds == seconds) {
+        return timeMap[before].tick;
+    }
+    if (seconds < 0.0 || seconds > timeMap.back().seconds) {
+        return -1.0;
+    }
+    int start = before;
+    if (seconds >= timeMap.back().seconds / 2) {
+        start = before >= 1 ? before + 1 : -1;
+    }
+    if (start < 0 || start >= (int)timeMap.size() - 1) {
+        return -1.0;
+    }
+    double x1 = timeMap[start].seconds;
+    double x2 = timeMap[start + 1].seconds;
+    double y1 = timeMap[start].tick;
+    double y2 = timeMap[start + 1].tick;
+    return (seconds - x1) * ((y2 - y1) / (x2 - x1)) + y1;
+}
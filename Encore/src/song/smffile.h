@@ -0,0 +1,163 @@
+#pragma once
+
+#include <cstdint>
+#include <filesystem>
+#include <functional>
+#include <string>
+#include <vector>
+
+#include "util/mapped-file.h"
+
+/*
+ * Standard MIDI File reader for the chart parsers. The file is mapped and decoded in
+ * one pass into flat arrays shared by every track: a fixed size header per event, with
+ * the bytes of meta and sysex events too long to keep inline left where they are in
+ * the mapped file, which the SmfFile keeps open. The tempo map and every event's time in seconds are worked out while reading, so
+ * nothing is computed lazily and a const SmfFile is safe to share between threads.
+ *
+ * Events, ticks and times come out exactly as midifile's smf::MidiFile gives them
+ * after read() and doTimeAnalysis(): running status is expanded, meta events keep
+ * their length bytes, sysex events drop theirs, every track ends with its
+ * end-of-track event, and files midifile refuses are refused. The exceptions are
+ * midifile's ASCII "binasc" input, which isn't read, and meta events whose length's
+ * second byte is 0x80, which midifile misreads.
+ *
+ * A read can be limited to some of the tracks. Every track is still scanned for its
+ * name and its ticks, since each one adds entries to the tempo map, but only the
+ * chosen ones are decoded. The others read as empty.
+ */
+
+/// One event, as the parsers see it. The accessors are named after smf::MidiMessage's
+/// so code can read either.
+///
+/// The status byte is held apart from the rest, since a sysex event's data follows its
+/// length in the file rather than its status.
+class SmfEvent {
+    uint8_t status;
+    const uint8_t *data; // everything after the status byte
+    int size;
+
+public:
+    int tick;
+
+    SmfEvent(int tick, uint8_t status, const uint8_t *data, int size)
+        : status(status), data(data), size(size), tick(tick) {}
+
+    int getSize() const { return size; }
+    uint8_t operator[](int index) const { return index == 0 ? status : data[index - 1]; }
+
+    bool isMeta() const { return size >= 3 && status == 0xFF; }
+    bool isNoteOn() const {
+        return size == 3 && (status & 0xF0) == 0x90 && data[1] != 0;
+    }
+    bool isNoteOff() const {
+        return size == 3
+            && ((status & 0xF0) == 0x80 || ((status & 0xF0) == 0x90 && data[1] == 0));
+    }
+    bool isTempo() const { return isMeta() && data[0] == 0x51 && size == 6; }
+    /// Microseconds per quarter note, or -1 if this isn't a tempo event.
+    int getTempoMicroseconds() const {
+        return isTempo() ? (data[2] << 16) + (data[3] << 8) + data[4] : -1;
+    }
+    double getTempoBPM() const {
+        int microseconds = getTempoMicroseconds();
+        return microseconds < 0 ? -1.0 : 60000000.0 / (double)microseconds;
+    }
+};
+
+class SmfFile {
+public:
+    /// Picks the tracks to decode, by index and track name
+    using TrackFilter = std::function<bool(int track, const std::string &name)>;
+
+private:
+    // Messages up to this long are stored in their header
+    static constexpr int InlineBytes = 4;
+
+    struct EventHeader {
+        int32_t tick;
+        uint32_t size;
+        uint8_t inlineBytes[InlineBytes]; // the status byte always, the rest if it fits
+        uint32_t payload; // offset into source of the bytes after the status, if not
+    };
+    struct TickTime {
+        int tick;
+        double seconds;
+    };
+    // Where a track's events are in the file, found by scanning it to its end-of-track
+    struct TrackEntry {
+        size_t offset = 0;
+        size_t length = 0;
+        std::string name; // its first track name event
+        bool decoded = false;
+    };
+    struct TempoChange {
+        int tick;
+        double secondsPerTick;
+    };
+    // What the time map is built from, gathered while the tracks are read
+    struct TimingEvents {
+        std::vector<int> ticks; // each track's distinct ticks, one run per track
+        std::vector<size_t> runStarts;
+        std::vector<TempoChange> tempos; // in track order
+    };
+
+    std::vector<EventHeader> events;
+    std::vector<double> eventSeconds;
+    std::vector<uint32_t> trackStarts; // track i is events[trackStarts[i], trackStarts[i + 1])
+    // The file being read, which long messages point into: file's mapping, or the
+    // caller's buffer
+    Encore::MappedFile file;
+    const uint8_t *source = nullptr;
+    std::vector<TickTime> timeMap;
+    std::vector<TrackEntry> directory;
+    int ticksPerQuarterNote = 0;
+
+    void Clear();
+    bool Decode(const uint8_t *data, size_t size, const TrackFilter &decodeTrack);
+    // Reads one track up to its end-of-track event. Its ticks and tempos go to timing
+    // if there is one, and its events are only kept if store is set.
+    bool ReadTrack(
+        const uint8_t *&data,
+        const uint8_t *end,
+        TrackEntry &track,
+        TimingEvents *timing,
+        bool store
+    );
+    void AddEvent(int tick, uint8_t status, const uint8_t *data, uint32_t size);
+    void BuildTimeMap(TimingEvents &timing);
+
+public:
+    /// Reads a file, decoding every track or only the ones decodeTrack picks. Returns
+    /// false, leaving no tracks, if it can't be read or isn't a format 0 or 1 MIDI file.
+    bool Read(const std::filesystem::path &path, const TrackFilter &decodeTrack = {});
+    /// Same, from a file already in memory. Events point into data, so it has to
+    /// outlive this SmfFile or the next Read().
+    bool Read(const uint8_t *data, size_t size, const TrackFilter &decodeTrack = {});
+
+    int TrackCount() const { return (int)trackStarts.size() - 1; }
+    const std::string &TrackName(int track) const { return directory[track].name; }
+    /// Whether the track's events were read. Tracks left out have no events.
+    bool TrackDecoded(int track) const { return directory[track].decoded; }
+    int EventCount(int track) const {
+        return (int)(trackStarts[track + 1] - trackStarts[track]);
+    }
+    int TicksPerQuarterNote() const { return ticksPerQuarterNote; }
+
+    SmfEvent Event(int track, int index) const {
+        const EventHeader &header = events[trackStarts[track] + index];
+        const uint8_t *data = header.size <= InlineBytes ? header.inlineBytes + 1
+                                                         : source + header.payload;
+        return { header.tick, header.inlineBytes[0], data, (int)header.size };
+    }
+
+    /// When an event happens, in seconds.
+    double Seconds(int track, int index) const {
+        return eventSeconds[trackStarts[track] + index];
+    }
+    /// The time at any tick, interpolating between events. -1 outside the song, like
+    /// smf::MidiFile::getTimeInSeconds(tick).
+    double SecondsAtTick(int tick) const;
+    /// The tick at a time in seconds, like smf::MidiFile::getAbsoluteTickTime().
+    double TickAtSeconds(double seconds) const;
+};
@@ -6,7 +6,10 @@
 
 
 #include "inih/INIReader.h"
+#include "rapidjson/reader.h"
+#include <climits>
 #include <map>
+#include <string_view>
 
 std::map<std::string, int> IniStems = {
     { "song", Invalid },        { "guitar", PartGuitar },   { "bass", PartBass },
@@ -16,36 +19,394 @@ std::map<std::string, int> IniStems = {
     { "drums_4", PartDrums },   { "crowd", Invalid }
 };
 
-void Song::LoadVideoPath() {
-    videoPath = "";
-    std::filesystem::path songDir = songInfoPath.parent_path();
+namespace {
+    // Fills a Song from info.json as rapidjson streams through it. Only the root object,
+    // "diff", "stems" and "charters"/"charter" are looked into; everything else is
+    // skipped without being stored.
+    class SongInfoHandler
+        : public rapidjson::BaseReaderHandler<rapidjson::UTF8<>, SongInfoHandler> {
+        enum Field {
+            None,
+            Title,
+            Artist,
+            Album,
+            Source,
+            Length,
+            ReleaseYear,
+            LoadingPhrase,
+            IconDrums,
+            IconBass,
+            IconGuitar,
+            IconVocals,
+            Midi,
+            Art,
+            Diff,
+            Stems,
+            Charters,
+            PreviewStart
+        };
+
+        Song &song;
+        const SongFolderSnapshot &folder;
+        // 'O' or 'A' per open container; the root object is depth 1
+        std::vector<char> containers;
+        Field field = None;
+        std::string subKey; // key inside "diff" or "stems"
+
+        static Field FieldFromKey(std::string_view key) {
+            static const std::unordered_map<std::string_view, Field> fields = {
+                { "title", Title },
+                { "artist", Artist },
+                { "album", Album },
+                { "source", Source },
+                { "length", Length },
+                { "release_year", ReleaseYear },
+                { "loading_phrase", LoadingPhrase },
+                { "sid", IconDrums },
+                { "icon_drums", IconDrums },
+                { "sib", IconBass },
+                { "icon_bass", IconBass },
+                { "sig", IconGuitar },
+                { "icon_guitar", IconGuitar },
+                { "siv", IconVocals },
+                { "icon_vocals", IconVocals },
+                { "midi", Midi },
+                { "art", Art },
+                { "diff", Diff },
+                { "stems", Stems },
+                { "charters", Charters },
+                { "charter", Charters },
+                { "preview_start_time", PreviewStart }
+            };
+            auto it = fields.find(key);
+            return it == fields.end() ? None : it->second;
+        }
+
+        static int DiffPart(std::string_view part) {
+            static const std::unordered_map<std::string_view, int> diffParts = {
+                { "ds", PartDrums },          { "drums", PartDrums },
+                { "ba", PartBass },           { "bass", PartBass },
+                { "gr", PartGuitar },         { "guitar", PartGuitar },
+                { "vl", PartVocals },         { "vocals", PartVocals },
+                { "ky", PartKeys },           { "keys", PartKeys },
+                { "pd", PlasticDrums },       { "plastic_drums", PlasticDrums },
+                { "pb", PlasticBass },        { "plastic_bass", PlasticBass },
+                { "pg", PlasticGuitar },      { "plastic_guitar", PlasticGuitar },
+                { "pk", PlasticKeys },        { "plastic_keys", PlasticKeys },
+                { "pv", PlasticVocals },      { "plastic_vocals", PlasticVocals },
+                { "tv", PitchedVocals },      { "pitched_vocals", PitchedVocals }
+            };
+            auto it = diffParts.find(part);
+            return it == diffParts.end() ? -1 : it->second;
+        }
+
+        // Audio stream instrument for a stem name; -1 plays at the inactive volume
+        static int StemPart(std::string_view stem) {
+            if (stem == "drums")
+                return PartDrums;
+            if (stem == "bass")
+                return PartBass;
+            if (stem == "lead")
+                return PartGuitar;
+            if (stem == "vocals")
+                return PartVocals;
+            if (stem == "backing")
+                return 5;
+            return -1;
+        }
+
+        static void SetIcon(PartIcon &icon, std::string_view name) {
+            auto it = stringToEnum.find(std::string(name));
+            if (it != stringToEnum.end())
+                icon = it->second;
+        }
+
+        [[nodiscard]]
+        size_t depth() const { return containers.size(); }
+
+        void AddStem(std::string_view path) {
+            if (folder.HasFile(std::filesystem::path(path))) {
+                song.stemsPath.push_back(
+                    { (song.songDir / std::filesystem::path(path)).string(), StemPart(subKey) }
+                );
+            }
+        }
+
+    public:
+        bool hasSource = false;
+        bool hasReleaseYear = false;
+        bool hasPreviewStart = false;
+
+        SongInfoHandler(Song &song, const SongFolderSnapshot &folder)
+            : song(song), folder(folder) {}
+
+        bool StartObject() {
+            containers.push_back('O');
+            return true;
+        }
+        bool EndObject(rapidjson::SizeType) {
+            containers.pop_back();
+            return true;
+        }
+        bool StartArray() {
+            containers.push_back('A');
+            return true;
+        }
+        bool EndArray(rapidjson::SizeType) {
+            containers.pop_back();
+            return true;
+        }
+
+        bool Key(const char *str, rapidjson::SizeType length, bool) {
+            std::string_view key(str, length);
+            if (depth() == 1) {
+                field = FieldFromKey(key);
+                subKey.clear();
+            } else if (depth() == 2 && containers[1] == 'O') {
+                subKey = key;
+            }
+            return true;
+        }
+
+        bool String(const char *str, rapidjson::SizeType length, bool) {
+            std::string_view value(str, length);
+            if (depth() == 1) {
+                switch (field) {
+                case Title:
+                    song.title = value;
+                    break;
+                case Artist:
+                    song.artist = value;
+                    break;
+                case Album:
+                    song.album = value;
+                    break;
+                case Source:
+                    song.source = value;
+                    hasSource = !value.empty();
+                    break;
+                case ReleaseYear:
+                    song.releaseYear = value;
+                    hasReleaseYear = !value.empty();
+                    break;
+                case LoadingPhrase:
+                    song.loadingPhrase = value;
+                    break;
+                case IconDrums:
+                    SetIcon(song.partIcons[0], value);
+                    break;
+                case IconBass:
+                    SetIcon(song.partIcons[1], value);
+                    break;
+                case IconGuitar:
+                    SetIcon(song.partIcons[2], value);
+                    break;
+                case IconVocals:
+                    SetIcon(song.partIcons[3], value);
+                    break;
+                case Midi:
+                    song.midiPath = song.songDir / std::filesystem::path(value);
+                    break;
+                case Art:
+                    song.albumArtPath = (song.songDir / std::filesystem::path(value)).string();
+                    break;
+                case Charters:
+                    song.charters.emplace_back(value);
+                    break;
+                case Stems:
+                default:
+                    break;
+                }
+            } else if (field == Charters && depth() == 2 && containers[1] == 'A') {
+                song.charters.emplace_back(value);
+            } else if (field == Stems && containers[1] == 'O'
+                       && (depth() == 2 || (depth() == 3 && containers[2] == 'A'))) {
+                AddStem(value);
+            }
+            return true;
+        }
+
+        bool Int(int value) {
+            if (depth() == 1) {
+                if (field == Length) {
+                    song.length = value;
+                } else if (field == ReleaseYear) {
+                    song.releaseYear = std::to_string(value);
+                    hasReleaseYear = true;
+                } else if (field == PreviewStart) {
+                    song.previewStartTime = static_cast<float>(value);
+                    hasPreviewStart = true;
+                }
+            } else if (field == Diff && depth() == 2 && containers[1] == 'O') {
+                int part = DiffPart(subKey);
+                if (part >= 0)
+                    song.parts[part]->diff = value;
+            }
+            return true;
+        }
+        bool Uint(unsigned value) {
+            return value <= INT_MAX ? Int((int)value) : true;
+        }
+    };
+}
+
+void Song::LoadSong(std::filesystem::path jsonPath, const SongFolderSnapshot &folder) {
+    std::ifstream ifs(jsonPath, std::ios::binary | std::ios::ate);
+    if (!ifs.is_open()) {
+        Encore::EncoreLogFormat(LOG_ERROR, "Failed to open song JSON file. %s", jsonPath.string().c_str());
+    }
+    std::string jsonString;
+    if (ifs) {
+        jsonString.resize((size_t)ifs.tellg());
+        ifs.seekg(0);
+        ifs.read(jsonString.data(), (std::streamsize)jsonString.size());
+    }
+    ifs.close();
+    jsonHash = picosha2::hash256_hex_string(jsonString);
 
-    if (!std::filesystem::exists(songDir)) return;
+    songInfoPath = jsonPath;
+    songDir = jsonPath.parent_path();
+    stemsPath.clear();
+    charters.clear();
 
-    for (const auto &entry : std::filesystem::directory_iterator(songDir)) {
-        if (entry.is_regular_file() && entry.path().filename() == "video.mp4") {
-            videoPath = entry.path();
-            break;
+    // Parsed in place; the text isn't needed once it's hashed
+    SongInfoHandler handler(*this, folder);
+    rapidjson::Reader reader;
+    rapidjson::InsituStringStream stream(jsonString.data());
+    if (reader.Parse<rapidjson::kParseInsituFlag>(stream, handler).IsError()) {
+        Encore::EncoreLogFormat(LOG_WARNING, "Song JSON %s is malformed at offset %zu", jsonPath.string().c_str(), reader.GetErrorOffset());
+    }
+
+    if (!handler.hasSource)
+        source = "Unknown Source";
+    if (!handler.hasReleaseYear)
+        releaseYear = "Unknown Year";
+    if (!handler.hasPreviewStart)
+        previewStartTime = 3000;
+    if (charters.empty())
+        charters.push_back("Unknown Charter");
+}
+
+static SongParts TrackPart(MidiTrackView track, bool ini) {
+    for (int events = 0; events < track.getSize(); events++) {
+        if (!track[events].isMeta())
+            continue;
+        if ((int)track[events][1] == 3) {
+            std::string trackName;
+            for (int k = 3; k < track[events].getSize(); k++) {
+                trackName += track[events][k];
+            }
+            return ini ? partFromStringINI(trackName) : partFromString(trackName);
         }
     }
+    return Invalid;
 }
 
-void Song::LoadInfoINI(std::filesystem::path iniPath) {
-    for (const auto &entry : std::filesystem::directory_iterator(iniPath.parent_path())) {
-        if (entry.is_regular_file()) {
-            std::string base_filename = entry.path().string().substr(
-                entry.path().string().find_last_of("/\\") + 1
-            );
-            std::string::size_type const p(base_filename.find_last_of('.'));
-            std::string file_without_extension = base_filename.substr(0, p);
-
-            if (file_without_extension == "album") {
-                albumArtPath = entry.path().string();
+static const int DiffNoteRanges[4][2] = { { 60, 64 }, { 72, 76 }, { 84, 88 }, { 96, 100 } };
+
+static void SummarizeChart(const SmfFile &midiFile, bool ini, ChartSummary &summary) {
+    summary.BeatTrackID = 0;
+    summary.parts = {};
+    for (int track = 0; track < midiFile.TrackCount(); track++) {
+        MidiTrackView events(midiFile, track);
+        SongParts songPart = TrackPart(events, ini);
+        if (songPart == BeatLines) {
+            summary.BeatTrackID = track;
+            continue;
+        }
+        if (songPart == Invalid || songPart == PitchedVocals || songPart == Events)
+            continue;
+
+        std::array<uint32_t, 4> noteCount { 0, 0, 0, 0 };
+        for (int i = 0; i < events.getSize(); i++) {
+            if (!events[i].isNoteOn() || events[i].isMeta())
+                continue;
+            int pitch = (int)events[i][1];
+            for (int diff = 0; diff < 4; diff++) {
+                if (pitch >= DiffNoteRanges[diff][0] && pitch <= DiffNoteRanges[diff][1])
+                    noteCount[diff]++;
             }
-            if (base_filename == "notes.mid") {
-                midiPath = entry.path();
+        }
+
+        // Only the first track for a part is played, later ones just count towards
+        // hasPart
+        ChartSummaryPart &part = summary.parts[songPart];
+        for (int diff = 0; diff < 4; diff++) {
+            if (noteCount[diff] == 0)
+                continue;
+            part.hasPart = true;
+            if (!part.charted) {
+                part.track[diff] = (int16_t)track;
+                part.noteCount[diff] = noteCount[diff];
             }
         }
+        if (songPart > PartVocals && songPart < PlasticVocals)
+            part.plastic = true;
+        if (songPart < PlasticVocals)
+            part.charted = true;
+    }
+}
+
+bool Song::UpdateChartSummary() {
+    Encore::FileStamp stamp;
+    bool exists = Encore::GetFileStamp(midiPath, stamp);
+    if (chartSummary.valid && exists && stamp == chartSummary.midiStamp)
+        return false;
+
+    std::ifstream ifs(midiPath, std::ios::binary);
+    std::string midiData(
+        (std::istreambuf_iterator<char>(ifs)), std::istreambuf_iterator<char>()
+    );
+    std::string hash = picosha2::hash256_hex_string(midiData);
+    chartSummary.midiStamp = stamp;
+    if (chartSummary.valid && exists && hash == chartSummary.midiHash)
+        return true;
+
+    SmfFile midiFile;
+    midiFile.Read((const uint8_t *)midiData.data(), midiData.size());
+    SummarizeChart(midiFile, ini, chartSummary);
+    chartSummary.midiHash = hash;
+    chartSummary.valid = exists;
+    Encore::EncoreLogFormat(LOG_DEBUG, "Summarized chart %s", midiPath.string().c_str());
+    return true;
+}
+
+void Song::ApplyChartSummary() {
+    BeatTrackID = chartSummary.BeatTrackID;
+    for (size_t i = 0; i < parts.size() && i < chartSummary.parts.size(); i++) {
+        const ChartSummaryPart &summary = chartSummary.parts[i];
+        SongPart &part = *parts[i];
+        part.hasPart = summary.hasPart;
+        part.plastic = summary.plastic;
+        part.charts.clear();
+        for (int diff = 0; diff < 4; diff++) {
+            part.ValidDiffs[diff] = summary.track[diff] >= 0;
+            if (!summary.charted)
+                continue;
+            Chart &chart = part.charts.emplace_back();
+            if (summary.track[diff] >= 0) {
+                chart.valid = true;
+                chart.diff = diff;
+                chart.track = summary.track[diff];
+            }
+        }
+    }
+}
+
+void Song::LoadVideoPath(const SongFolderSnapshot &folder) {
+    videoPath = "";
+    if (folder.Contains("video.mp4")) {
+        videoPath = folder.path() / "video.mp4";
+    }
+}
+
+void Song::LoadInfoINI(std::filesystem::path iniPath, const SongFolderSnapshot &folder) {
+    std::filesystem::path art = folder.FindStem("album");
+    if (!art.empty()) {
+        albumArtPath = art.string();
+    }
+    if (folder.Contains("notes.mid")) {
+        midiPath = folder.path() / "notes.mid";
     }
 
     INIReader ini(iniPath.string());
@@ -55,6 +416,7 @@ void Song::LoadInfoINI(std::filesystem::path iniPath) {
     artist = ini.GetString("song", "artist", "Unknown Artist");
 
     // genre = ini.GetValue("song", "genre");
+    charters.clear();
     charters.push_back(ini.GetString("song", "charter", "Unknown Charter"));
 
     album = ini.GetString("song", "album", "Unknown Album");
@@ -86,44 +448,20 @@ void Song::LoadInfoINI(std::filesystem::path iniPath) {
 
     parts[PartVocals]->diff = ini.GetInteger("song", "diff_vocals_pad", -1);
 
-    LoadVideoPath();
+    LoadVideoPath(folder);
 }
 
-void Song::LoadSongIni(std::filesystem::path songPath) {
-    for (const auto &entry : std::filesystem::directory_iterator(songPath)) {
-        if (entry.is_regular_file()) {
-            std::string base_filename = entry.path().string().substr(
-                entry.path().string().find_last_of("/\\") + 1
-            );
-            std::string::size_type const p(base_filename.find_last_of('.'));
-            std::string file_without_extension = base_filename.substr(0, p);
-
-            if (file_without_extension == "album") {
-                albumArtPath = entry.path().string();
-            }
-            if (base_filename == "notes.mid") {
-                midiPath = entry.path();
-            }
-        }
-    }
-    LoadInfoINI(songInfoPath);
-    LoadAudioINI(songPath);
+void Song::LoadSongIni(std::filesystem::path songPath, const SongFolderSnapshot &folder) {
+    LoadInfoINI(songInfoPath, folder);
+    LoadAudioINI(songPath, folder);
 }
 
-void Song::LoadAudioINI(std::filesystem::path songPath) {
-    for (const auto &entry : std::filesystem::directory_iterator(songPath)) {
-        if (entry.is_regular_file()) {
-            std::string base_filename = entry.path().string().substr(
-                entry.path().string().find_last_of("/\\") + 1
-            );
-            std::string::size_type const p(base_filename.find_last_of('.'));
-            std::string file_without_extension = base_filename.substr(0, p);
-            for (auto filename : IniStems) {
-                if (file_without_extension == filename.first
-                    && base_filename != "song.ini") {
-                    stemsPath.push_back({ entry.path().string(), filename.second });
-                }
-            }
+void Song::LoadAudioINI(std::filesystem::path songPath, const SongFolderSnapshot &folder) {
+    stemsPath.clear();
+    for (const auto &file : folder.Files()) {
+        auto stem = IniStems.find(file.stem);
+        if (stem != IniStems.end() && file.name != "song.ini") {
+            stemsPath.push_back({ (songPath / file.name).string(), stem->second });
         }
     }
 }
@@ -5,7 +5,6 @@
 
 #include "raylib.h"
 #include "chart.h"
-#include "midifile/MidiFile.h"
 #include <vector>
 #include <iostream>
 #include <fstream>
@@ -14,9 +13,13 @@
 #include <cmath>
 #include <string>
 #include <atomic>
+#include <memory>
 #include "picosha2.h"
 #include "rapidjson/document.h"
 #include "util/enclog.h"
+#include "util/file-stamp.h"
+#include "songfolder.h"
+#include "artcache.h"
 
 #include <array>
 
@@ -57,12 +60,31 @@ struct SongPart {
     int diff = -1;
     int TrackInt = -1;
     bool Valid = false;
+    // Difficulties with notes, by Difficulty; set even when charts is left empty
     std::array<bool, 4> ValidDiffs { false, false, false, false };
     std::vector<Chart> charts;
     bool hasPart = false;
     bool plastic = false;
 };
 
+// What ready-up needs to know about each part of a song's MIDI, cached so the file
+// only has to be read again when it changes.
+struct ChartSummaryPart {
+    bool hasPart = false;
+    bool plastic = false;
+    bool charted = false; // a track for this part exists, even if it has no notes
+    std::array<int16_t, 4> track { -1, -1, -1, -1 }; // -1 if the difficulty has no notes
+    std::array<uint32_t, 4> noteCount { 0, 0, 0, 0 };
+};
+
+struct ChartSummary {
+    bool valid = false;
+    Encore::FileStamp midiStamp;
+    std::string midiHash;
+    int BeatTrackID = 0;
+    std::array<ChartSummaryPart, PitchedVocals + 1> parts {};
+};
+
 struct Beat {
     double Time;
     bool Major = false;
@@ -163,13 +185,7 @@ class Song {
 public:
     bool midiParsed = false;
     std::string title = "";
-    float titleXOffset = 0;
-    float titleTextWidth = 0;
-    double titleScrollTime = 0.0;
     std::string artist = "";
-    float artistXOffset = 0;
-    float artistTextWidth = 0;
-    double artistScrollTime = 0.0;
     Texture albumArtBlur;
     Texture albumArt;
     std::string source = "custom";
@@ -186,10 +202,14 @@ public:
     };
     // Parts order will always be Drums, Bass, Guitar, Vocals, Plastic Drums, Plastic
     // Bass, Plastic Guitar
-    std::vector<SongPart *> parts { new SongPart, new SongPart, new SongPart,
-                                    new SongPart, new SongPart, new SongPart,
-                                    new SongPart, new SongPart, new SongPart,
-                                    new SongPart, new SongPart };
+    std::vector<std::shared_ptr<SongPart> > parts {
+        std::make_shared<SongPart>(), std::make_shared<SongPart>(),
+        std::make_shared<SongPart>(), std::make_shared<SongPart>(),
+        std::make_shared<SongPart>(), std::make_shared<SongPart>(),
+        std::make_shared<SongPart>(), std::make_shared<SongPart>(),
+        std::make_shared<SongPart>(), std::make_shared<SongPart>(),
+        std::make_shared<SongPart>()
+    };
 
     std::vector<Beat> beatLines; // double time, bool downbeat
 
@@ -205,6 +225,9 @@ public:
     std::string loadingPhrase = "";
     std::vector<std::string> charters {};
     std::string jsonHash = "";
+    // size/mtime of songInfoPath when jsonHash was taken
+    Encore::FileStamp infoStamp;
+    ChartSummary chartSummary;
     int hopoThreshold = 170;
     bool ini = false;
     float previewStartTime = 0.0f;
@@ -212,450 +235,38 @@ public:
     std::vector<BPM> bpms {};
     std::vector<TimeSig> timesigs {};
 
-    void LoadAudioINI(std::filesystem::path songPath);
-    void LoadVideoPath();
-
-    void LoadAudio(std::filesystem::path jsonPath) {
-        std::ifstream ifs(jsonPath);
-
-        if (!ifs.is_open()) {
-            std::cerr << "Failed to open JSON file." << std::endl;
-        }
-        if (!stemsPath.empty())
-            stemsPath.clear();
-        if (!charters.empty())
-            charters.clear();
-        std::string jsonString(
-            (std::istreambuf_iterator<char>(ifs)), std::istreambuf_iterator<char>()
-        );
-        ifs.close();
-        jsonHash = picosha2::hash256_hex_string(jsonString);
-        rapidjson::Document document;
-        document.Parse(jsonString.c_str());
-        songInfoPath = jsonPath;
-        songDir = jsonPath.parent_path();
-
-        if (document.IsObject()) {
-            for (auto &item : document.GetObject()) {
-                if (item.name == "stems" && item.value.IsObject()) {
-                    for (auto &path : item.value.GetObject()) {
-                        std::string stem = std::string(path.name.GetString());
-                        if (path.value.IsString()) {
-                            if (std::filesystem::exists(
-                                    jsonPath.parent_path() / path.value.GetString()
-                                )) {
-                                if (stem == "drums")
-                                    stemsPath.push_back(
-                                        { (jsonPath.parent_path() / path.value.GetString()
-                                          )
-                                              .string(),
-                                          PartDrums }
-                                    );
-
-                                else if (stem == "bass")
-                                    stemsPath.push_back(
-                                        { (jsonPath.parent_path() / path.value.GetString()
-                                          )
-                                              .string(),
-                                          PartBass }
-                                    );
-
-                                else if (stem == "lead")
-                                    stemsPath.push_back(
-                                        { (jsonPath.parent_path() / path.value.GetString()
-                                          )
-                                              .string(),
-                                          PartGuitar }
-                                    );
-
-                                else if (stem == "vocals")
-                                    stemsPath.push_back(
-                                        { (jsonPath.parent_path() / path.value.GetString()
-                                          )
-                                              .string(),
-                                          PartVocals }
-                                    );
-
-                                else if (stem == "backing")
-                                    stemsPath.push_back(
-                                        { (jsonPath.parent_path() / path.value.GetString()
-                                          )
-                                              .string(),
-                                          5 }
-                                    );
-                            }
-                        } else if (path.value.IsArray()) {
-                            for (auto &path2 : path.value.GetArray()) {
-                                if (std::filesystem::exists(
-                                        jsonPath.parent_path() / path2.GetString()
-                                    )) {
-                                    if (stem == "drums")
-                                        stemsPath.push_back(
-                                            { (jsonPath.parent_path() / path2.GetString())
-                                                  .string(),
-                                              PartDrums }
-                                        );
-
-                                    else if (stem == "bass")
-                                        stemsPath.push_back(
-                                            { (jsonPath.parent_path() / path2.GetString())
-                                                  .string(),
-                                              PartBass }
-                                        );
-
-                                    else if (stem == "lead")
-                                        stemsPath.push_back(
-                                            { (jsonPath.parent_path() / path2.GetString())
-                                                  .string(),
-                                              PartGuitar }
-                                        );
-
-                                    else if (stem == "vocals")
-                                        stemsPath.push_back(
-                                            { (jsonPath.parent_path() / path2.GetString())
-                                                  .string(),
-                                              PartVocals }
-                                        );
-
-                                    else if (stem == "backing")
-                                        stemsPath.push_back(
-                                            { (jsonPath.parent_path() / path2.GetString())
-                                                  .string(),
-                                              5 }
-                                        );
-                                }
-                            }
-                        }
-                    }
-                }
-            }
-        }
-        ifs.close();
+    void LoadAudioINI(std::filesystem::path songPath, const SongFolderSnapshot &folder);
+    void LoadAudioINI(std::filesystem::path songPath) {
+        LoadAudioINI(songPath, SongFolderSnapshot(songPath));
     }
-
-    void LoadInfoINI(std::filesystem::path iniPath);
-
-    void LoadInfo(std::filesystem::path jsonPath) {
-        std::ifstream ifs(jsonPath);
-
-        if (!ifs.is_open()) {
-            std::cerr << "Failed to open JSON file." << std::endl;
-        }
-        if (!stemsPath.empty())
-            stemsPath.clear();
-        if (!charters.empty())
-            charters.clear();
-        std::string jsonString(
-            (std::istreambuf_iterator<char>(ifs)), std::istreambuf_iterator<char>()
-        );
-        ifs.close();
-        jsonHash = picosha2::hash256_hex_string(jsonString);
-        rapidjson::Document document;
-        document.Parse(jsonString.c_str());
-        songInfoPath = jsonPath;
-        songDir = jsonPath.parent_path();
-        for (auto &item : document.GetObject()) {
-            if (item.name == "title" && item.value.IsString())
-                title = item.value.GetString();
-            if (item.name == "artist" && item.value.IsString())
-                artist = item.value.GetString();
-            if (item.name == "album" && item.value.IsString())
-                album = item.value.GetString();
-            if (item.name == "source" && item.value.IsString())
-                source = item.value.GetString();
-            if (item.name == "length" && item.value.IsInt())
-                length = item.value.GetInt();
-            if (item.name == "release_year" && item.value.IsString())
-                releaseYear = item.value.GetString();
-            if (item.name == "loading_phrase" && item.value.IsString())
-                loadingPhrase = item.value.GetString();
-            if ((item.name == "sid" || item.name == "icon_drums")
-                && item.value.IsString())
-                partIcons[0] = iconFromString(item.value.GetString());
-            if ((item.name == "sib" || item.name == "icon_bass") && item.value.IsString())
-                partIcons[1] = iconFromString(item.value.GetString());
-            if ((item.name == "sig" || item.name == "icon_guitar")
-                && item.value.IsString())
-                partIcons[2] = iconFromString(item.value.GetString());
-            if ((item.name == "siv" || item.name == "icon_vocals")
-                && item.value.IsString())
-                partIcons[3] = iconFromString(item.value.GetString());
-            if (item.name == "midi" && item.value.IsString())
-                midiPath = jsonPath.parent_path() / item.value.GetString();
-            if (item.name == "art" && item.value.IsString()) {
-                albumArtPath = (jsonPath.parent_path() / item.value.GetString()).string();
-            }
-            if (item.name == "diff" && item.value.IsObject()) {
-                for (auto &diff : item.value.GetObject()) {
-                    std::string part = std::string(diff.name.GetString());
-                    if (diff.value.IsInt()) {
-                        if (part == "ds" || part == "drums") {
-                            parts[PartDrums]->diff = diff.value.GetInt();
-                        } else if (part == "ba" || part == "bass") {
-                            parts[PartBass]->diff = diff.value.GetInt();
-                        } else if (part == "gr" || part == "guitar") {
-                            parts[PartGuitar]->diff = diff.value.GetInt();
-                        } else if (part == "vl" || part == "vocals") {
-                            parts[PartVocals]->diff = diff.value.GetInt();
-                        } else if (part == "ky" || part == "keys") {
-                            parts[PartKeys]->diff = diff.value.GetInt();
-                        } else if (part == "pd" || part == "plastic_drums") {
-                            parts[PlasticDrums]->diff = diff.value.GetInt();
-                        } else if (part == "pb" || part == "plastic_bass") {
-                            parts[PlasticBass]->diff = diff.value.GetInt();
-                        } else if (part == "pg" || part == "plastic_guitar") {
-                            parts[PlasticGuitar]->diff = diff.value.GetInt();
-                        } else if (part == "pk" || part == "plastic_keys") {
-                            parts[PlasticKeys]->diff = diff.value.GetInt();
-                        } else if (part == "pv" || part == "plastic_vocals") {
-                            parts[PlasticVocals]->diff = diff.value.GetInt();
-                        } else if (part == "tv" || part == "pitched_vocals") {
-                            parts[PitchedVocals]->diff = diff.value.GetInt();
-                        }
-                    }
-                }
-            }
-            if (item.name == "charters" || item.name == "charter") {
-                if (item.value.IsString()) {
-                    charters.push_back(item.value.GetString());
-                } else if (item.value.IsArray()) {
-                    for (auto &charter : item.value.GetArray()) {
-                        if (charter.IsString()) {
-                            charters.push_back(charter.GetString());
-                        }
-                    }
-                }
-            }
-            if (document.HasMember("preview_start_time") && document["preview_start_time"].IsInt()) {
-                previewStartTime = static_cast<float>(document["preview_start_time"].GetInt());
-            }
-        }
-        if (document.HasMember("stems") && document["stems"].IsObject()) {
-            for (auto &path : document["stems"].GetObject()) {
-                std::string stem = std::string(path.name.GetString());
-                int partIndex = -1;
-                if (stem == "drums") partIndex = PartDrums;
-                else if (stem == "bass") partIndex = PartBass;
-                else if (stem == "lead") partIndex = PartGuitar;
-                else if (stem == "vocals") partIndex = PartVocals;
-                else if (stem == "backing") partIndex = 5;
-
-                if (path.value.IsString()) {
-                    std::filesystem::path stemPath = jsonPath.parent_path() / path.value.GetString();
-                    if (std::filesystem::exists(stemPath)) {
-                        stemsPath.push_back({ stemPath.string(), partIndex });
-                    }
-                } else if (path.value.IsArray()) {
-                    for (auto &path2 : path.value.GetArray()) {
-                        if (path2.IsString()) {
-                            std::filesystem::path stemPath = jsonPath.parent_path() / path2.GetString();
-                            if (std::filesystem::exists(stemPath)) {
-                                stemsPath.push_back({ stemPath.string(), partIndex });
-                            }
-                        }
-                    }
-                }
-            }
-        }
-        if (charters.empty()) {
-            charters.push_back("Unknown Charter");
-        }
-        ifs.close();
+    void LoadVideoPath(const SongFolderSnapshot &folder);
+    // Makes sure chartSummary matches the MIDI on disk, reading it only if its size or
+    // mtime changed. Returns true if chartSummary was updated and should be saved.
+    bool UpdateChartSummary();
+    // Sets up parts and BeatTrackID from chartSummary
+    void ApplyChartSummary();
+
+    void LoadInfoINI(std::filesystem::path iniPath, const SongFolderSnapshot &folder);
+    void LoadInfoINI(std::filesystem::path iniPath) {
+        LoadInfoINI(iniPath, SongFolderSnapshot(iniPath.parent_path()));
     }
 
-    void LoadSongIni(std::filesystem::path songPath);
+    void LoadSongIni(std::filesystem::path songPath, const SongFolderSnapshot &folder);
+    void LoadSongIni(std::filesystem::path songPath) {
+        LoadSongIni(songPath, SongFolderSnapshot(songPath));
+    }
 
+    // Reads info.json in one streaming pass (metadata, diffs, charters, icons and stems)
+    // and hashes it. Stems are checked against the folder listing.
+    void LoadSong(std::filesystem::path jsonPath, const SongFolderSnapshot &folder);
     void LoadSong(std::filesystem::path jsonPath) {
-        std::ifstream ifs(jsonPath);
-
-        if (!ifs.is_open()) {
-            Encore::EncoreLog(
-                LOG_ERROR,
-                TextFormat("Failed to open song JSON file. %s", jsonPath.c_str())
-            );
-        }
-        if (!stemsPath.empty())
-            stemsPath.clear();
-        if (!charters.empty())
-            charters.clear();
-        std::string jsonString(
-            (std::istreambuf_iterator<char>(ifs)), std::istreambuf_iterator<char>()
-        );
-        ifs.close();
-        jsonHash = picosha2::hash256_hex_string(jsonString);
-        rapidjson::Document document;
-        document.Parse(jsonString.c_str());
-        songInfoPath = jsonPath;
-        songDir = jsonPath.parent_path();
-        if (document.IsObject()) {
-            for (auto &item : document.GetObject()) {
-                if (item.name == "title" && item.value.IsString())
-                    title = item.value.GetString();
-                if (item.name == "artist" && item.value.IsString())
-                    artist = item.value.GetString();
-                if (item.name == "album" && item.value.IsString())
-                    album = item.value.GetString();
-                if (item.name == "source" && item.value.IsString())
-                    source = item.value.GetString();
-                if (item.name == "length" && item.value.IsInt())
-                    length = item.value.GetInt();
-                if (item.name == "release_year" && item.value.IsInt())
-                    releaseYear = item.value.GetInt();
-                if (item.name == "loading_phrase" && item.value.IsString())
-                    loadingPhrase = item.value.GetString();
-                if ((item.name == "sid" || item.name == "icon_drums")
-                    && item.value.IsString())
-                    partIcons[0] = iconFromString(item.value.GetString());
-                if ((item.name == "sib" || item.name == "icon_bass")
-                    && item.value.IsString())
-                    partIcons[1] = iconFromString(item.value.GetString());
-                if ((item.name == "sig" || item.name == "icon_guitar")
-                    && item.value.IsString())
-                    partIcons[2] = iconFromString(item.value.GetString());
-                if ((item.name == "siv" || item.name == "icon_vocals")
-                    && item.value.IsString())
-                    partIcons[3] = iconFromString(item.value.GetString());
-                if (item.name == "midi" && item.value.IsString())
-                    midiPath = jsonPath.parent_path() / item.value.GetString();
-                if (item.name == "art" && item.value.IsString()) {
-                    albumArtPath =
-                        (jsonPath.parent_path() / item.value.GetString()).string();
-                }
-                if (item.name == "diff" && item.value.IsObject()) {
-                    for (auto &diff : item.value.GetObject()) {
-                        std::string part = std::string(diff.name.GetString());
-                        if (diff.value.IsInt()) {
-                            if (part == "ds" || part == "drums") {
-                                // parts[PartDrums]->diff = diff.value.GetInt();
-                            } else if (part == "ba" || part == "bass") {
-                                // parts[PartBass]->diff = diff.value.GetInt();
-                            } else if (part == "gr" || part == "guitar") {
-                                // parts[PartGuitar]->diff = diff.value.GetInt();
-                            } else if (part == "vl" || part == "vocals") {
-                                // parts[PartVocals]->diff = diff.value.GetInt();
-                            } else if (part == "pd" || part == "plastic_drums") {
-                                // parts[PlasticDrums]->diff = diff.value.GetInt();
-                            } else if (part == "pb" || part == "plastic_bass") {
-                                // parts[PlasticBass]->diff = diff.value.GetInt();
-                            } else if (part == "pg" || part == "plastic_guitar") {
-                                // parts[PlasticGuitar]->diff = diff.value.GetInt();
-                            }
-                        }
-                    }
-                }
-                if (item.name == "stems" && item.value.IsObject()) {
-                    for (auto &path : item.value.GetObject()) {
-                        std::string stem = std::string(path.name.GetString());
-                        if (path.value.IsString()) {
-                            if (std::filesystem::exists(
-                                    jsonPath.parent_path() / path.value.GetString()
-                                )) {
-                                if (stem == "drums")
-                                    stemsPath.push_back(
-                                        { (jsonPath.parent_path() / path.value.GetString()
-                                          )
-                                              .string(),
-                                          0 }
-                                    );
-
-                                else if (stem == "bass")
-                                    stemsPath.push_back(
-                                        { (jsonPath.parent_path() / path.value.GetString()
-                                          )
-                                              .string(),
-                                          1 }
-                                    );
-
-                                else if (stem == "lead")
-                                    stemsPath.push_back(
-                                        { (jsonPath.parent_path() / path.value.GetString()
-                                          )
-                                              .string(),
-                                          2 }
-                                    );
-
-                                else if (stem == "vocals")
-                                    stemsPath.push_back(
-                                        { (jsonPath.parent_path() / path.value.GetString()
-                                          )
-                                              .string(),
-                                          3 }
-                                    );
-
-                                else if (stem == "backing")
-                                    stemsPath.push_back(
-                                        { (jsonPath.parent_path() / path.value.GetString()
-                                          )
-                                              .string(),
-                                          4 }
-                                    );
-                            }
-                        } else if (path.value.IsArray()) {
-                            for (auto &path2 : path.value.GetArray()) {
-                                if (std::filesystem::exists(
-                                        jsonPath.parent_path() / path2.GetString()
-                                    )) {
-                                    if (stem == "drums")
-                                        stemsPath.push_back(
-                                            { (jsonPath.parent_path() / path2.GetString())
-                                                  .string(),
-                                              0 }
-                                        );
-
-                                    else if (stem == "bass")
-                                        stemsPath.push_back(
-                                            { (jsonPath.parent_path() / path2.GetString())
-                                                  .string(),
-                                              1 }
-                                        );
-
-                                    else if (stem == "lead")
-                                        stemsPath.push_back(
-                                            { (jsonPath.parent_path() / path2.GetString())
-                                                  .string(),
-                                              2 }
-                                        );
-
-                                    else if (stem == "vocals")
-                                        stemsPath.push_back(
-                                            { (jsonPath.parent_path() / path2.GetString())
-                                                  .string(),
-                                              3 }
-                                        );
-
-                                    else if (stem == "backing")
-                                        stemsPath.push_back(
-                                            { (jsonPath.parent_path() / path2.GetString())
-                                                  .string(),
-                                              4 }
-                                        );
-                                }
-                            }
-                        }
-                    }
-                }
-                if (item.name == "charters" || item.name == "charter") {
-                    if (item.value.IsString()) {
-                        charters.push_back(item.value.GetString());
-                    } else if (item.value.IsArray()) {
-                        for (auto &charter : item.value.GetArray()) {
-                            if (charter.IsString()) {
-                                charters.push_back(charter.GetString());
-                            }
-                        }
-                    }
-                }
-            }
-        }
-        if (charters.empty()) {
-            charters.push_back("Unknown Charter");
-        }
-        ifs.close();
+        LoadSong(jsonPath, SongFolderSnapshot(jsonPath.parent_path()));
     }
-    void parseBeatLines(smf::MidiFile &midiFile, int trkidx) {
-        int MaxTick = midiFile[trkidx].last().tick;
+
+    void parseBeatLines(const SmfFile &midiFile, int trkidx) {
+        int MaxTick = midiFile.Event(trkidx, midiFile.EventCount(trkidx) - 1).tick;
         for (int i = 0; i < MaxTick; i += 240) {
-            beatLines.push_back({ midiFile.getTimeInSeconds(i), false, false, i });
+            beatLines.push_back({ midiFile.SecondsAtTick(i), false, false, i });
         }
 
         /*
@@ -672,21 +283,21 @@ public:
         */
     }
 
-    void getTiming(smf::MidiFile &midiFile, int trkidx, smf::MidiEventList events) {
+    void getTiming(MidiTrackView events) {
         for (int i = 0; i < events.getSize(); i++) {
             if (events[i].isTempo()) {
                 bpms.push_back(
-                    { midiFile.getTimeInSeconds(trkidx, i),
+                    { events.Seconds(i),
                       events[i].getTempoBPM(),
                       events[i].tick }
                 );
-                // std::cout << "BPM @" << midiFile.getTimeInSeconds(trkidx, i) << ": "
+                // std::cout << "BPM @" << events.Seconds(i) << ": "
                 //           << events[i].getTempoBPM() << std::endl;
             } else if (events[i].isMeta() && events[i][1] == 0x58) {
                 int numer = (int)events[i][3];
                 int denom = pow(2, (int)events[i][4]);
-                timesigs.push_back({ midiFile.getTimeInSeconds(trkidx, i), numer, denom });
-                // std::cout << "TIMESIG @" << midiFile.getTimeInSeconds(trkidx, i) << ": "
+                timesigs.push_back({ events.Seconds(i), numer, denom });
+                // std::cout << "TIMESIG @" << events.Seconds(i) << ": "
                 //           << numer << "/" << denom << std::endl;
             }
         }
@@ -697,10 +308,10 @@ public:
     }
 
     int endTick = 0;
-    void getStartEnd(smf::MidiFile &midiFile, int trkidx, smf::MidiEventList events) {
+    void getStartEnd(MidiTrackView events) {
         for (int i = 0; i < events.getSize(); i++) {
             if (events[i].isMeta() && (int)events[i][1] == 1) {
-                double time = midiFile.getTimeInSeconds(trkidx, i);
+                double time = events.Seconds(i);
                 std::string evt_string = "";
                 for (int k = 3; k < events[i].getSize(); k++) {
                     evt_string += events[i][k];
@@ -708,30 +319,27 @@ public:
 
                 if (evt_string == "[music_start]") {
                     music_start = time;
-                    Encore::EncoreLog(
-                        LOG_DEBUG, TextFormat("SONG: Song start: %5.4f", time)
-                    );
+                    Encore::EncoreLogFormat(LOG_DEBUG, "SONG: Song start: %5.4f", time);
                 }
                 if (evt_string == "[end]") {
                     end = time;
                     endTick = events[i].tick;
-                    Encore::EncoreLog(
-                        LOG_DEBUG, TextFormat("SONG: Song end: %5.4f", time)
-                    );
+                    Encore::EncoreLogFormat(LOG_DEBUG, "SONG: Song end: %5.4f", time);
                 }
             }
         }
     }
     Coda BRE {};
-    void getCodas(smf::MidiFile &midiFile) {
+    void getCodas(const SmfFile &midiFile) {
         int codaCount = 0;
-        for (int track = 0; track < midiFile.getTrackCount(); track++) {
+        for (int track = 0; track < midiFile.TrackCount(); track++) {
             std::string trackName;
-            for (int events = 0; events < midiFile[track].getSize(); events++) {
-                if (midiFile[track][events].isMeta()) {
-                    if ((int)midiFile[track][events][1] == 3) {
-                        for (int k = 3; k < midiFile[track][events].getSize(); k++) {
-                            trackName += midiFile[track][events][k];
+            MidiTrackView trackEvents(midiFile, track);
+            for (int events = 0; events < trackEvents.getSize(); events++) {
+                if (trackEvents[events].isMeta()) {
+                    if ((int)trackEvents[events][1] == 3) {
+                        for (int k = 3; k < trackEvents[events].getSize(); k++) {
+                            trackName += trackEvents[events][k];
                         }
                         SongParts songPart;
                         if (ini) {
@@ -741,26 +349,26 @@ public:
                         if (songPart > PlasticDrums && songPart <= PlasticGuitar) {
                             int codaNote = 120; // i dont wanna bother with checking all
                                                 // five lanes
-                            for (int i = 0; i < midiFile[track].getSize(); i++) {
-                                if (midiFile[track][i].isNoteOn()
-                                    && !midiFile[track][i].isMeta()
-                                    && (int)midiFile[track][i][1] == codaNote) {
+                            for (int i = 0; i < trackEvents.getSize(); i++) {
+                                if (trackEvents[i].isNoteOn()
+                                    && !trackEvents[i].isMeta()
+                                    && (int)trackEvents[i][1] == codaNote) {
                                     if (BRE.StartSec == 0.0) {
-                                        BRE.StartSec = midiFile.getTimeInSeconds(
-                                            midiFile[track][i].tick
+                                        BRE.StartSec = midiFile.SecondsAtTick(
+                                            trackEvents[i].tick
                                         );
-                                        BRE.StartTick = midiFile[track][i].tick;
+                                        BRE.StartTick = trackEvents[i].tick;
                                        Encore::EncoreLog(LOG_DEBUG, "BRE start found");
                                     }
                                 }
-                                if (midiFile[track][i].isNoteOff()
-                                    && !midiFile[track][i].isMeta()
-                                    && (int)midiFile[track][i][1] == codaNote) {
+                                if (trackEvents[i].isNoteOff()
+                                    && !trackEvents[i].isMeta()
+                                    && (int)trackEvents[i][1] == codaNote) {
                                     if (BRE.EndSec == 0.0) {
-                                        BRE.EndSec = midiFile.getTimeInSeconds(
-                                            midiFile[track][i].tick
+                                        BRE.EndSec = midiFile.SecondsAtTick(
+                                            trackEvents[i].tick
                                         );
-                                       BRE.EndTick = midiFile[track][i].tick;
+                                       BRE.EndTick = trackEvents[i].tick;
                                        Encore::EncoreLog(LOG_DEBUG, "BRE end found");
                                        codaCount++;
                                     }
@@ -777,20 +385,12 @@ public:
         }
     }
 
+    // Textures belong to TheAlbumArtCache, so calling this again is cheap and nothing
+    // here needs unloading
     void LoadAlbumArt() {
-        Image albumImage = LoadImage(albumArtPath.c_str());
-        if (albumImage.height > 512) {
-            ImageResize(&albumImage, 512, 512);
-        }
-        albumArt = LoadTextureFromImage(albumImage);
-        GenTextureMipmaps(&albumArt);
-        SetTextureFilter(albumArt, TEXTURE_FILTER_TRILINEAR);
-
-        ImageBlurGaussian(&albumImage, 10);
-        albumArtBlur = LoadTextureFromImage(albumImage);
-        GenTextureMipmaps(&albumArtBlur);
-        SetTextureFilter(albumArtBlur, TEXTURE_FILTER_TRILINEAR);
-        UnloadImage(albumImage);
+        const AlbumArtTextures &textures = TheAlbumArtCache.Acquire(albumArtPath);
+        albumArt = textures.art;
+        albumArtBlur = textures.blur;
     };
 };
 
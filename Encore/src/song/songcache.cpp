@@ -0,0 +1,451 @@
+#include "songcache.h"
+
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#include <system_error>
+#include "song.h"
+#include "songcatalog.h"
+#include "util/enclog.h"
+
+namespace {
+    // Journals smaller than this are never worth compacting
+    const uintmax_t JOURNAL_COMPACT_MIN_BYTES = 64 * 1024;
+
+    const size_t CHART_SUMMARY_PART_SIZE = 1 + 4 * sizeof(int16_t) + 4 * sizeof(uint32_t);
+    const size_t CHART_SUMMARY_SIZE = sizeof(uint64_t) + sizeof(int64_t) + sizeof(int32_t)
+        + (PitchedVocals + 1) * CHART_SUMMARY_PART_SIZE;
+
+    template <typename T>
+    void Put(std::string &out, T value) {
+        out.append(reinterpret_cast<const char *>(&value), sizeof(value));
+    }
+
+    template <typename T>
+    T Take(const char *&in) {
+        T value;
+        std::memcpy(&value, in, sizeof(value));
+        in += sizeof(value);
+        return value;
+    }
+}
+
+std::filesystem::path NormalizeSongRoot(const std::filesystem::path &root) {
+    std::filesystem::path normal = root.lexically_normal();
+    if (!normal.has_filename() && normal != normal.root_path()) {
+        normal = normal.parent_path();
+    }
+    return normal;
+}
+
+static std::filesystem::path ShardBasePath(const std::filesystem::path &root) {
+    // FNV-1a; only has to tell a handful of roots apart, and the header says which root
+    // a shard is for anyway
+    uint64_t hash = 0xcbf29ce484222325ull;
+    for (char c : NormalizeSongRoot(root).string()) {
+        hash = (hash ^ (uint8_t)c) * 0x100000001b3ull;
+    }
+    char name[17];
+    std::snprintf(name, sizeof(name), "%016llx", (unsigned long long)hash);
+    return std::filesystem::path(SONG_CACHE_DIR) / name;
+}
+
+std::filesystem::path SongCacheShardPath(const std::filesystem::path &root) {
+    return ShardBasePath(root).replace_extension(".encr");
+}
+
+std::filesystem::path SongCacheJournalPath(const std::filesystem::path &root) {
+    return ShardBasePath(root).replace_extension(".journal");
+}
+
+std::string EncodeChartSummary(const ChartSummary &summary) {
+    std::string blob;
+    if (!summary.valid) {
+        return blob;
+    }
+    blob.reserve(CHART_SUMMARY_SIZE);
+    Put<uint64_t>(blob, summary.midiStamp.size);
+    Put<int64_t>(blob, summary.midiStamp.modified);
+    Put<int32_t>(blob, summary.BeatTrackID);
+    for (const auto &part : summary.parts) {
+        Put<uint8_t>(blob, part.hasPart | part.plastic << 1 | part.charted << 2);
+        for (int16_t track : part.track) {
+            Put<int16_t>(blob, track);
+        }
+        for (uint32_t count : part.noteCount) {
+            Put<uint32_t>(blob, count);
+        }
+    }
+    return blob;
+}
+
+void DecodeChartSummary(std::string_view blob, ChartSummary &summary) {
+    summary.valid = false;
+    if (blob.size() != CHART_SUMMARY_SIZE) {
+        return;
+    }
+    const char *in = blob.data();
+    summary.midiStamp.size = Take<uint64_t>(in);
+    summary.midiStamp.modified = Take<int64_t>(in);
+    summary.BeatTrackID = Take<int32_t>(in);
+    for (auto &part : summary.parts) {
+        uint8_t flags = Take<uint8_t>(in);
+        part.hasPart = flags & 1;
+        part.plastic = flags & 2;
+        part.charted = flags & 4;
+        for (int16_t &track : part.track) {
+            track = Take<int16_t>(in);
+        }
+        for (uint32_t &count : part.noteCount) {
+            count = Take<uint32_t>(in);
+        }
+    }
+    summary.valid = true;
+}
+
+bool SongCacheView::Open(const std::filesystem::path &path, const std::filesystem::path &root) {
+    Close();
+    if (!file.Open(path)) {
+        Encore::EncoreLogFormat(LOG_INFO, "CACHE: No cache for %s", root.string().c_str());
+        return false;
+    }
+
+    SongCacheHeader header;
+    if (file.size() < sizeof(header)) {
+        Encore::EncoreLog(LOG_WARNING, "CACHE: Song cache is truncated, rescanning");
+        Close();
+        return false;
+    }
+    std::memcpy(&header, file.data(), sizeof(header));
+
+    if (header.header != SONG_CACHE_HEADER) {
+        Encore::EncoreLog(LOG_WARNING, "CACHE: Invalid song cache format, rescanning");
+        Close();
+        return false;
+    }
+    if (header.version != SONG_CACHE_VERSION) {
+        Encore::EncoreLogFormat(LOG_WARNING, "CACHE: Cache version %01i, but current version is %01i", (int)header.version, (int)SONG_CACHE_VERSION);
+        Close();
+        return false;
+    }
+
+    // No sums of header fields, so a corrupt offset can't wrap around the checks
+    if (header.recordsOffset % alignof(SongCacheRecord) != 0
+        || header.recordsOffset > file.size()
+        || header.songCount > (file.size() - header.recordsOffset) / sizeof(SongCacheRecord)
+        || header.stringsOffset > file.size()
+        || header.stringsSize > file.size() - header.stringsOffset) {
+        Encore::EncoreLog(LOG_WARNING, "CACHE: Song cache is truncated, rescanning");
+        Close();
+        return false;
+    }
+
+    records = reinterpret_cast<const SongCacheRecord *>(file.data() + header.recordsOffset);
+    recordCount = header.songCount;
+    strings = reinterpret_cast<const char *>(file.data() + header.stringsOffset);
+    stringsSize = header.stringsSize;
+    if (String(header.root) != NormalizeSongRoot(root).string()) {
+        Encore::EncoreLogFormat(LOG_WARNING, "CACHE: Cache for %s belongs to another folder, rescanning", root.string().c_str());
+        Close();
+        return false;
+    }
+    return true;
+}
+
+void SongCacheView::Close() {
+    file.Close();
+    records = nullptr;
+    strings = nullptr;
+    recordCount = 0;
+    stringsSize = 0;
+}
+
+std::string_view SongCacheView::String(const SongCacheString &ref) const {
+    if (ref.offset > stringsSize || ref.length > stringsSize - ref.offset) {
+        return {};
+    }
+    return { strings + ref.offset, ref.length };
+}
+
+void SongCacheView::FillEntry(const SongCacheRecord &record, SongCatalogEntry &entry) const {
+    entry.songDir = String(record.songDir);
+    entry.songInfoPath = String(record.songInfoPath);
+    entry.albumArtPath = String(record.albumArtPath);
+    entry.jsonHash = String(record.jsonHash);
+    entry.title = String(record.title);
+    entry.artist = String(record.artist);
+    entry.source = String(record.source);
+    entry.album = String(record.album);
+    entry.releaseYear = String(record.releaseYear);
+    entry.titleKey = String(record.titleKey);
+    entry.artistKey = String(record.artistKey);
+    entry.albumKey = String(record.albumKey);
+    entry.sourceKey = String(record.sourceKey);
+    entry.charters.clear();
+    std::string_view charters = String(record.charters);
+    while (!charters.empty()) {
+        size_t end = charters.find('\n');
+        entry.charters.emplace_back(charters.substr(0, end));
+        charters = end == std::string_view::npos ? std::string_view() : charters.substr(end + 1);
+    }
+    entry.midiHash = String(record.midiHash);
+    entry.chartSummary = String(record.chartSummary);
+    entry.infoStamp.size = record.infoSize;
+    entry.infoStamp.modified = record.infoModified;
+    entry.length = record.length;
+    entry.previewStartTime = record.previewStartTime;
+    entry.ini = (record.flags & SONG_CACHE_INI) != 0;
+}
+
+SongCacheString SongCacheWriter::AddString(std::string_view str) {
+    std::string key(str);
+    auto it = stringIndex.find(key);
+    if (it != stringIndex.end()) {
+        return it->second;
+    }
+    SongCacheString ref { (uint32_t)strings.size(), (uint32_t)str.size() };
+    strings += str;
+    stringIndex.emplace(std::move(key), ref);
+    return ref;
+}
+
+void SongCacheWriter::Add(const SongCatalog &catalog, int id) {
+    SongCacheRecord record {};
+    record.songDir = AddString(catalog.Get(id, SongCatalog::SongDir));
+    record.songInfoPath = AddString(catalog.Get(id, SongCatalog::SongInfoPath));
+    record.albumArtPath = AddString(catalog.Get(id, SongCatalog::AlbumArtPath));
+    record.jsonHash = AddString(catalog.Get(id, SongCatalog::JsonHash));
+    record.title = AddString(catalog.Get(id, SongCatalog::Title));
+    record.artist = AddString(catalog.Get(id, SongCatalog::Artist));
+    record.source = AddString(catalog.Get(id, SongCatalog::Source));
+    record.album = AddString(catalog.Get(id, SongCatalog::Album));
+    record.releaseYear = AddString(catalog.Get(id, SongCatalog::ReleaseYear));
+    record.titleKey = AddString(catalog.Get(id, SongCatalog::TitleKey));
+    record.artistKey = AddString(catalog.Get(id, SongCatalog::ArtistKey));
+    record.albumKey = AddString(catalog.Get(id, SongCatalog::AlbumKey));
+    record.sourceKey = AddString(catalog.Get(id, SongCatalog::SourceKey));
+    // Already newline separated, the same as the cache stores them
+    record.charters = AddString(catalog.Get(id, SongCatalog::Charters));
+    record.midiHash = AddString(catalog.Get(id, SongCatalog::MidiHash));
+    record.chartSummary = AddString(catalog.Get(id, SongCatalog::ChartSummaryBlob));
+    record.infoSize = catalog.InfoStamp(id).size;
+    record.infoModified = catalog.InfoStamp(id).modified;
+    record.length = catalog.Length(id);
+    record.previewStartTime = catalog.PreviewStartTime(id);
+    record.flags = catalog.IsIni(id) ? (uint32_t)SONG_CACHE_INI : 0u;
+    records.push_back(record);
+}
+
+bool SongCacheWriter::Write(const std::filesystem::path &path, const std::filesystem::path &root) {
+    SongCacheHeader header {};
+    header.root = AddString(NormalizeSongRoot(root).string());
+    header.header = SONG_CACHE_HEADER;
+    header.version = SONG_CACHE_VERSION;
+    header.songCount = records.size();
+    header.recordsOffset = sizeof(SongCacheHeader);
+    header.stringsOffset = header.recordsOffset + records.size() * sizeof(SongCacheRecord);
+    header.stringsSize = strings.size();
+
+    std::error_code ec;
+    std::filesystem::create_directories(path.parent_path(), ec);
+    std::filesystem::path tempPath = path;
+    tempPath += ".tmp";
+    {
+        std::ofstream out(tempPath, std::ios::binary | std::ios::trunc);
+        out.write(reinterpret_cast<const char *>(&header), sizeof(header));
+        out.write(
+            reinterpret_cast<const char *>(records.data()),
+            (std::streamsize)(records.size() * sizeof(SongCacheRecord))
+        );
+        out.write(strings.data(), (std::streamsize)strings.size());
+        if (!out) {
+            Encore::EncoreLog(LOG_ERROR, "CACHE: Failed to write song cache");
+            return false;
+        }
+    }
+
+    std::filesystem::rename(tempPath, path, ec);
+    if (ec) {
+        Encore::EncoreLogFormat(LOG_ERROR, "CACHE: Failed to replace song cache: %s", ec.message().c_str());
+        std::filesystem::remove(tempPath, ec);
+        return false;
+    }
+    return true;
+}
+
+std::filesystem::path SongCacheCompactingPath(const std::filesystem::path &root) {
+    return ShardBasePath(root).replace_extension(".compacting");
+}
+
+bool SongCacheJournalNeedsCompaction(const std::filesystem::path &root) {
+    std::error_code ec;
+    // Left behind by a compaction that never finished
+    if (std::filesystem::exists(SongCacheCompactingPath(root), ec)) {
+        return true;
+    }
+    uintmax_t journalSize = std::filesystem::file_size(SongCacheJournalPath(root), ec);
+    if (ec || journalSize < JOURNAL_COMPACT_MIN_BYTES) {
+        return false;
+    }
+    uintmax_t shardSize = std::filesystem::file_size(SongCacheShardPath(root), ec);
+    return ec || journalSize > shardSize / 4;
+}
+
+namespace {
+    // Builds one journal payload in memory so it can be checksummed before it's written
+    class JournalPayload : public encore::bin_ostream_native<std::ostringstream> {
+    public:
+        JournalPayload() : bin_ostream(std::ios::binary) {}
+        [[nodiscard]]
+        std::string str() const { return mStream->str(); }
+    };
+
+    uint32_t JournalChecksum(std::string_view payload) {
+        uint32_t hash = 0x811c9dc5u;
+        for (char c : payload) {
+            hash = (hash ^ (uint8_t)c) * 0x01000193u;
+        }
+        return hash;
+    }
+}
+
+SongCacheJournal::SongCacheJournal(const std::filesystem::path &path)
+    : stream(path, std::ios::binary | std::ios::app) {
+    std::error_code ec;
+    if (std::filesystem::file_size(path, ec) == 0) {
+        stream << (uint32_t)SONG_CACHE_HEADER;
+        stream << (uint32_t)SONG_CACHE_VERSION;
+    }
+}
+
+void SongCacheJournal::Append(const std::string &payload) {
+    stream << (uint32_t)payload.size();
+    stream << JournalChecksum(payload);
+    stream.write_raw(payload.data(), (std::streamsize)payload.size());
+}
+
+void SongCacheJournal::AddSong(const SongCatalogEntry &entry) {
+    JournalPayload payload;
+    payload << (uint8_t)JOURNAL_ADD;
+    payload << entry.songDir.string();
+    payload << entry.songInfoPath.string();
+    payload << entry.albumArtPath;
+    payload << entry.jsonHash;
+    payload << entry.title;
+    payload << entry.artist;
+    payload << entry.source;
+    payload << entry.album;
+    payload << entry.releaseYear;
+    payload << entry.charters;
+    payload << entry.midiHash;
+    payload << entry.chartSummary;
+    payload << entry.infoStamp.size;
+    payload << entry.infoStamp.modified;
+    payload << (int32_t)entry.length;
+    payload << entry.previewStartTime;
+    payload << entry.ini;
+    Append(payload.str());
+}
+
+void SongCacheJournal::RemoveSong(const std::filesystem::path &songDir) {
+    JournalPayload payload;
+    payload << (uint8_t)JOURNAL_REMOVE;
+    payload << songDir.string();
+    Append(payload.str());
+}
+
+bool SongCacheJournal::Replay(
+    const std::filesystem::path &path,
+    const std::function<void(const std::string &songDir)> &onRemove,
+    const std::function<void(SongCatalogEntry &entry)> &onAdd
+) {
+    std::error_code ec;
+    uintmax_t fileSize = std::filesystem::file_size(path, ec);
+    encore::bin_ifstream_native in(path, std::ios::binary);
+    if (ec || !in) {
+        return false;
+    }
+    uint32_t header = 0, version = 0;
+    in >> header;
+    in >> version;
+    if (!in || header != SONG_CACHE_HEADER || version != SONG_CACHE_VERSION) {
+        Encore::EncoreLog(LOG_WARNING, "CACHE: Ignoring song cache journal from another version");
+        return false;
+    }
+
+    int entries = 0;
+    uintmax_t validSize = 2 * sizeof(uint32_t);
+    std::string payload;
+    try {
+        while (fileSize - validSize >= 2 * sizeof(uint32_t)) {
+            uint32_t size = 0, checksum = 0;
+            in >> size;
+            in >> checksum;
+            if (!in || size > fileSize - validSize - 2 * sizeof(uint32_t)) {
+                break;
+            }
+            payload.resize(size);
+            in.read_raw(payload.data(), size);
+            if (!in || JournalChecksum(payload) != checksum) {
+                break;
+            }
+
+            encore::bin_istream_native<std::istringstream> entry(payload, std::ios::binary);
+            uint8_t op = 0;
+            std::string songDir;
+            entry >> op;
+            entry >> songDir;
+            if (op == JOURNAL_REMOVE) {
+                if (!entry) {
+                    break;
+                }
+                onRemove(songDir);
+            } else if (op == JOURNAL_ADD) {
+                SongCatalogEntry added;
+                std::string songInfoPath;
+                int32_t length = 0;
+                added.songDir = songDir;
+                entry >> songInfoPath;
+                entry >> added.albumArtPath;
+                entry >> added.jsonHash;
+                entry >> added.title;
+                entry >> added.artist;
+                entry >> added.source;
+                entry >> added.album;
+                entry >> added.releaseYear;
+                entry >> added.charters;
+                entry >> added.midiHash;
+                entry >> added.chartSummary;
+                entry >> added.infoStamp.size;
+                entry >> added.infoStamp.modified;
+                entry >> length;
+                entry >> added.previewStartTime;
+                entry >> added.ini;
+                if (!entry) {
+                    break;
+                }
+                added.songInfoPath = songInfoPath;
+                added.length = length;
+                added.UpdateSortKeys();
+                onAdd(added);
+            } else {
+                break;
+            }
+            validSize += 2 * sizeof(uint32_t) + size;
+            entries++;
+        }
+    } catch (const std::exception &e) {
+        // Only a damaged entry that still matches its checksum could get here
+        Encore::EncoreLogFormat(LOG_WARNING, "CACHE: Song cache journal is damaged: %s", e.what());
+    }
+    in.close();
+
+    if (validSize < fileSize) {
+        // A crash mid-append leaves a partial entry; anything after it would be unreadable
+        Encore::EncoreLogFormat(LOG_WARNING, "CACHE: Dropping %01i damaged bytes from the end of %s", (int)(fileSize - validSize), path.string().c_str());
+        std::filesystem::resize_file(path, validSize, ec);
+    }
+    Encore::EncoreLogFormat(LOG_INFO, "CACHE: Replayed %01i journal entries", entries);
+    return true;
+}
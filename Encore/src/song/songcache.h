@@ -0,0 +1,195 @@
+#pragma once
+
+#include <cstdint>
+#include <filesystem>
+#include <functional>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include "util/binary.h"
+#include "util/mapped-file.h"
+
+// Version is formatted as YY_MM_DD_RR, where:
+// - YY: Current year (2 digits, 4 digits impedes on 32-bit integer limit)
+// - MM: Current month
+// - DD: Current day
+// - RR: Number of times the cache was revised that day, starting from 1
+#define SONG_CACHE_VERSION 26101707
+#define SONG_CACHE_HEADER 0x52434E45 // "ENCR"
+
+class SongCatalog;
+struct SongCatalogEntry;
+
+/*
+ * The cache is sharded by song root: songCache/<hash of the root>.encr holds the songs
+ * directly under one root, so a change on a slow drive never rewrites the others.
+ *
+ * Shard layout (native endianness, the cache is not a portable file):
+ *
+ *   SongCacheHeader
+ *   SongCacheRecord[songCount]
+ *   string table (every distinct string once, not null-terminated)
+ *
+ * The file is memory mapped and records are read in place, so nothing is allocated
+ * until a field is actually turned into a std::string.
+ */
+
+#define SONG_CACHE_DIR "songCache"
+
+/// Roots are hashed and compared in this form, without a trailing separator.
+std::filesystem::path NormalizeSongRoot(const std::filesystem::path &root);
+/// Where the shard for a song root lives.
+std::filesystem::path SongCacheShardPath(const std::filesystem::path &root);
+/// Where the journal for a song root lives, next to its shard.
+std::filesystem::path SongCacheJournalPath(const std::filesystem::path &root);
+
+struct SongCacheString {
+    uint32_t offset; // from the start of the string table
+    uint32_t length;
+};
+
+struct SongCacheHeader {
+    uint32_t header;
+    uint32_t version;
+    uint64_t songCount;
+    uint64_t recordsOffset;
+    uint64_t stringsOffset;
+    uint64_t stringsSize;
+    SongCacheString root; // the song root this shard covers, as normalized
+};
+
+enum SongCacheFlags : uint32_t {
+    SONG_CACHE_INI = 1 << 0
+};
+
+struct SongCacheRecord {
+    SongCacheString songDir;
+    SongCacheString songInfoPath;
+    SongCacheString albumArtPath;
+    SongCacheString jsonHash;
+    SongCacheString title;
+    SongCacheString artist;
+    SongCacheString source;
+    SongCacheString album;
+    SongCacheString releaseYear;
+    SongCacheString titleKey;
+    SongCacheString artistKey;
+    SongCacheString albumKey;
+    SongCacheString sourceKey;
+    SongCacheString charters; // newline-separated
+    SongCacheString midiHash;
+    SongCacheString chartSummary; // EncodeChartSummary(), empty until first ready-up
+    uint64_t infoSize;
+    int64_t infoModified;
+    int32_t length;
+    float previewStartTime;
+    uint32_t flags;
+    uint32_t reserved;
+};
+
+static_assert(sizeof(SongCacheHeader) == 48);
+static_assert(sizeof(SongCacheRecord) == 160);
+
+struct ChartSummary;
+
+/// Packs everything in a ChartSummary except the MIDI hash into a fixed-size blob.
+std::string EncodeChartSummary(const ChartSummary &summary);
+/// Leaves summary invalid if the blob is empty or the wrong size.
+void DecodeChartSummary(std::string_view blob, ChartSummary &summary);
+
+/// Read-only view over a mapped song cache.
+class SongCacheView {
+    Encore::MappedFile file;
+    const SongCacheRecord *records = nullptr;
+    const char *strings = nullptr;
+    size_t recordCount = 0;
+    size_t stringsSize = 0;
+
+public:
+    /// Maps a shard and checks the header, version, root and section bounds. Returns
+    /// false (and logs why) if the shard has to be rebuilt.
+    bool Open(const std::filesystem::path &path, const std::filesystem::path &root);
+    void Close();
+
+    [[nodiscard]]
+    size_t size() const { return recordCount; }
+    [[nodiscard]]
+    const SongCacheRecord &operator[](size_t index) const { return records[index]; }
+
+    /// Empty if the reference points outside the string table.
+    [[nodiscard]]
+    std::string_view String(const SongCacheString &ref) const;
+
+    /// Builds a catalog entry from a record.
+    void FillEntry(const SongCacheRecord &record, SongCatalogEntry &entry) const;
+};
+
+/// Builds a cache file in memory and writes it out in one go.
+class SongCacheWriter {
+    std::vector<SongCacheRecord> records;
+    std::string strings;
+    std::unordered_map<std::string, SongCacheString> stringIndex;
+
+    SongCacheString AddString(std::string_view str);
+
+public:
+    void Add(const SongCatalog &catalog, int id);
+
+    /// Writes the shard for root to a temporary file and renames it over the target,
+    /// so a crash never leaves a half-written cache behind.
+    bool Write(const std::filesystem::path &path, const std::filesystem::path &root);
+};
+
+/*
+ * Shard journal: changes made under a root since its shard was written, appended as
+ * they happen so a single new song costs a few hundred bytes instead of rewriting the
+ * whole shard.
+ *
+ *   uint32 header, uint32 version
+ *   entries: uint32 payload size, uint32 payload checksum, payload
+ *   payload: uint8 op, then the song directory (remove) or the full song (add)
+ *
+ * An add replaces any song already in the same folder, so edits are a single entry.
+ * Once the journal outgrows SongCacheJournalNeedsCompaction(), the shard is rewritten
+ * in the background with everything folded in. While that runs, the journal being
+ * folded sits at SongCacheCompactingPath() and new entries go to a fresh journal;
+ * both are replayed if the game stops before the compaction finishes.
+ */
+
+/// Where a journal waits while its shard is being compacted.
+std::filesystem::path SongCacheCompactingPath(const std::filesystem::path &root);
+/// True once a root's journal is big enough that folding it into the shard pays off, or
+/// a compaction was interrupted.
+bool SongCacheJournalNeedsCompaction(const std::filesystem::path &root);
+
+class SongCacheJournal {
+    encore::bin_ofstream_native stream;
+
+    void Append(const std::string &payload);
+
+public:
+    enum Op : uint8_t {
+        JOURNAL_ADD = 1,
+        JOURNAL_REMOVE = 2
+    };
+
+    explicit SongCacheJournal(const std::filesystem::path &path);
+
+    [[nodiscard]]
+    bool good() const { return stream.good(); }
+
+    /// Adds a song, or replaces the one already in its folder.
+    void AddSong(const SongCatalogEntry &entry);
+    void RemoveSong(const std::filesystem::path &songDir);
+
+    /// Replays every intact entry in order, stopping at the first torn or damaged one
+    /// and cutting the file off there so later appends stay readable. Returns false
+    /// if there is no usable journal.
+    static bool Replay(
+        const std::filesystem::path &path,
+        const std::function<void(const std::string &songDir)> &onRemove,
+        const std::function<void(SongCatalogEntry &entry)> &onAdd
+    );
+};
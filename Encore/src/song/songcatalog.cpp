@@ -0,0 +1,351 @@
+#include "songcatalog.h"
+
+#include "song.h"
+#include "songcache.h"
+#include "util/collation.h"
+
+#include <algorithm>
+#include <functional>
+
+namespace {
+    std::string JoinCharters(const std::vector<std::string> &charters) {
+        std::string joined;
+        for (const auto &charter : charters) {
+            if (!joined.empty()) {
+                joined += '\n';
+            }
+            joined += charter;
+        }
+        return joined;
+    }
+
+    std::vector<std::string> SplitCharters(std::string_view charters) {
+        std::vector<std::string> split;
+        while (!charters.empty()) {
+            size_t end = charters.find('\n');
+            split.emplace_back(charters.substr(0, end));
+            charters = end == std::string_view::npos ? std::string_view() : charters.substr(end + 1);
+        }
+        return split;
+    }
+}
+
+SongCatalogEntry::SongCatalogEntry(const Song &song)
+    : songDir(song.songDir), songInfoPath(song.songInfoPath),
+      albumArtPath(song.albumArtPath), jsonHash(song.jsonHash), title(song.title),
+      artist(song.artist), album(song.album), source(song.source),
+      releaseYear(song.releaseYear), charters(song.charters),
+      midiHash(song.chartSummary.midiHash),
+      chartSummary(EncodeChartSummary(song.chartSummary)), infoStamp(song.infoStamp),
+      length(song.length), previewStartTime(song.previewStartTime), ini(song.ini) {
+    UpdateSortKeys();
+}
+
+void SongCatalogEntry::UpdateSortKeys() {
+    titleKey = Encore::MakeSortKey(title, true);
+    artistKey = Encore::MakeSortKey(artist, true);
+    albumKey = Encore::MakeSortKey(album, true);
+    sourceKey = Encore::MakeSortKey(source, false);
+}
+
+SongCatalog::StringRef SongCatalog::Store(std::string_view str) {
+    if (str.empty()) {
+        return {};
+    }
+    StringRef ref { (uint32_t)arena.size(), (uint32_t)str.size() };
+    arena += str;
+    arena += '\0';
+    return ref;
+}
+
+void SongCatalog::SetString(int id, Field field, std::string_view str) {
+    if (Get(id, field) == str) {
+        return;
+    }
+    StringRef &ref = strings[field][id];
+    if (ref.length != 0) {
+        deadBytes += ref.length + 1;
+    }
+    ref = Store(str);
+}
+
+uint32_t SongCatalog::HashDir(std::string_view songDir) {
+    return (uint32_t)std::hash<std::string_view>()(songDir);
+}
+
+void SongCatalog::IndexDir(int id) {
+    // At most half full, so probe runs stay short
+    if ((songCount + 1) * 2 > dirIndex.size()) {
+        std::vector<DirSlot> old = std::move(dirIndex);
+        dirIndex.assign(std::max<size_t>(64, old.size() * 2), {});
+        size_t mask = dirIndex.size() - 1;
+        for (const DirSlot &slot : old) {
+            if (slot.id < 0) {
+                continue;
+            }
+            size_t i = slot.hash & mask;
+            while (dirIndex[i].id >= 0) {
+                i = (i + 1) & mask;
+            }
+            dirIndex[i] = slot;
+        }
+    }
+    uint32_t hash = HashDir(Get(id, SongDir));
+    size_t mask = dirIndex.size() - 1;
+    size_t i = hash & mask;
+    while (dirIndex[i].id >= 0) {
+        i = (i + 1) & mask;
+    }
+    dirIndex[i] = { hash, id };
+    songCount++;
+}
+
+void SongCatalog::UnindexDir(int id) {
+    size_t mask = dirIndex.size() - 1;
+    size_t hole = HashDir(Get(id, SongDir)) & mask;
+    while (dirIndex[hole].id != id) {
+        hole = (hole + 1) & mask;
+    }
+    // Later slots in the run move back into the hole when it's still on their probe
+    // path, so lookups never need markers for deleted slots
+    for (size_t next = (hole + 1) & mask; dirIndex[next].id >= 0; next = (next + 1) & mask) {
+        size_t home = dirIndex[next].hash & mask;
+        if (((next - home) & mask) >= ((next - hole) & mask)) {
+            dirIndex[hole] = dirIndex[next];
+            hole = next;
+        }
+    }
+    dirIndex[hole] = {};
+    songCount--;
+}
+
+void SongCatalog::CompactIfNeeded() {
+    if (deadBytes < 4096 || deadBytes < arena.size() / 2) {
+        return;
+    }
+    std::string compacted(1, '\0');
+    compacted.reserve(arena.size() - deadBytes);
+    for (auto &column : strings) {
+        for (StringRef &ref : column) {
+            if (ref.length == 0) {
+                continue;
+            }
+            uint32_t offset = (uint32_t)compacted.size();
+            compacted.append(arena, ref.offset, ref.length + 1);
+            ref.offset = offset;
+        }
+    }
+    arena = std::move(compacted);
+    deadBytes = 0;
+}
+
+void SongCatalog::clear() {
+    arena.assign(1, '\0');
+    deadBytes = 0;
+    for (auto &column : strings) {
+        column.clear();
+    }
+    infoStamps.clear();
+    lengths.clear();
+    previewStartTimes.clear();
+    iniFlags.clear();
+    listPositions.clear();
+    dirIndex.clear();
+    songCount = 0;
+}
+
+void SongCatalog::reserve(size_t songCount) {
+    for (auto &column : strings) {
+        column.reserve(songCount);
+    }
+    infoStamps.reserve(songCount);
+    lengths.reserve(songCount);
+    previewStartTimes.reserve(songCount);
+    iniFlags.reserve(songCount);
+    listPositions.reserve(songCount);
+}
+
+int SongCatalog::Add(const SongCatalogEntry &entry) {
+    int id = (int)size();
+    for (auto &column : strings) {
+        column.emplace_back();
+    }
+    infoStamps.emplace_back();
+    lengths.emplace_back();
+    previewStartTimes.emplace_back();
+    iniFlags.emplace_back();
+    listPositions.emplace_back(0);
+    Set(id, entry);
+    return id;
+}
+
+int SongCatalog::AddRecord(const SongCacheView &cache, const SongCacheRecord &record) {
+    int id = (int)size();
+    // Same fields as the record, charters included, which both keep newline separated
+    const SongCacheString *fields[FieldCount] = {
+        &record.songDir,   &record.songInfoPath, &record.albumArtPath, &record.jsonHash,
+        &record.title,     &record.artist,       &record.album,        &record.source,
+        &record.releaseYear, &record.charters,   &record.titleKey,     &record.artistKey,
+        &record.albumKey,  &record.sourceKey,    &record.midiHash,     &record.chartSummary,
+    };
+    for (int field = 0; field < FieldCount; field++) {
+        strings[field].push_back(Store(cache.String(*fields[field])));
+    }
+    infoStamps.push_back({ record.infoSize, record.infoModified });
+    lengths.push_back(record.length);
+    previewStartTimes.push_back(record.previewStartTime);
+    iniFlags.push_back((record.flags & SONG_CACHE_INI) != 0);
+    listPositions.push_back(0);
+    if (!IsRemoved(id)) {
+        IndexDir(id);
+    }
+    return id;
+}
+
+void SongCatalog::Append(const SongCatalog &other) {
+    // The other arena goes on the end as is, so its strings only move by a fixed offset.
+    // Its shared empty string and dead bytes come along as dead bytes here.
+    int firstID = (int)size();
+    uint32_t base = (uint32_t)arena.size();
+    arena += other.arena;
+    deadBytes += other.deadBytes + 1;
+    for (int field = 0; field < FieldCount; field++) {
+        for (StringRef ref : other.strings[field]) {
+            if (ref.length != 0) {
+                ref.offset += base;
+            }
+            strings[field].push_back(ref);
+        }
+    }
+    infoStamps.insert(infoStamps.end(), other.infoStamps.begin(), other.infoStamps.end());
+    lengths.insert(lengths.end(), other.lengths.begin(), other.lengths.end());
+    previewStartTimes.insert(
+        previewStartTimes.end(), other.previewStartTimes.begin(), other.previewStartTimes.end()
+    );
+    iniFlags.insert(iniFlags.end(), other.iniFlags.begin(), other.iniFlags.end());
+    listPositions.resize(listPositions.size() + other.size(), 0);
+    for (int id = firstID; id < (int)size(); id++) {
+        if (!IsRemoved(id)) {
+            IndexDir(id);
+        }
+    }
+    CompactIfNeeded();
+}
+
+void SongCatalog::Set(int id, const SongCatalogEntry &entry) {
+    std::string songDir = entry.songDir.string();
+    if (Get(id, SongDir) != songDir) {
+        // The index finds a song's slot by its old folder, so out before the change
+        if (!IsRemoved(id)) {
+            UnindexDir(id);
+        }
+        SetString(id, SongDir, songDir);
+        if (!IsRemoved(id)) {
+            IndexDir(id);
+        }
+    }
+    SetString(id, SongInfoPath, entry.songInfoPath.string());
+    SetString(id, AlbumArtPath, entry.albumArtPath);
+    SetString(id, JsonHash, entry.jsonHash);
+    SetString(id, Title, entry.title);
+    SetString(id, Artist, entry.artist);
+    SetString(id, Album, entry.album);
+    SetString(id, Source, entry.source);
+    SetString(id, ReleaseYear, entry.releaseYear);
+    SetString(id, Charters, JoinCharters(entry.charters));
+    SetString(id, TitleKey, entry.titleKey);
+    SetString(id, ArtistKey, entry.artistKey);
+    SetString(id, AlbumKey, entry.albumKey);
+    SetString(id, SourceKey, entry.sourceKey);
+    SetString(id, MidiHash, entry.midiHash);
+    SetString(id, ChartSummaryBlob, entry.chartSummary);
+    infoStamps[id] = entry.infoStamp;
+    lengths[id] = entry.length;
+    previewStartTimes[id] = entry.previewStartTime;
+    iniFlags[id] = entry.ini;
+    CompactIfNeeded();
+}
+
+void SongCatalog::Erase(int id) {
+    if (IsRemoved(id)) {
+        return;
+    }
+    UnindexDir(id);
+    for (auto &column : strings) {
+        if (column[id].length != 0) {
+            deadBytes += column[id].length + 1;
+        }
+        column[id] = {};
+    }
+    infoStamps[id] = {};
+    lengths[id] = 0;
+    previewStartTimes[id] = 0.0f;
+    iniFlags[id] = 0;
+    listPositions[id] = 0;
+    CompactIfNeeded();
+}
+
+int SongCatalog::Find(std::string_view songDir) const {
+    if (dirIndex.empty()) {
+        return -1;
+    }
+    uint32_t hash = HashDir(songDir);
+    size_t mask = dirIndex.size() - 1;
+    for (size_t i = hash & mask; dirIndex[i].id >= 0; i = (i + 1) & mask) {
+        if (dirIndex[i].hash == hash && Get(dirIndex[i].id, SongDir) == songDir) {
+            return dirIndex[i].id;
+        }
+    }
+    return -1;
+}
+
+void SongCatalog::SetChartSummary(int id, std::string_view midiHash, std::string_view blob) {
+    SetString(id, MidiHash, midiHash);
+    SetString(id, ChartSummaryBlob, blob);
+    CompactIfNeeded();
+}
+
+SongCatalogEntry SongCatalog::Entry(int id) const {
+    SongCatalogEntry entry;
+    entry.songDir = Get(id, SongDir);
+    entry.songInfoPath = Get(id, SongInfoPath);
+    entry.albumArtPath = Get(id, AlbumArtPath);
+    entry.jsonHash = Get(id, JsonHash);
+    entry.title = Get(id, Title);
+    entry.artist = Get(id, Artist);
+    entry.album = Get(id, Album);
+    entry.source = Get(id, Source);
+    entry.releaseYear = Get(id, ReleaseYear);
+    entry.charters = SplitCharters(Get(id, Charters));
+    entry.titleKey = Get(id, TitleKey);
+    entry.artistKey = Get(id, ArtistKey);
+    entry.albumKey = Get(id, AlbumKey);
+    entry.sourceKey = Get(id, SourceKey);
+    entry.midiHash = Get(id, MidiHash);
+    entry.chartSummary = Get(id, ChartSummaryBlob);
+    entry.infoStamp = infoStamps[id];
+    entry.length = lengths[id];
+    entry.previewStartTime = previewStartTimes[id];
+    entry.ini = IsIni(id);
+    return entry;
+}
+
+void SongCatalog::FillSong(int id, Song &song) const {
+    song.songDir = Get(id, SongDir);
+    song.songInfoPath = Get(id, SongInfoPath);
+    song.albumArtPath = Get(id, AlbumArtPath);
+    song.jsonHash = Get(id, JsonHash);
+    song.title = Get(id, Title);
+    song.artist = Get(id, Artist);
+    song.album = Get(id, Album);
+    song.source = Get(id, Source);
+    song.releaseYear = Get(id, ReleaseYear);
+    song.charters = SplitCharters(Get(id, Charters));
+    song.chartSummary.midiHash = Get(id, MidiHash);
+    DecodeChartSummary(Get(id, ChartSummaryBlob), song.chartSummary);
+    song.infoStamp = infoStamps[id];
+    song.length = lengths[id];
+    song.previewStartTime = previewStartTimes[id];
+    song.ini = IsIni(id);
+    song.songListPos = listPositions[id];
+}
@@ -0,0 +1,175 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <filesystem>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "util/file-stamp.h"
+
+class Song;
+class SongCacheView;
+struct SongCacheRecord;
+
+// What the library keeps about one song: enough to list, sort, search and cache it.
+// Used to move a song in and out of a SongCatalog.
+struct SongCatalogEntry {
+    std::filesystem::path songDir;
+    std::filesystem::path songInfoPath;
+    std::string albumArtPath;
+    std::string jsonHash;
+    std::string title;
+    std::string artist;
+    std::string album;
+    std::string source;
+    std::string releaseYear;
+    std::vector<std::string> charters;
+    // Normalized copies of title/artist/album/source used for sorting
+    std::string titleKey;
+    std::string artistKey;
+    std::string albumKey;
+    std::string sourceKey;
+    std::string midiHash;
+    std::string chartSummary; // EncodeChartSummary() blob, empty if not read yet
+    // size/mtime of songInfoPath when jsonHash was taken
+    Encore::FileStamp infoStamp;
+    int length = 0;
+    float previewStartTime = 0.0f;
+    bool ini = false;
+
+    SongCatalogEntry() = default;
+    explicit SongCatalogEntry(const Song &song);
+
+    // Recomputes titleKey/artistKey/albumKey/sourceKey after the metadata changed
+    void UpdateSortKeys();
+};
+
+// Every song in the library, stored as columns indexed by song ID. Strings live in one
+// arena, so walking a single field for sorting or drawing the list touches little
+// memory and copying the whole catalog for a worker thread is a handful of memcpys.
+// Everything else a song needs is loaded into a Song only when it's selected.
+//
+// IDs never change while the catalog is alive: a removed song leaves an empty slot
+// behind (IsRemoved()), so orderings, the search index and anything else keyed by ID
+// stay valid. The slots are only dropped when the catalog is built again from the cache.
+class SongCatalog {
+public:
+    enum Field {
+        SongDir,
+        SongInfoPath,
+        AlbumArtPath,
+        JsonHash,
+        Title,
+        Artist,
+        Album,
+        Source,
+        ReleaseYear,
+        Charters, // newline separated
+        TitleKey,
+        ArtistKey,
+        AlbumKey,
+        SourceKey,
+        MidiHash,
+        ChartSummaryBlob,
+        FieldCount
+    };
+
+private:
+    struct StringRef {
+        uint32_t offset = 0;
+        uint32_t length = 0;
+    };
+
+    // Every string is null terminated; offset 0 is the shared empty string
+    std::string arena = std::string(1, '\0');
+    size_t deadBytes = 0;
+    std::array<std::vector<StringRef>, FieldCount> strings;
+    std::vector<Encore::FileStamp> infoStamps;
+    std::vector<int> lengths;
+    std::vector<float> previewStartTimes;
+    std::vector<uint8_t> iniFlags;
+    std::vector<int> listPositions;
+
+    // Song IDs by the hash of their folder, open addressed with linear probing. IDs
+    // rather than strings, so a copy of the catalog is still a memcpy.
+    struct DirSlot {
+        uint32_t hash = 0;
+        int id = -1; // -1 for an empty slot
+    };
+    std::vector<DirSlot> dirIndex;
+    size_t songCount = 0;
+
+    static uint32_t HashDir(std::string_view songDir);
+    void IndexDir(int id);
+    void UnindexDir(int id);
+
+    StringRef Store(std::string_view str);
+    void SetString(int id, Field field, std::string_view str);
+    // Drops strings no song points at any more once they make up half the arena
+    void CompactIfNeeded();
+
+public:
+    // One past the highest song ID, removed songs included
+    [[nodiscard]]
+    size_t size() const { return lengths.size(); }
+    // Songs that haven't been removed
+    [[nodiscard]]
+    size_t SongCount() const { return songCount; }
+    [[nodiscard]]
+    bool empty() const { return songCount == 0; }
+    // Every song has a folder, so an empty one marks a removed song's slot
+    [[nodiscard]]
+    bool IsRemoved(int id) const { return strings[SongDir][id].length == 0; }
+
+    void clear();
+    void reserve(size_t songCount);
+
+    // Appends a song and returns its ID
+    int Add(const SongCatalogEntry &entry);
+    // Appends a song straight from a mapped cache record, copying its strings from the
+    // cache's string table without building a SongCatalogEntry
+    int AddRecord(const SongCacheView &cache, const SongCacheRecord &record);
+    // Appends every song in another catalog, in order
+    void Append(const SongCatalog &other);
+    // Replaces a song's data, keeping its ID
+    void Set(int id, const SongCatalogEntry &entry);
+    // Removes a song, leaving its ID empty
+    void Erase(int id);
+    // Song ID of the song in songDir, or -1. Constant time.
+    [[nodiscard]]
+    int Find(std::string_view songDir) const;
+
+    [[nodiscard]]
+    std::string_view Get(int id, Field field) const {
+        const StringRef &ref = strings[field][id];
+        return { arena.data() + ref.offset, ref.length };
+    }
+    // Same as Get(), for raylib calls that want a C string
+    [[nodiscard]]
+    const char *CStr(int id, Field field) const {
+        return arena.data() + strings[field][id].offset;
+    }
+    [[nodiscard]]
+    const Encore::FileStamp &InfoStamp(int id) const { return infoStamps[id]; }
+    [[nodiscard]]
+    int Length(int id) const { return lengths[id]; }
+    [[nodiscard]]
+    float PreviewStartTime(int id) const { return previewStartTimes[id]; }
+    [[nodiscard]]
+    bool IsIni(int id) const { return iniFlags[id] != 0; }
+
+    // 1-based position in the list menu, or 0 if the song is filtered out
+    [[nodiscard]]
+    int ListPos(int id) const { return listPositions[id]; }
+    void SetListPos(int id, int pos) { listPositions[id] = pos; }
+
+    void SetChartSummary(int id, std::string_view midiHash, std::string_view blob);
+    void SetInfoStamp(int id, const Encore::FileStamp &stamp) { infoStamps[id] = stamp; }
+
+    [[nodiscard]]
+    SongCatalogEntry Entry(int id) const;
+    // Fills in the library fields of a runtime Song, including its chart summary
+    void FillSong(int id, Song &song) const;
+};
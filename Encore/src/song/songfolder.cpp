@@ -0,0 +1,53 @@
+#include "songfolder.h"
+
+SongFolderSnapshot::SongFolderSnapshot(const std::filesystem::path &folder)
+    : folder(folder) {
+    std::error_code error;
+    std::filesystem::directory_iterator it(folder, error);
+    if (error) {
+        return;
+    }
+    for (; !error && it != std::filesystem::directory_iterator(); it.increment(error)) {
+        // Uses the type from the listing where the OS provides one, so this only
+        // stats symlinks
+        std::error_code typeError;
+        if (!it->is_regular_file(typeError)) {
+            continue;
+        }
+        std::string name = it->path().filename().string();
+        std::string stem = name.substr(0, name.find_last_of('.'));
+        files.push_back({ std::move(name), std::move(stem) });
+    }
+    if (error) {
+        // A partial listing can't answer HasFile(), so that falls back to stat calls
+        files.clear();
+        return;
+    }
+    listed = true;
+}
+
+bool SongFolderSnapshot::Contains(std::string_view name) const {
+    for (const auto &file : files) {
+        if (file.name == name) {
+            return true;
+        }
+    }
+    return false;
+}
+
+std::filesystem::path SongFolderSnapshot::FindStem(std::string_view stem) const {
+    for (const auto &file : files) {
+        if (file.stem == stem) {
+            return folder / file.name;
+        }
+    }
+    return {};
+}
+
+bool SongFolderSnapshot::HasFile(const std::filesystem::path &relative) const {
+    if (listed && !relative.has_parent_path() && !relative.is_absolute()) {
+        return Contains(relative.string());
+    }
+    std::error_code error;
+    return std::filesystem::exists(folder / relative, error);
+}
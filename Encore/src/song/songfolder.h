@@ -0,0 +1,46 @@
+#pragma once
+
+#include <filesystem>
+#include <string>
+#include <string_view>
+#include <vector>
+
+/// One listing of a song folder, taken up front and shared by everything that looks
+/// for files while loading the song (art, MIDI, stems, video, song.ini), so the folder
+/// is only read once.
+class SongFolderSnapshot {
+public:
+    struct File {
+        std::string name;
+        std::string stem; // name up to the last '.'
+    };
+
+private:
+    std::filesystem::path folder;
+    std::vector<File> files;
+    bool listed = false;
+
+public:
+    SongFolderSnapshot() = default;
+    explicit SongFolderSnapshot(const std::filesystem::path &folder);
+
+    [[nodiscard]]
+    const std::filesystem::path &path() const { return folder; }
+    /// False if the folder couldn't be listed
+    [[nodiscard]]
+    bool exists() const { return listed; }
+    /// Regular files only, in directory order
+    [[nodiscard]]
+    const std::vector<File> &Files() const { return files; }
+
+    /// Whether a regular file with this exact name is in the folder
+    [[nodiscard]]
+    bool Contains(std::string_view name) const;
+    /// Path of the first file named stem.<anything>, or an empty path
+    [[nodiscard]]
+    std::filesystem::path FindStem(std::string_view stem) const;
+    /// Checks a path from a song's info file. Plain file names are answered from the
+    /// listing; anything pointing into a subfolder falls back to the filesystem.
+    [[nodiscard]]
+    bool HasFile(const std::filesystem::path &relative) const;
+};
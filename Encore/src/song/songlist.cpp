@@ -3,296 +3,559 @@
 
 #include <set>
 #include <algorithm>
-#include <nlohmann/json.hpp>
+#include <chrono>
 #include <fstream>
-#include "util/binary.h"
-
-using json = nlohmann::json;
+#include <iterator>
+#include <optional>
+#include <thread>
+#include <unordered_map>
+#include <unordered_set>
+#include "util/collation.h"
+#include "util/work-queue.h"
 
 // sorting
 void SongList::Clear() {
     listMenuEntries.clear();
-    songs.clear();
+    catalog.clear();
+    curSong = nullptr;
+    curSongID = -1;
+    DropOrderings();
+    DropSearchIndex();
     songCount = 0;
     directoryCount = 0;
     badSongCount = 0;
 }
 
-bool startsWith(const std::string &str, const std::string &prefix) {
-    return str.substr(0, prefix.size()) == prefix;
+SongSortFields::SongSortFields(const SongCatalog &catalog, int id)
+    : titleKey(catalog.Get(id, SongCatalog::TitleKey)),
+      artistKey(catalog.Get(id, SongCatalog::ArtistKey)),
+      albumKey(catalog.Get(id, SongCatalog::AlbumKey)),
+      sourceKey(catalog.Get(id, SongCatalog::SourceKey)),
+      releaseYear(catalog.Get(id, SongCatalog::ReleaseYear)), length(catalog.Length(id)) {}
+
+// Each sort compares its own key first and falls back to the title (then artist), so
+// one stable sort gives the same grouping the old back-to-back sorts aimed for. Keys
+// are precomputed in SongCatalogEntry::UpdateSortKeys(), so comparing allocates nothing.
+bool SongList::sortArtist(const SongSortFields &a, const SongSortFields &b) {
+    if (int c = a.artistKey.compare(b.artistKey)) return c < 0;
+    if (int c = a.albumKey.compare(b.albumKey)) return c < 0;
+    return a.titleKey < b.titleKey;
 }
 
-std::string removeArticle(const std::string &str) {
-    std::string result = str;
+bool SongList::sortTitle(const SongSortFields &a, const SongSortFields &b) {
+    if (int c = a.titleKey.compare(b.titleKey)) return c < 0;
+    return a.artistKey < b.artistKey;
+}
 
-    if (startsWith(result, "a ")) {
-        return str.substr(2);
-    } else if (startsWith(result, "an ")) {
-        return str.substr(3);
-    } else if (startsWith(result, "the ")) {
-        return str.substr(4);
-    }
-    return str;
+bool SongList::sortSource(const SongSortFields &a, const SongSortFields &b) {
+    if (int c = a.sourceKey.compare(b.sourceKey)) return c < 0;
+    return sortTitle(a, b);
 }
 
-bool SongList::sortArtist(const Song &a, const Song &b) {
-    std::string aLower = TextToLower(a.artist.c_str());
-    std::string bLower = TextToLower(b.artist.c_str());
-    std::string aaa = removeArticle(aLower);
-    std::string bbb = removeArticle(bLower);
-    return aaa < bbb;
+bool SongList::sortAlbum(const SongSortFields &a, const SongSortFields &b) {
+    if (int c = a.albumKey.compare(b.albumKey)) return c < 0;
+    return sortTitle(a, b);
 }
 
-bool SongList::sortTitle(const Song &a, const Song &b) {
-    std::string aLower = TextToLower(a.title.c_str());
-    std::string bLower = TextToLower(b.title.c_str());
-    std::string aaa = removeArticle(aLower);
-    std::string bbb = removeArticle(bLower);
-    return aaa < bbb;
+bool SongList::sortLen(const SongSortFields &a, const SongSortFields &b) {
+    if (a.length != b.length) return a.length < b.length;
+    return sortTitle(a, b);
 }
 
-bool SongList::sortSource(const Song &a, const Song &b) {
-    std::string aLower = TextToLower(a.source.c_str());
-    std::string bLower = TextToLower(b.source.c_str());
-    return aLower < bLower;
+bool SongList::sortYear(const SongSortFields &a, const SongSortFields &b) {
+    if (int c = a.releaseYear.compare(b.releaseYear)) return c < 0;
+    return sortTitle(a, b);
 }
 
-bool SongList::sortAlbum(const Song &a, const Song &b) {
-    std::string aLower = TextToLower(a.album.c_str());
-    std::string bLower = TextToLower(b.album.c_str());
-    std::string aaa = removeArticle(aLower);
-    std::string bbb = removeArticle(bLower);
-    return aaa < bbb;
+SongList::SongList() {}
+SongList::~SongList() {
+    WaitForCompaction();
 }
 
-bool SongList::sortLen(const Song &a, const Song &b) {
-    return a.length < b.length;
+void SongList::DropOrderings() {
+    std::lock_guard lock(orderingCache->mutex);
+    orderingCache->generation++;
+    orderingCache->orderings.fill(nullptr);
 }
 
-bool SongList::sortYear(const Song &a, const Song &b) {
-    return a.releaseYear < b.releaseYear;
+std::shared_ptr<const SongCatalog> SongList::SnapshotCatalog() const {
+    // The columns copy in a few allocations, however many songs there are
+    return std::make_shared<const SongCatalog>(catalog);
 }
 
-SongList::SongList() {}
-SongList::~SongList() {}
+void SongList::InvalidateOrderings(
+    const std::shared_ptr<const SongCatalog> &snapshot, const std::vector<char> *changed
+) {
+    std::array<std::shared_ptr<const SongOrdering>, (size_t)SortType::EnumEnd> previous;
+    if (changed) {
+        std::lock_guard lock(orderingCache->mutex);
+        previous = orderingCache->orderings;
+    }
+    DropOrderings();
 
-void SongList::sortList(SortType sortType) {
-    switch (sortType) {
-    case SortType::Title:
-        std::sort(songs.begin(), songs.end(), sortTitle);
-        break;
-    case SortType::Artist:
-        std::sort(songs.begin(), songs.end(), sortAlbum);
-        std::sort(songs.begin(), songs.end(), sortArtist);
-        break;
-    case SortType::Source:
-        std::sort(songs.begin(), songs.end(), sortTitle);
-        std::sort(songs.begin(), songs.end(), sortSource);
-        break;
-    case SortType::Length:
-        // Merged sorting logic from songlistnew.cpp
-        std::sort(songs.begin(), songs.end(), sortTitle);
-        std::sort(songs.begin(), songs.end(), sortLen);
-        break;
-    case SortType::Year:
-        std::sort(songs.begin(), songs.end(), sortTitle);
-        std::sort(songs.begin(), songs.end(), sortYear);
-        break;
-    default:;
+    uint64_t generation;
+    {
+        std::lock_guard lock(orderingCache->mutex);
+        generation = orderingCache->generation;
     }
-    listMenuEntries = GenerateSongEntriesWithHeaders(songs, sortType);
+    // The current mode gets built by the next sortList() call; the rest are ready by
+    // the time anyone cycles to them. The thread holds its own references, so it can
+    // outlive a newer generation and just drop its result.
+    std::thread([cache = orderingCache,
+                 snapshot,
+                 generation,
+                 skip = currentSortType,
+                 previous,
+                 changed = changed ? *changed : std::vector<char>()] {
+        for (int type = (int)SortType::EnumStart; type < (int)SortType::EnumEnd; type++) {
+            if ((SortType)type == skip) {
+                continue;
+            }
+            {
+                std::lock_guard lock(cache->mutex);
+                if (cache->generation != generation) {
+                    return;
+                }
+                if (cache->orderings[type]) {
+                    continue;
+                }
+            }
+            auto ordering = previous[type]
+                ? SpliceOrdering(*snapshot, (SortType)type, *previous[type], changed)
+                : BuildOrdering(*snapshot, (SortType)type);
+            std::lock_guard lock(cache->mutex);
+            if (cache->generation != generation) {
+                return;
+            }
+            if (!cache->orderings[type]) {
+                cache->orderings[type] = ordering;
+            }
+        }
+    }).detach();
 }
 
-void SongList::sortList(SortType sortType, int &selectedSong) {
-    Song curSong;
-    // Using safer logic from songlist.cpp to handle invalid selections
-    bool hasCurrentSong = selectedSong >= 0 && selectedSong < songs.size();
-    if (hasCurrentSong) {
-        curSong = songs[selectedSong];
-    }
-    selectedSong = 0;
-    switch (sortType) {
-    case SortType::Title:
-        std::sort(songs.begin(), songs.end(), sortTitle);
-        break;
-    case SortType::Artist:
-        std::sort(songs.begin(), songs.end(), sortAlbum);
-        std::sort(songs.begin(), songs.end(), sortArtist);
-        break;
-    case SortType::Source:
-        std::sort(songs.begin(), songs.end(), sortTitle);
-        std::sort(songs.begin(), songs.end(), sortSource);
-        break;
-    case SortType::Length:
-        // Merged sorting logic from songlistnew.cpp
-        std::sort(songs.begin(), songs.end(), sortTitle);
-        std::sort(songs.begin(), songs.end(), sortLen);
-        break;
-    case SortType::Year:
-        std::sort(songs.begin(), songs.end(), sortTitle);
-        std::sort(songs.begin(), songs.end(), sortYear);
-    break;
-    default:;
-    }
-    if (hasCurrentSong) {
-        for (size_t i = 0; i < songs.size(); i++) {
-            if (songs[i].artist == curSong.artist && songs[i].title == curSong.title) {
-                selectedSong = i;
-                break;
+void SongList::WaitForBackgroundWork() {
+    auto finished = [this] {
+        {
+            std::lock_guard lock(orderingCache->mutex);
+            for (const auto &ordering : orderingCache->orderings) {
+                if (!ordering) {
+                    return false;
+                }
             }
         }
+        return CurrentSearchIndex() != nullptr;
+    };
+    while (!finished()) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
     }
-    listMenuEntries = GenerateSongEntriesWithHeaders(songs, sortType);
 }
 
-void SongList::WriteCache() {
-    std::filesystem::remove("songCache.encr");
+void SongList::ApplyOrdering(const SongOrdering &ordering) {
+    std::shared_ptr<SongSearchIndex> index;
+    if (!searchQuery.empty()) {
+        index = CurrentSearchIndex();
+    }
+    searchPending = !searchQuery.empty() && !index;
+    if (!index) {
+        listMenuEntries = ordering.entries;
+        for (int id = 0; id < (int)catalog.size(); id++) {
+            catalog.SetListPos(id, ordering.listPos[id]);
+        }
+        if (curSong) {
+            curSong->songListPos = catalog.ListPos(curSongID);
+        }
+        return;
+    }
 
-    // Native-endian order used for best performance, since the cache is not a portable
-    // file
-    encore::bin_ofstream_native SongCache("songCache.encr", std::ios::binary);
+    std::vector<char> matched(catalog.size(), 0);
+    for (int id : index->Query(searchQuery)) {
+        if (id < (int)matched.size()) {
+            matched[id] = 1;
+        }
+    }
+    for (int id = 0; id < (int)catalog.size(); id++) {
+        catalog.SetListPos(id, 0);
+    }
 
-    // Casts used to explicitly indicate type
-    SongCache << (uint32_t)SONG_CACHE_HEADER;
-    SongCache << (uint32_t)SONG_CACHE_VERSION;
-    SongCache << (size_t)songs.size();
+    // Walk the full ordering and keep matching songs plus the headers above them
+    listMenuEntries.clear();
+    const ListMenuEntry *header = nullptr;
+    for (const auto &entry : ordering.entries) {
+        if (entry.isHeader) {
+            header = &entry;
+            continue;
+        }
+        if (!matched[entry.songListID]) {
+            continue;
+        }
+        if (header) {
+            listMenuEntries.push_back(*header);
+            header = nullptr;
+        }
+        listMenuEntries.push_back(entry);
+        catalog.SetListPos(entry.songListID, listMenuEntries.size());
+    }
+    if (curSong) {
+        curSong->songListPos = catalog.ListPos(curSongID);
+    }
+}
 
-    for (const auto &song : songs) {
-        SongCache << song.songDir.string();
-        SongCache << song.albumArtPath;
-        SongCache << song.songInfoPath.string();
-        SongCache << song.jsonHash;
+std::shared_ptr<SongSearchIndex> SongList::CurrentSearchIndex() {
+    std::lock_guard lock(searchState->mutex);
+    return searchState->index;
+}
 
-        SongCache << song.title;
-        SongCache << song.artist;
+void SongList::DropSearchIndex() {
+    std::lock_guard lock(searchState->mutex);
+    searchState->generation++;
+    searchState->index = nullptr;
+}
 
-        SongCache << song.length;
-        SongCache << song.releaseYear;
+void SongList::RebuildSearchIndex(const std::shared_ptr<const SongCatalog> &snapshot) {
+    DropSearchIndex();
 
-        Encore::EncoreLog(LOG_INFO, TextFormat("CACHE: Song found:     %s - %s", song.title.c_str(), song.artist.c_str()));
-        Encore::EncoreLog(LOG_INFO, TextFormat("CACHE: Directory:      %s", song.songDir.string().c_str()));
-        Encore::EncoreLog(LOG_INFO, TextFormat("CACHE: Album Art Path: %s", song.albumArtPath.c_str()));
-        Encore::EncoreLog(LOG_INFO, TextFormat("CACHE: Song Info Path: %s", song.songInfoPath.string().c_str()));
-        Encore::EncoreLog(LOG_INFO, TextFormat("CACHE: Song length:    %01i", song.length));
+    uint64_t generation;
+    {
+        std::lock_guard lock(searchState->mutex);
+        generation = searchState->generation;
     }
+    // Normalizing every song's text is the slow part, so it happens on the worker too
+    std::thread([state = searchState, snapshot, generation] {
+        double start = GetTime();
+        std::vector<std::string> documents;
+        documents.reserve(snapshot->size());
+        for (int id = 0; id < (int)snapshot->size(); id++) {
+            documents.push_back(
+                snapshot->IsRemoved(id) ? std::string() : SongSearchIndex::MakeDocument(*snapshot, id)
+            );
+        }
+        auto index = std::make_shared<SongSearchIndex>();
+        index->Build(std::move(documents));
+        std::lock_guard lock(state->mutex);
+        if (state->generation == generation) {
+            state->index = index;
+            Encore::EncoreLogFormat(LOG_INFO, "SEARCH: Indexed %01i songs in %.1fms", (int)index->size(), (GetTime() - start) * 1000.0);
+        }
+    }).detach();
+}
 
-    SongCache.close();
+void SongList::SetSearchQuery(const std::string &query) {
+    searchQuery = query;
+    sortList(currentSortType);
 }
 
-// Using the more feature-complete ScanSongs function from songlist.cpp
-void SongList::ScanSongs(const std::vector<std::filesystem::path> &songsFolder) {
-    Clear();
+bool SongList::UpdateSearch() {
+    if (!searchPending || !CurrentSearchIndex()) {
+        return false;
+    }
+    sortList(currentSortType);
+    return true;
+}
 
+void SongList::sortList(SortType sortType) {
+    currentSortType = sortType;
+    std::shared_ptr<const SongOrdering> ordering;
+    uint64_t generation;
+    {
+        std::lock_guard lock(orderingCache->mutex);
+        ordering = orderingCache->orderings[(size_t)sortType];
+        generation = orderingCache->generation;
+    }
+    if (!ordering || ordering->listPos.size() != catalog.size()) {
+        // Not built yet, either first use or the background build hasn't got here
+        ordering = BuildOrdering(catalog, sortType);
+        std::lock_guard lock(orderingCache->mutex);
+        if (orderingCache->generation == generation) {
+            orderingCache->orderings[(size_t)sortType] = ordering;
+        }
+    }
+    ApplyOrdering(*ordering);
+}
+
+void SongList::sortList(SortType sortType, int &selectedSong) {
+    if (selectedSong < 0 || selectedSong >= (int)catalog.size() || catalog.IsRemoved(selectedSong)) {
+        selectedSong = 0;
+    }
+    sortList(sortType);
+}
+
+void SongList::SetRoots(const std::vector<std::filesystem::path> &songsFolder) {
+    songRoots.clear();
     for (const auto &folder : songsFolder) {
-        if (!std::filesystem::is_directory(folder)) {
+        std::filesystem::path root = NormalizeSongRoot(folder);
+        if (std::find(songRoots.begin(), songRoots.end(), root) == songRoots.end()) {
+            songRoots.push_back(root);
+        }
+    }
+    rootOffline.assign(songRoots.size(), 0);
+}
+
+int SongList::RootIndexFor(const std::filesystem::path &songDir) const {
+    std::filesystem::path root = NormalizeSongRoot(songDir.parent_path());
+    auto it = std::find(songRoots.begin(), songRoots.end(), root);
+    return it == songRoots.end() ? -1 : (int)(it - songRoots.begin());
+}
+
+namespace {
+    // Writes the shard for one root from the songs in it, returning how many there were
+    // or -1 if the write failed
+    int WriteShard(const SongCatalog &catalog, const std::filesystem::path &root) {
+        SongCacheWriter writer;
+        int count = 0;
+        for (int id = 0; id < (int)catalog.size(); id++) {
+            if (catalog.IsRemoved(id)) {
+                continue;
+            }
+            std::filesystem::path songDir = catalog.Get(id, SongCatalog::SongDir);
+            if (NormalizeSongRoot(songDir.parent_path()) == root) {
+                writer.Add(catalog, id);
+                count++;
+            }
+        }
+        return writer.Write(SongCacheShardPath(root), root) ? count : -1;
+    }
+}
+
+void SongList::WriteShards(const std::vector<char> &dirty) {
+    WaitForCompaction();
+    std::vector<SongCacheWriter> writers(songRoots.size());
+    std::vector<int> counts(songRoots.size(), 0);
+    for (int id = 0; id < (int)catalog.size(); id++) {
+        if (catalog.IsRemoved(id)) {
+            continue;
+        }
+        int root = RootIndexFor(catalog.Get(id, SongCatalog::SongDir));
+        if (root >= 0 && dirty[root]) {
+            writers[root].Add(catalog, id);
+            counts[root]++;
+        }
+    }
+    for (size_t root = 0; root < songRoots.size(); root++) {
+        if (!dirty[root] || rootOffline[root]) {
             continue;
         }
+        if (writers[root].Write(SongCacheShardPath(songRoots[root]), songRoots[root])) {
+            Encore::EncoreLogFormat(LOG_INFO, "CACHE: Wrote %01i songs for %s", counts[root], songRoots[root].string().c_str());
+            // Everything in the journals is in the new shard now
+            std::error_code ec;
+            std::filesystem::remove(SongCacheJournalPath(songRoots[root]), ec);
+            std::filesystem::remove(SongCacheCompactingPath(songRoots[root]), ec);
+        }
+    }
+}
 
-        for (const auto &entry : std::filesystem::directory_iterator(folder)) {
-            if (!std::filesystem::is_directory(entry)) {
+void SongList::CompactShards() {
+    std::shared_ptr<const SongCatalog> snapshot;
+    for (size_t i = 0; i < songRoots.size(); i++) {
+        const std::filesystem::path &root = songRoots[i];
+        if (rootOffline[i] || !SongCacheJournalNeedsCompaction(root)) {
+            continue;
+        }
+        {
+            std::lock_guard lock(compaction->mutex);
+            if (!compaction->running.insert(root.string()).second) {
                 continue;
             }
+        }
+        // Later changes start a fresh journal. Everything in the moved one is already in
+        // catalog, so the snapshot covers it; if the game stops before the new shard is
+        // in place, the next load replays both.
+        std::error_code ec;
+        if (std::filesystem::exists(SongCacheJournalPath(root), ec)) {
+            std::filesystem::rename(SongCacheJournalPath(root), SongCacheCompactingPath(root), ec);
+        }
+        if (ec) {
+            std::lock_guard lock(compaction->mutex);
+            compaction->running.erase(root.string());
+            continue;
+        }
+        if (!snapshot) {
+            snapshot = SnapshotCatalog();
+        }
+        std::thread([state = compaction, snapshot, root] {
+            int count = WriteShard(*snapshot, root);
+            if (count >= 0) {
+                std::error_code ec;
+                std::filesystem::remove(SongCacheCompactingPath(root), ec);
+                Encore::EncoreLogFormat(LOG_INFO, "CACHE: Compacted %i songs for %s", count, root.string().c_str());
+            }
+            {
+                std::lock_guard lock(state->mutex);
+                state->running.erase(root.string());
+            }
+            state->done.notify_all();
+        }).detach();
+    }
+}
 
-            directoryCount++;
-            Song song;
-            std::filesystem::path infoPath = entry.path() / "info.json";
-            if (std::filesystem::exists(infoPath)) {
-                song.LoadSong(infoPath);
-                try {
-                    json infoData;
-                    std::ifstream infoFile(infoPath);
-                    infoFile >> infoData;
-                    infoFile.close();
-
-                    if (infoData.contains("source") && infoData["source"].is_string()) {
-                        song.source = infoData["source"].get<std::string>();
-                        if (song.source.empty()) {
-                            song.source = "Unknown Source";
-                        }
-                    } else {
-                        song.source = "Unknown Source";
-                    }
+void SongList::WaitForCompaction() {
+    std::unique_lock lock(compaction->mutex);
+    compaction->done.wait(lock, [this] { return compaction->running.empty(); });
+}
 
-                    if (infoData.contains("release_year") && infoData["release_year"].is_string()) {
-                        song.releaseYear = infoData["release_year"].get<std::string>();
-                        if (song.releaseYear.empty()) {
-                            song.releaseYear = "Unknown Year";
-                        }
-                    } else {
-                        song.releaseYear = "Unknown Year";
-                    }
+void SongList::WriteCache() {
+    WriteShards(std::vector<char>(songRoots.size(), 1));
+}
 
-                    if (infoData.contains("preview_start_time") && infoData["preview_start_time"].is_number_integer()) {
-                        song.previewStartTime = infoData["preview_start_time"].get<int>();
-                    } else {
-                        song.previewStartTime = 3000;
-                    }
+void SongList::LoadSongFiles(const SongFolderSnapshot &folder, Song &song) {
+    if (!song.ini) {
+        song.LoadSong(song.songInfoPath, folder);
+        return;
+    }
+    song.songDir = folder.path();
+    song.LoadSongIni(folder.path(), folder);
+    song.jsonHash = Encore::HashFile(song.songInfoPath);
+    song.source = "Unknown Source";
+    song.releaseYear = "Unknown Year";
+    song.previewStartTime = 500;
+}
+
+// Loads the song in a single folder. Returns false if the folder doesn't hold a song.
+bool SongList::LoadSongFolder(const SongFolderSnapshot &folder, SongCatalogEntry &entry) {
+    // Stamp before reading, so a write that races the scan shows up as a change on
+    // the next startup
+    Encore::FileStamp infoStamp;
+    Song song;
+    std::filesystem::path infoPath = folder.path() / "info.json";
+    if (folder.Contains("info.json") && Encore::GetFileStamp(infoPath, infoStamp)) {
+        song.songInfoPath = infoPath;
+        LoadSongFiles(folder, song);
+    } else {
+        infoPath = folder.path() / "song.ini";
+        if (!folder.Contains("song.ini") || !Encore::GetFileStamp(infoPath, infoStamp)) {
+            return false;
+        }
+        song.songInfoPath = infoPath;
+        song.ini = true;
+        LoadSongFiles(folder, song);
+        Encore::EncoreLogFormat(LOG_INFO, "CACHE: No info.json for INI song %s - %s, using default metadata", song.title.c_str(), song.artist.c_str());
+    }
+    song.infoStamp = infoStamp;
+    entry = SongCatalogEntry(song);
+    return true;
+}
+
+// One thread enumerates the song roots while a pool of workers loads each folder, so
+// slow directory listings and slow metadata reads overlap. Songs come back in
+// enumeration order regardless of which worker finished first.
+std::vector<SongCatalogEntry> SongList::ScanFolders(
+    const std::vector<std::filesystem::path> &songsFolder,
+    const std::unordered_set<std::string_view> &skipDirs
+) {
+    struct ScanJob {
+        size_t order;
+        std::filesystem::path folder;
+    };
+    struct ScanResult {
+        size_t order;
+        SongCatalogEntry entry;
+    };
 
-                } catch (const std::exception& e) {
-                    song.source = "Unknown Source";
-                    song.releaseYear = "Unknown Year";
-                    song.previewStartTime = 500;
+    Encore::WorkQueue<ScanJob> jobs;
+    std::atomic_int foldersFound = 0;
+    std::atomic_int foldersLoaded = 0;
+    CurrentChartNumber = 0;
+    MaxChartsToLoad = 0;
+
+    std::thread producer([&] {
+        size_t order = 0;
+        for (const auto &folder : songsFolder) {
+            std::error_code error;
+            if (!std::filesystem::is_directory(folder, error)) {
+                continue;
+            }
+            // increment(error) rather than a range-for, whose ++ throws on a read error
+            // partway through the listing
+            std::filesystem::directory_iterator it(folder, error);
+            for (; !error && it != std::filesystem::directory_iterator();
+                 it.increment(error)) {
+                std::error_code typeError;
+                if (!it->is_directory(typeError)) {
+                    continue;
+                }
+                if (skipDirs.contains(it->path().string())) {
+                    badSongCount++;
+                    continue;
                 }
-            } else if (std::filesystem::exists(entry.path() / "song.ini")) {
-                song.songInfoPath = (entry.path() / "song.ini");
-                song.songDir = entry.path();
-                song.LoadSongIni(entry.path());
-                song.ini = true;
-                if (std::filesystem::exists(infoPath)) {
-                    try {
-                        json infoData;
-                        std::ifstream infoFile(infoPath);
-                        infoFile >> infoData;
-                        infoFile.close();
-
-                        if (infoData.contains("source") && infoData["source"].is_string()) {
-                            song.source = infoData["source"].get<std::string>();
-                            if (song.source.empty()) {
-                                song.source = "Unknown Source";
-                            }
-                        } else {
-                            song.source = "Unknown Source";
-                        }
-
-                        if (infoData.contains("release_year") && infoData["release_year"].is_string()) {
-                            song.releaseYear = infoData["release_year"].get<std::string>();
-                            if (song.releaseYear.empty()) {
-                                song.releaseYear = "Unknown Year";
-                            }
-                        } else {
-                            song.releaseYear = "Unknown Year";
-                        }
-
-                        if (infoData.contains("preview_start_time") && infoData["preview_start_time"].is_number_integer()) {
-                            song.previewStartTime = infoData["preview_start_time"].get<int>();
-                        } else {
-                            song.previewStartTime = 500;
-                        }
-
-                        Encore::EncoreLog(LOG_INFO, TextFormat("CACHE: Read metadata for INI song %s - %s from %s", song.title.c_str(), song.artist.c_str(), infoPath.string().c_str()));
-                    } catch (const std::exception& e) {
-                        Encore::EncoreLog(LOG_ERROR, TextFormat("CACHE: Failed to read metadata for INI song %s - %s from %s: %s", song.title.c_str(), song.artist.c_str(), infoPath.string().c_str(), e.what()));
-                        song.source = "Unknown Source";
-                        song.releaseYear = "Unknown Year";
-                        song.previewStartTime = 500;
+                jobs.Push({ order++, it->path() });
+                MaxChartsToLoad = ++foldersFound;
+            }
+        }
+        jobs.Close();
+    });
+
+    unsigned int workerCount = Encore::LibraryWorkerCount();
+    std::vector<std::vector<ScanResult> > workerResults(workerCount);
+    std::vector<std::thread> workers;
+    workers.reserve(workerCount);
+    for (unsigned int i = 0; i < workerCount; i++) {
+        workers.emplace_back([&, i] {
+            while (std::optional<ScanJob> job = jobs.Pop()) {
+                SongCatalogEntry entry;
+                try {
+                    if (LoadSongFolder(SongFolderSnapshot(job->folder), entry)) {
+                        workerResults[i].push_back({ job->order, std::move(entry) });
                     }
-                } else {
-                    song.source = "Unknown Source";
-                    song.releaseYear = "Unknown Year";
-                    song.previewStartTime = 500;
-                    Encore::EncoreLog(LOG_INFO, TextFormat("CACHE: No info.json for INI song %s - %s, using default metadata", song.title.c_str(), song.artist.c_str()));
+                } catch (const std::exception &e) {
+                    Encore::EncoreLogFormat(LOG_ERROR, "CACHE: Failed to load %s: %s", job->folder.string().c_str(), e.what());
                 }
-            } else {
-                continue;
+                CurrentChartNumber = ++foldersLoaded;
             }
+        });
+    }
+
+    producer.join();
+    for (auto &worker : workers) {
+        worker.join();
+    }
+
+    std::vector<ScanResult> merged;
+    for (auto &results : workerResults) {
+        std::move(results.begin(), results.end(), std::back_inserter(merged));
+    }
+    std::sort(merged.begin(), merged.end(), [](const ScanResult &a, const ScanResult &b) {
+        return a.order < b.order;
+    });
+
+    directoryCount += foldersFound;
+    std::vector<SongCatalogEntry> loaded;
+    loaded.reserve(merged.size());
+    for (auto &result : merged) {
+        loaded.push_back(std::move(result.entry));
+    }
+    return loaded;
+}
 
-            songs.push_back(std::move(song));
-            songCount++;
+void SongList::ScanSongs(const std::vector<std::filesystem::path> &songsFolder) {
+    Clear();
+    SetRoots(songsFolder);
+
+    std::vector<std::filesystem::path> onlineRoots;
+    for (size_t root = 0; root < songRoots.size(); root++) {
+        std::error_code error;
+        rootOffline[root] = !std::filesystem::is_directory(songRoots[root], error);
+        if (!rootOffline[root]) {
+            onlineRoots.push_back(songRoots[root]);
         }
     }
+    std::vector<SongCatalogEntry> entries = ScanFolders(onlineRoots, {});
+    catalog.reserve(entries.size());
+    for (const auto &entry : entries) {
+        catalog.Add(entry);
+    }
+    songCount = catalog.SongCount();
 
     Encore::EncoreLog(LOG_INFO, "CACHE: Rewriting song cache");
     WriteCache();
+
+    auto snapshot = SnapshotCatalog();
+    InvalidateOrderings(snapshot);
+    RebuildSearchIndex(snapshot);
+    sortList(currentSortType);
+    if (watcher.IsRunning()) {
+        watcher.Start(songRoots, catalog);
+    }
 }
 
 std::string GetLengthHeader(int length) {
@@ -304,30 +567,98 @@ std::string GetLengthHeader(int length) {
     return "5:00+";
 }
 
-// Using the more robust header generation from songlist.cpp
-std::vector<ListMenuEntry> SongList::GenerateSongEntriesWithHeaders(
-    const std::vector<Song> &songs, SortType sortType
+std::shared_ptr<const SongOrdering>
+SongList::BuildOrdering(const SongCatalog &catalog, SortType sortType) {
+    std::vector<SongSortFields> fields;
+    fields.reserve(catalog.size());
+    for (int id = 0; id < (int)catalog.size(); id++) {
+        fields.emplace_back(catalog, id);
+    }
+
+    auto ordering = std::make_shared<SongOrdering>();
+    ordering->order.reserve(catalog.SongCount());
+    for (int id = 0; id < (int)catalog.size(); id++) {
+        if (!catalog.IsRemoved(id)) {
+            ordering->order.push_back(id);
+        }
+    }
+    SongCompare compare = PrimarySortFunction(sortType);
+    std::stable_sort(ordering->order.begin(), ordering->order.end(), [&](int a, int b) {
+        return compare(fields[a], fields[b]);
+    });
+    FillOrderingEntries(catalog, sortType, *ordering);
+    return ordering;
+}
+
+std::shared_ptr<const SongOrdering> SongList::SpliceOrdering(
+    const SongCatalog &catalog,
+    SortType sortType,
+    const SongOrdering &shown,
+    const std::vector<char> &changed
+) {
+    auto isChanged = [&](int id) {
+        return id < (int)changed.size() && changed[id];
+    };
+    std::vector<int> kept;
+    kept.reserve(shown.order.size());
+    for (int id : shown.order) {
+        if (!catalog.IsRemoved(id) && !isChanged(id)) {
+            kept.push_back(id);
+        }
+    }
+    std::vector<int> spliced;
+    for (int id = 0; id < (int)changed.size(); id++) {
+        if (changed[id] && !catalog.IsRemoved(id)) {
+            spliced.push_back(id);
+        }
+    }
+
+    // Songs that compare equal stay in ID order, which is where a full build's stable
+    // sort leaves them. Sorting just the changed songs and merging them in is one pass
+    // over the list however many songs changed.
+    SongCompare compare = PrimarySortFunction(sortType);
+    auto before = [&](int a, int b) {
+        SongSortFields songA(catalog, a);
+        SongSortFields songB(catalog, b);
+        if (compare(songA, songB)) {
+            return true;
+        }
+        return !compare(songB, songA) && a < b;
+    };
+    std::sort(spliced.begin(), spliced.end(), before);
+    auto ordering = std::make_shared<SongOrdering>();
+    ordering->order.reserve(kept.size() + spliced.size());
+    std::merge(
+        kept.begin(), kept.end(), spliced.begin(), spliced.end(),
+        std::back_inserter(ordering->order), before
+    );
+    FillOrderingEntries(catalog, sortType, *ordering);
+    return ordering;
+}
+
+void SongList::FillOrderingEntries(
+    const SongCatalog &catalog, SortType sortType, SongOrdering &ordering
 ) {
-    std::vector<ListMenuEntry> songEntries;
+    std::vector<ListMenuEntry> &songEntries = ordering.entries;
+    ordering.listPos.assign(catalog.size(), 0);
+    songEntries.reserve(ordering.order.size());
     std::string currentHeader = "";
-    int pos = 0;
-    for (size_t i = 0; i < songs.size(); i++) {
-        const Song &song = songs[i];
+    for (int id : ordering.order) {
+        SongSortFields song(catalog, id);
         std::string header;
         switch (sortType) {
         case SortType::Title: {
-            std::string title = removeArticle(TextToLower(song.title.c_str()));
-            header = title.empty() ? "#" : std::string(1, toupper(title[0]));
+            header = Encore::SortKeyHeader(song.titleKey);
             break;
         }
+        // Headers come from the same folded keys the songs are sorted by, so songs
+        // that sort together never alternate between headers
         case SortType::Artist: {
-            std::string artist = removeArticle(song.artist);
-            header = artist.empty() ? "#" : artist;
+            header = Encore::SortKeyHeader(song.artistKey);
             break;
         }
         case SortType::Source: {
-            std::string source = removeArticle(song.source);
-            header = source.empty() ? "Unknown" : source;
+            header = song.sourceKey.empty() ? "Unknown" : Encore::SortKeyHeader(song.sourceKey);
             break;
         }
         case SortType::Length: {
@@ -335,7 +666,7 @@ std::vector<ListMenuEntry> SongList::GenerateSongEntriesWithHeaders(
             break;
         }
         case SortType::Year: {
-            header = song.releaseYear.empty() ? "Unknown Year" : song.releaseYear;
+            header = song.releaseYear.empty() ? "Unknown Year" : std::string(song.releaseYear);
             break;
         }
         default:
@@ -345,157 +676,499 @@ std::vector<ListMenuEntry> SongList::GenerateSongEntriesWithHeaders(
         if (header != currentHeader) {
             currentHeader = header;
             songEntries.emplace_back(true, 0, currentHeader, false);
-            pos++;
         }
-        songEntries.emplace_back(false, i, "", false);
-        pos++;
-        this->songs[i].songListPos = pos;
+        songEntries.emplace_back(false, id, "", false);
+        ordering.listPos[id] = songEntries.size();
     }
-
-    return songEntries;
 }
 
-void SongList::LoadCache(const std::vector<std::filesystem::path> &songsFolder) {
-    encore::bin_ifstream_native SongCacheIn("songCache.encr", std::ios::binary);
-    if (!SongCacheIn) {
-        Encore::EncoreLog(LOG_WARNING, "CACHE: Failed to load song cache!");
-        SongCacheIn.close();
-        ScanSongs(songsFolder);
-        return;
-    }
+namespace {
+    // Opens each shard's journal the first time a change lands in it
+    class ShardJournals {
+        const std::vector<std::filesystem::path> &roots;
+        std::vector<std::unique_ptr<SongCacheJournal> > journals;
 
-    // Read header
-    uint32_t header;
-    SongCacheIn >> header;
-    if (header != SONG_CACHE_HEADER) {
-        Encore::EncoreLog(LOG_WARNING, "CACHE: Invalid song cache format, rescanning");
-        SongCacheIn.close();
-        ScanSongs(songsFolder);
-        return;
-    }
+    public:
+        explicit ShardJournals(const std::vector<std::filesystem::path> &roots)
+            : roots(roots), journals(roots.size()) {}
 
-    uint32_t version;
-    SongCacheIn >> version;
-    if (version != SONG_CACHE_VERSION) {
-        Encore::EncoreLog(
-            LOG_WARNING,
-            TextFormat(
-                "CACHE: Cache version %01i, but current version is %01i",
-                version,
-                SONG_CACHE_VERSION
-            )
-        );
-        SongCacheIn.close();
-        ScanSongs(songsFolder);
-        return;
-    }
+        // nullptr for songs outside every root
+        SongCacheJournal *For(int root) {
+            if (root < 0) {
+                return nullptr;
+            }
+            if (!journals[root]) {
+                std::error_code ec;
+                std::filesystem::create_directories(SONG_CACHE_DIR, ec);
+                journals[root] = std::make_unique<SongCacheJournal>(SongCacheJournalPath(roots[root]));
+            }
+            return journals[root].get();
+        }
 
-    size_t cachedSongCount;
-    SongCacheIn >> cachedSongCount;
-    ListLoadingState = LOADING_CACHE;
-    // Load cached songs
-    Clear();
-    Encore::EncoreLog(LOG_INFO, "CACHE: Loading song cache");
-    std::set<std::string> loadedSongs; // To track loaded songs and avoid duplicates
-    MaxChartsToLoad = cachedSongCount;
-    for (int i = 0; i < cachedSongCount; i++) {
-        CurrentChartNumber = i;
-        Song song;
+        [[nodiscard]]
+        bool good() const {
+            for (const auto &journal : journals) {
+                if (journal && !journal->good()) {
+                    return false;
+                }
+            }
+            return true;
+        }
+    };
 
-        std::string songDirStr, songInfoPathStr;
-        // Read cache values
-        SongCacheIn >> songDirStr;
-        SongCacheIn >> song.albumArtPath;
-        SongCacheIn >> songInfoPathStr;
-        SongCacheIn >> song.jsonHash;
+    // What one root's shard and journals held, checked against the disk
+    struct ShardLoad {
+        SongCatalog songs;
+        // The shard is missing or unusable and has to be written from scratch
+        bool rebuild = false;
+        // Changes found while checking, to be journaled: songs that are gone, and
+        // songs whose info file was touched without changing
+        std::vector<std::string> removed;
+        std::vector<SongCatalogEntry> refreshed;
+    };
 
-        song.songDir = songDirStr;
-        song.songInfoPath = songInfoPathStr;
+    enum class InfoCheck {
+        Current,
+        Touched, // the mtime moved but the contents didn't
+        Changed,
+        Removed
+    };
 
-        SongCacheIn >> song.title;
-        SongCacheIn >> song.artist;
+    // Checks a cached song against its info file. Only re-hashes the file if its size
+    // or mtime moved.
+    InfoCheck CheckInfoFile(
+        const std::filesystem::path &infoPath,
+        const Encore::FileStamp &cachedStamp,
+        std::string_view jsonHash,
+        Encore::FileStamp &currentStamp
+    ) {
+        if (!Encore::GetFileStamp(infoPath, currentStamp)) {
+            return InfoCheck::Removed;
+        }
+        if (currentStamp == cachedStamp) {
+            return InfoCheck::Current;
+        }
+        // A changed file is parsed again by the folder scan, which journals the new
+        // version
+        return Encore::HashFile(infoPath) == jsonHash ? InfoCheck::Touched : InfoCheck::Changed;
+    }
 
-        SongCacheIn >> song.length;
-        SongCacheIn >> song.releaseYear;
+    // Song folders as keys, looked up by string_view without building a std::string
+    struct SongDirHash {
+        using is_transparent = void;
+        size_t operator()(std::string_view songDir) const {
+            return std::hash<std::string_view>()(songDir);
+        }
+    };
 
-        Encore::EncoreLog(LOG_INFO, TextFormat("CACHE: Directory - %s", song.songDir.string().c_str()));
+    void LoadShard(const std::filesystem::path &root, ShardLoad &shard) {
+        SongCacheView cache;
+        if (!cache.Open(SongCacheShardPath(root), root)) {
+            // Every song under this root comes back as a new folder from the scan
+            shard.rebuild = true;
+            return;
+        }
 
-        if (!std::filesystem::exists(song.songDir)) {
-            continue;
+        // Journaled songs win over the shard's records, so read the journals first
+        // (including one whose compaction didn't finish) and skip what they replaced
+        std::unordered_map<std::string, std::optional<SongCatalogEntry>, SongDirHash, std::equal_to<> >
+            journaled;
+        std::vector<std::string> journalOrder;
+        auto journalSlot = [&](const std::string &songDir) -> std::optional<SongCatalogEntry> & {
+            auto [it, inserted] = journaled.try_emplace(songDir);
+            if (inserted) {
+                journalOrder.push_back(songDir);
+            }
+            return it->second;
+        };
+        for (const auto &path : { SongCacheCompactingPath(root), SongCacheJournalPath(root) }) {
+            SongCacheJournal::Replay(
+                path,
+                [&](const std::string &songDir) {
+                    journalSlot(songDir) = std::nullopt;
+                },
+                [&](SongCatalogEntry &added) {
+                    journalSlot(added.songDir.string()) = std::move(added);
+                }
+            );
         }
 
-        // Set other info properties
-        if (song.songInfoPath.filename() == "song.ini") {
-            song.ini = true;
+        // Records go straight from the mapped string table into the root's catalog;
+        // only songs whose info file was touched are built into an entry, to journal
+        MaxChartsToLoad += cache.size() + journalOrder.size();
+        shard.songs.reserve(cache.size() + journalOrder.size());
+        for (size_t i = 0; i < cache.size(); i++) {
+            CurrentChartNumber++;
+            const SongCacheRecord &record = cache[i];
+            std::string_view songDir = cache.String(record.songDir);
+            if (journaled.contains(songDir) || shard.songs.Find(songDir) >= 0) {
+                continue;
+            }
+            Encore::FileStamp currentStamp;
+            InfoCheck check = CheckInfoFile(
+                cache.String(record.songInfoPath),
+                { record.infoSize, record.infoModified },
+                cache.String(record.jsonHash),
+                currentStamp
+            );
+            if (check == InfoCheck::Removed) {
+                shard.removed.emplace_back(songDir);
+                continue;
+            }
+            if (check == InfoCheck::Changed) {
+                continue;
+            }
+            if (check == InfoCheck::Touched) {
+                SongCatalogEntry &entry = shard.refreshed.emplace_back();
+                cache.FillEntry(record, entry);
+                entry.infoStamp = currentStamp;
+            }
+            int id = shard.songs.AddRecord(cache, record);
+            shard.songs.SetInfoStamp(id, currentStamp);
         }
 
-        std::ifstream jsonFile(song.songInfoPath);
-        std::string jsonHashNew = "";
-        if (jsonFile) {
-            auto itBegin = std::istreambuf_iterator<char>(jsonFile);
-            auto itEnd = std::istreambuf_iterator<char>();
-            std::string jsonString(itBegin, itEnd);
-            jsonFile.close();
+        for (const auto &songDir : journalOrder) {
+            CurrentChartNumber++;
+            auto &added = journaled[songDir];
+            if (!added || shard.songs.Find(songDir) >= 0) {
+                continue;
+            }
+            Encore::FileStamp currentStamp;
+            InfoCheck check = CheckInfoFile(
+                added->songInfoPath, added->infoStamp, added->jsonHash, currentStamp
+            );
+            if (check == InfoCheck::Removed) {
+                shard.removed.push_back(songDir);
+                continue;
+            }
+            if (check == InfoCheck::Changed) {
+                continue;
+            }
+            added->infoStamp = currentStamp;
+            if (check == InfoCheck::Touched) {
+                shard.refreshed.push_back(*added);
+            }
+            shard.songs.Add(*added);
+        }
+    }
+}
 
-            jsonHashNew = picosha2::hash256_hex_string(jsonString);
+void SongList::LoadCache(const std::vector<std::filesystem::path> &songsFolder) {
+    ListLoadingState = LOADING_CACHE;
+    // A compaction still running would move the journals while they're being read
+    WaitForCompaction();
+    Clear();
+    SetRoots(songsFolder);
+    Encore::EncoreLog(LOG_INFO, "CACHE: Loading song cache");
+    CurrentChartNumber = 0;
+    MaxChartsToLoad = 0;
+
+    // Each root is checked on its own thread, so a slow drive only holds up its own
+    // songs. An unreachable root is skipped and its shard left alone.
+    std::vector<ShardLoad> shards(songRoots.size());
+    std::vector<std::thread> loaders;
+    for (size_t root = 0; root < songRoots.size(); root++) {
+        loaders.emplace_back([this, root, &shards] {
+            std::error_code error;
+            if (!std::filesystem::is_directory(songRoots[root], error)) {
+                rootOffline[root] = 1;
+                Encore::EncoreLogFormat(LOG_WARNING, "CACHE: %s is unavailable, keeping its cache for later", songRoots[root].string().c_str());
+                return;
+            }
+            LoadShard(songRoots[root], shards[root]);
+        });
+    }
+    for (auto &loader : loaders) {
+        loader.join();
+    }
+
+    // Load additional songs from directories if needed
+    ListLoadingState = SCANNING_EXTRAS;
+    std::vector<std::filesystem::path> onlineRoots;
+    std::unordered_set<std::string_view> loadedSongs;
+    for (size_t root = 0; root < songRoots.size(); root++) {
+        if (!rootOffline[root]) {
+            onlineRoots.push_back(songRoots[root]);
+            const SongCatalog &songs = shards[root].songs;
+            for (int id = 0; id < (int)songs.size(); id++) {
+                loadedSongs.insert(songs.Get(id, SongCatalog::SongDir));
+            }
+        }
+    }
+    std::vector<std::vector<SongCatalogEntry> > extras(songRoots.size());
+    for (auto &extra : ScanFolders(onlineRoots, loadedSongs)) {
+        int root = RootIndexFor(extra.songDir);
+        if (root >= 0) {
+            extras[root].push_back(std::move(extra));
         }
+    }
 
-        if (song.jsonHash != jsonHashNew) {
+    size_t total = 0;
+    for (size_t root = 0; root < songRoots.size(); root++) {
+        total += shards[root].songs.size() + extras[root].size();
+    }
+    catalog.reserve(total);
+    for (size_t root = 0; root < songRoots.size(); root++) {
+        catalog.Append(shards[root].songs);
+        for (const auto &entry : extras[root]) {
+            catalog.Add(entry);
+        }
+    }
+    songCount = catalog.SongCount();
+
+    // Shards that are missing get written whole; everything else only has its changes
+    // appended to the journal
+    std::vector<char> rebuild(songRoots.size(), 0);
+    ShardJournals journals(songRoots);
+    int journaled = 0;
+    for (size_t root = 0; root < songRoots.size(); root++) {
+        ShardLoad &shard = shards[root];
+        if (rootOffline[root]) {
             continue;
         }
-        loadedSongs.insert(song.songDir.string());
-        songs.push_back(std::move(song));
+        if (shard.rebuild) {
+            rebuild[root] = 1;
+            continue;
+        }
+        for (const auto &songDir : shard.removed) {
+            journals.For(root)->RemoveSong(songDir);
+        }
+        for (const auto &entry : shard.refreshed) {
+            journals.For(root)->AddSong(entry);
+        }
+        for (const auto &entry : extras[root]) {
+            journals.For(root)->AddSong(entry);
+        }
+        journaled += shard.removed.size() + shard.refreshed.size() + extras[root].size();
+    }
+    if (!journals.good()) {
+        Encore::EncoreLog(LOG_WARNING, "CACHE: Failed to update song cache journal");
+    }
+    if (journaled > 0) {
+        Encore::EncoreLogFormat(LOG_INFO, "CACHE: Journaled %01i changed songs", journaled);
+    }
+    if (std::find(rebuild.begin(), rebuild.end(), 1) != rebuild.end()) {
+        Encore::EncoreLog(LOG_INFO, "CACHE: Writing missing song cache shards");
+        WriteShards(rebuild);
+    }
+    // The single cache file from before shards
+    std::error_code ec;
+    std::filesystem::remove("songCache.encr", ec);
+    std::filesystem::remove("songCache.journal", ec);
+    CompactShards();
+
+    auto snapshot = SnapshotCatalog();
+    InvalidateOrderings(snapshot);
+    RebuildSearchIndex(snapshot);
+    sortList(SortType::Title);
+}
+
+void SongList::StartWatching() {
+    // The normalized roots, so the folders the watcher builds match the catalog's keys
+    watcher.Start(songRoots, catalog);
+}
+
+void SongList::StopWatching() {
+    watcher.Stop();
+}
 
+// Comparator that defines the order of the list for a sort type
+SongList::SongCompare SongList::PrimarySortFunction(SortType sortType) {
+    switch (sortType) {
+    case SortType::Artist:
+        return sortArtist;
+    case SortType::Source:
+        return sortSource;
+    case SortType::Length:
+        return sortLen;
+    case SortType::Year:
+        return sortYear;
+    default:
+        return sortTitle;
     }
+}
 
-    SongCacheIn.close();
-    size_t loadedSongCount = songs.size();
+bool SongList::ApplyLibraryChanges(bool &selectionMoved, std::vector<int> &editedSongs) {
+    selectionMoved = false;
+    editedSongs.clear();
+    std::vector<LibraryChange> changes = watcher.TakeChanges();
+    if (changes.empty()) {
+        return false;
+    }
 
-    // Load additional songs from directories if needed
-    LoadingState = SCANNING_EXTRAS;
-    for (const auto &folder : songsFolder) {
-        if (!std::filesystem::is_directory(folder)) {
-            continue;
-        }
+    bool selectedEdited = false;
+    // Where the selection is in the list as shown, so a deleted selection can fall to
+    // its neighbour
+    int selectedPos = curSong ? catalog.ListPos(curSongID) - 1 : -1;
+    // Added and edited songs by ID, to splice into the orderings. IDs never move, so
+    // removed songs just drop out of them.
+    std::vector<char> changed(catalog.size(), 0);
+    std::shared_ptr<const SongOrdering> shown;
+    {
+        std::lock_guard lock(orderingCache->mutex);
+        shown = orderingCache->orderings[(size_t)currentSortType];
+    }
+    ShardJournals journals(songRoots);
+    // Patched in place in one batch; one still being built started from the catalog
+    // before these changes, so it's built again
+    std::shared_ptr<SongSearchIndex> index = CurrentSearchIndex();
+    std::vector<std::pair<int, std::string> > documents;
 
-        for (const auto &entry : std::filesystem::directory_iterator(folder)) {
-            if (!std::filesystem::is_directory(entry)) {
+    for (auto &change : changes) {
+        int id = catalog.Find(change.songDir.string());
+        SongCacheJournal *journal = journals.For(RootIndexFor(change.songDir));
+        if (change.type == LibraryChange::Removed) {
+            if (id < 0) {
                 continue;
             }
-
-            if (std::filesystem::exists(entry.path() / "info.json")) {
-                if (loadedSongs.find(entry.path().string()) == loadedSongs.end()) {
-                    Song song;
-                    song.LoadSong(entry.path() / "info.json");
-                    songs.push_back(std::move(song));
-                    songCount++;
-                } else {
-                    badSongCount++;
-                }
+            if (journal) {
+                journal->RemoveSong(change.songDir);
             }
+            catalog.Erase(id);
+            if (index) {
+                documents.emplace_back(id, std::string());
+            }
+            continue;
+        }
+        if (id >= 0) {
+            // Edited in place so the song keeps its ID. The summary checks itself
+            // against the MIDI, so it survives info edits.
+            change.entry.midiHash = catalog.Get(id, SongCatalog::MidiHash);
+            change.entry.chartSummary = catalog.Get(id, SongCatalog::ChartSummaryBlob);
+            if (journal) {
+                journal->AddSong(change.entry);
+            }
+            catalog.Set(id, change.entry);
+            editedSongs.push_back(id);
+            selectedEdited |= id == curSongID;
+        } else {
+            if (journal) {
+                journal->AddSong(change.entry);
+            }
+            id = catalog.Add(change.entry);
+            changed.resize(catalog.size(), 0);
+        }
+        changed[id] = 1;
+        if (index) {
+            documents.emplace_back(id, SongSearchIndex::MakeDocument(catalog, id));
+        }
+    }
+    if (index) {
+        index->Update(std::move(documents));
+    }
+    if (!journals.good()) {
+        Encore::EncoreLog(LOG_WARNING, "CACHE: Failed to update song cache journal");
+    }
 
-            if (std::filesystem::exists(entry.path() / "song.ini")) {
-                if (loadedSongs.find(entry.path().string()) == loadedSongs.end()) {
-                    Song song;
-                    song.songInfoPath = (entry.path() / "song.ini");
-                    song.songDir = entry.path();
-                    song.LoadSongIni(entry.path());
-                    song.ini = true;
-
-                    songs.push_back(std::move(song));
-                    songCount++;
-                } else {
-                    badSongCount++;
+    songCount = catalog.SongCount();
+    CompactShards();
+    if (curSongID >= 0 && catalog.IsRemoved(curSongID)) {
+        // The menus expect a selection once there has been one, so the selected song's
+        // nearest surviving neighbour in the old list takes its place, the one below
+        // first. listMenuEntries still holds the list from before the changes.
+        int neighbour = -1;
+        for (int distance = 1; distance <= (int)listMenuEntries.size() && neighbour < 0; distance++) {
+            for (int pos : { selectedPos + distance, selectedPos - distance }) {
+                if (pos < 0 || pos >= (int)listMenuEntries.size()) {
+                    continue;
+                }
+                const ListMenuEntry &entry = listMenuEntries[pos];
+                if (!entry.isHeader && !catalog.IsRemoved(entry.songListID)) {
+                    neighbour = entry.songListID;
+                    break;
                 }
             }
         }
+        // Nothing left in the old list, say a search only showed the deleted song
+        for (int id = 0; id < (int)catalog.size() && neighbour < 0; id++) {
+            if (!catalog.IsRemoved(id)) {
+                neighbour = id;
+            }
+        }
+        if (neighbour >= 0) {
+            LoadRuntimeSong(neighbour);
+            selectionMoved = true;
+        } else {
+            curSong = nullptr;
+            curSongID = -1;
+        }
+    } else if (selectedEdited) {
+        LoadRuntimeSong(curSongID);
     }
+    // Only the shown order is patched here; the other modes are patched the same way
+    // in the background from one copy of the catalog
+    auto snapshot = SnapshotCatalog();
+    if (!index) {
+        RebuildSearchIndex(snapshot);
+    }
+    InvalidateOrderings(snapshot, &changed);
+    if (shown) {
+        auto ordering = SpliceOrdering(catalog, currentSortType, *shown, changed);
+        std::lock_guard lock(orderingCache->mutex);
+        orderingCache->orderings[(size_t)currentSortType] = ordering;
+    }
+    sortList(currentSortType);
+    return true;
+}
 
-    if (cachedSongCount != loadedSongCount || songs.size() != loadedSongCount) {
-        Encore::EncoreLog(LOG_INFO, "CACHE: Updating song cache");
-        WriteCache();
+Song *SongList::SelectSong(int id) {
+    if (id < 0 || id >= (int)catalog.size() || catalog.IsRemoved(id)) {
+        return nullptr;
+    }
+    if (!curSong || id != curSongID) {
+        LoadRuntimeSong(id);
     }
+    return curSong;
+}
 
-    // ScanSongs(songsFolder);
-    sortList(SortType::Title);
+void SongList::LoadRuntimeSong(int id) {
+    auto song = std::make_unique<Song>();
+    catalog.FillSong(id, *song);
+    try {
+        LoadSongFiles(SongFolderSnapshot(song->songDir), *song);
+    } catch (const std::exception &e) {
+        Encore::EncoreLogFormat(LOG_ERROR, "SONG: Failed to load %s: %s", song->songDir.string().c_str(), e.what());
+    }
+    // The textures are owned by TheAlbumArtCache, so the old song's art just stays there
+    if (runtimeSong && runtimeSong->AlbumArtLoaded
+        && runtimeSong->albumArtPath == song->albumArtPath) {
+        song->albumArt = runtimeSong->albumArt;
+        song->albumArtBlur = runtimeSong->albumArtBlur;
+        song->AlbumArtLoaded = true;
+    }
+    runtimeSong = std::move(song);
+    curSong = runtimeSong.get();
+    curSongID = id;
+}
+
+void SongList::SaveChartSummary(const Song &song) {
+    if (curSongID < 0 || &song != curSong) {
+        return;
+    }
+    SaveChartSummaries({ { curSongID, song.chartSummary } });
+}
+
+void SongList::SaveChartSummaries(const std::vector<std::pair<int, ChartSummary> > &summaries) {
+    {
+        ShardJournals journals(songRoots);
+        for (const auto &[id, summary] : summaries) {
+            if (id < 0 || id >= (int)catalog.size() || catalog.IsRemoved(id)) {
+                continue;
+            }
+            SongCatalogEntry entry = catalog.Entry(id);
+            entry.midiHash = summary.midiHash;
+            entry.chartSummary = EncodeChartSummary(summary);
+            catalog.SetChartSummary(id, entry.midiHash, entry.chartSummary);
+
+            SongCacheJournal *journal = journals.For(RootIndexFor(entry.songDir));
+            if (journal) {
+                journal->AddSong(entry);
+            }
+        }
+        if (!journals.good()) {
+            Encore::EncoreLog(LOG_WARNING, "CACHE: Failed to update song cache journal");
+        }
+    }
+    // The journals are closed now, so compaction can move them
+    CompactShards();
 }
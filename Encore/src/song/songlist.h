@@ -1,17 +1,20 @@
 #pragma once
 #include <filesystem>
 #include <vector>
+#include <array>
 #include <atomic>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <string_view>
+#include <unordered_set>
 
 #include "song.h"
-
-// Version is formatted as YY_MM_DD_RR, where:
-// - YY: Current year (2 digits, 4 digits impedes on 32-bit integer limit)
-// - MM: Current month
-// - DD: Current day
-// - RR: Number of times the cache was revised that day, starting from 1
-#define SONG_CACHE_VERSION 25042503
-#define SONG_CACHE_HEADER 0x52434E45 // "ENCR"
+#include "songcache.h"
+#include "songcatalog.h"
+#include "librarywatcher.h"
+#include "songsearch.h"
 
 struct ListMenuEntry {
     bool isHeader;
@@ -54,6 +57,51 @@ inline std::atomic_int ListLoadingState = -1;
 inline std::atomic_int MaxChartsToLoad = -1;
 inline std::vector<std::string> sortTypes { "Title", "Artist", "Source", "Length", "Year" };
 
+// What sorting and list headers need from a song, pointing into a catalog that stays
+// unchanged while the ordering is built
+struct SongSortFields {
+    std::string_view titleKey;
+    std::string_view artistKey;
+    std::string_view albumKey;
+    std::string_view sourceKey;
+    std::string_view releaseYear;
+    int length = 0;
+
+    SongSortFields(const SongCatalog &catalog, int id);
+};
+
+// The list in one sort order. Song IDs are indices into SongList::catalog, which never
+// gets reordered.
+struct SongOrdering {
+    std::vector<int> order; // song IDs in display order
+    std::vector<ListMenuEntry> entries; // including headers
+    std::vector<int> listPos; // by song ID, same meaning as Song::songListPos
+};
+
+// Orderings for every SortType, shared with the threads that build them. A generation
+// bump throws away everything built from an older song list.
+struct SongOrderingCache {
+    std::mutex mutex;
+    uint64_t generation = 0;
+    std::array<std::shared_ptr<const SongOrdering>, (size_t)SortType::EnumEnd> orderings;
+};
+
+// The search index, built on a worker and handed over under the mutex. Only the render
+// thread reads or updates an index once it's published.
+struct SongSearchState {
+    std::mutex mutex;
+    uint64_t generation = 0;
+    std::shared_ptr<SongSearchIndex> index;
+};
+
+// Roots whose shard is being rewritten in the background, so a second compaction or a
+// full write waits for the first instead of racing it
+struct ShardCompactionState {
+    std::mutex mutex;
+    std::condition_variable done;
+    std::set<std::string> running;
+};
+
 enum SongListLoadingStates {
     FINDING_CACHE,
     LOADING_CACHE,
@@ -63,12 +111,89 @@ enum SongListLoadingStates {
 class SongList {
 
 
-    static bool sortArtist(const Song &a, const Song &b);
-    static bool sortTitle(const Song &a, const Song &b);
-    static bool sortSource(const Song &a, const Song &b);
-    static bool sortAlbum(const Song &a, const Song &b);
-    static bool sortLen(const Song &a, const Song &b);
-    static bool sortYear(const Song &a, const Song &b);
+    static bool sortArtist(const SongSortFields &a, const SongSortFields &b);
+    static bool sortTitle(const SongSortFields &a, const SongSortFields &b);
+    static bool sortSource(const SongSortFields &a, const SongSortFields &b);
+    static bool sortAlbum(const SongSortFields &a, const SongSortFields &b);
+    static bool sortLen(const SongSortFields &a, const SongSortFields &b);
+    static bool sortYear(const SongSortFields &a, const SongSortFields &b);
+
+    using SongCompare = bool (*)(const SongSortFields &, const SongSortFields &);
+    static SongCompare PrimarySortFunction(SortType sortType);
+
+    SongLibraryWatcher watcher;
+    SortType currentSortType = SortType::Title;
+    std::shared_ptr<SongOrderingCache> orderingCache =
+        std::make_shared<SongOrderingCache>();
+
+    // Forgets every cached ordering. Call whenever catalog is added to, removed from or
+    // edited.
+    void DropOrderings();
+    // A copy of catalog for background builds to read while this one changes
+    [[nodiscard]]
+    std::shared_ptr<const SongCatalog> SnapshotCatalog() const;
+    // DropOrderings(), then builds the other sort modes from snapshot in the background.
+    // With changed (see SpliceOrdering) the orderings from before are spliced instead.
+    void InvalidateOrderings(
+        const std::shared_ptr<const SongCatalog> &snapshot,
+        const std::vector<char> *changed = nullptr
+    );
+    void ApplyOrdering(const SongOrdering &ordering);
+    // Fills in entries and listPos from order
+    static void FillOrderingEntries(
+        const SongCatalog &catalog, SortType sortType, SongOrdering &ordering
+    );
+    // Moves an ordering built before library changes over to the changed catalog
+    // without sorting it again: removed songs drop out, and the songs flagged in changed,
+    // by ID, are sorted on their own and merged in, so the cost is one pass over the
+    // list plus sorting the changes
+    static std::shared_ptr<const SongOrdering> SpliceOrdering(
+        const SongCatalog &catalog,
+        SortType sortType,
+        const SongOrdering &shown,
+        const std::vector<char> &changed
+    );
+
+    std::shared_ptr<SongSearchState> searchState = std::make_shared<SongSearchState>();
+    std::string searchQuery;
+    // A query is set but the index wasn't ready when the list was last built
+    bool searchPending = false;
+
+    std::shared_ptr<SongSearchIndex> CurrentSearchIndex();
+    void DropSearchIndex();
+    // DropSearchIndex(), then indexes the songs in snapshot on a worker
+    void RebuildSearchIndex(const std::shared_ptr<const SongCatalog> &snapshot);
+
+    // Loads every song folder under the given roots, skipping directories in skipDirs
+    std::vector<SongCatalogEntry> ScanFolders(
+        const std::vector<std::filesystem::path> &songsFolder,
+        const std::unordered_set<std::string_view> &skipDirs
+    );
+
+    // Normalized song roots from the last load or scan, each with its own cache shard
+    std::vector<std::filesystem::path> songRoots;
+    // Roots that couldn't be read. Their songs aren't listed, but their shards are kept
+    // for when they come back.
+    std::vector<char> rootOffline;
+
+    void SetRoots(const std::vector<std::filesystem::path> &songsFolder);
+    // Index into songRoots of the root a song folder sits in, or -1
+    [[nodiscard]]
+    int RootIndexFor(const std::filesystem::path &songDir) const;
+    // Rewrites the shards of the roots flagged in dirty, which is indexed like songRoots
+    void WriteShards(const std::vector<char> &dirty);
+
+    std::shared_ptr<ShardCompactionState> compaction =
+        std::make_shared<ShardCompactionState>();
+    // Folds every journal that has grown too big back into its shard, on a worker
+    void CompactShards();
+    // Blocks until no compaction is running
+    void WaitForCompaction();
+
+    std::unique_ptr<Song> runtimeSong;
+    // Rebuilds runtimeSong from the catalog, keeping already uploaded album art if the
+    // song still points at the same image
+    void LoadRuntimeSong(int id);
 
 public:
     SongList();
@@ -77,28 +202,77 @@ public:
     int CurrentSong = 0;
     int SongSelectOffset = 0;
     std::vector<ListMenuEntry> listMenuEntries;
-    std::vector<Song> songs;
+    SongCatalog catalog;
     int songCount = 0;
     int directoryCount = 0;
     int badSongCount = 0;
+    // The selected song, fully loaded. Only this one song is ever built into a Song.
     Song *curSong = nullptr;
+    int curSongID = -1;
 
     void Clear();
 
-    // for when you dont have a song selected
+    // Makes the song with this ID the selected one, loading its info file, stems and
+    // chart summary. Returns curSong, or nullptr if the ID is out of range.
+    Song *SelectSong(int id);
+
+    // Switches listMenuEntries to the given order. catalog itself is never reordered,
+    // so song IDs stay valid.
     void sortList(SortType sortType);
 
-    // for when you have a song selected and want to keep that position in song list
+    // Same as above; selectedSong is a song ID and is kept as long as it's valid
     void sortList(SortType sortType, int &selectedSong);
 
+    // Builds the ordering for sortType from scratch, without touching any cache
+    static std::shared_ptr<const SongOrdering>
+    BuildOrdering(const SongCatalog &catalog, SortType sortType);
+
+    // Blocks until the background sort and search builds for the current songs are
+    // done. The game never needs this; it's for tools timing one load after another.
+    void WaitForBackgroundWork();
+
+    // Rewrites the shard of every reachable root
     void WriteCache();
 
     void ScanSongs(const std::vector<std::filesystem::path> &songsFolder);
 
-    std::vector<ListMenuEntry>
-    GenerateSongEntriesWithHeaders(const std::vector<Song> &songs, SortType sortType);
-
     void LoadCache(const std::vector<std::filesystem::path> &songsFolder);
+
+    // Filters listMenuEntries to songs matching every word of the query; an empty
+    // query shows everything again
+    void SetSearchQuery(const std::string &query);
+    [[nodiscard]]
+    const std::string &SearchQuery() const { return searchQuery; }
+    // Applies a pending query once the index has finished building. Call from the
+    // render thread; returns true if the list changed.
+    bool UpdateSearch();
+
+    // Reads a song's info file and finds its stems, art and MIDI. songInfoPath and ini
+    // have to be set already. Safe to call from worker threads.
+    static void LoadSongFiles(const SongFolderSnapshot &folder, Song &song);
+
+    // Parses one song folder (info.json, falling back to song.ini), looking files up in
+    // the given listing. Safe to call from worker threads.
+    static bool LoadSongFolder(const SongFolderSnapshot &folder, SongCatalogEntry &entry);
+
+    // Starts picking up songs added, removed or edited while the game is running, in the
+    // roots the last LoadCache() or ScanSongs() used
+    void StartWatching();
+    void StopWatching();
+
+    // Applies changes found by the watcher to catalog (new songs get new IDs, edited ones
+    // keep theirs, removed ones leave theirs empty), re-sorts the list and journals the
+    // changes to the cache. Call from the render thread; returns true if the list
+    // changed. If the selected song was deleted, its nearest neighbour in the list is
+    // selected instead and selectionMoved is set. editedSongs gets the IDs whose text
+    // changed.
+    bool ApplyLibraryChanges(bool &selectionMoved, std::vector<int> &editedSongs);
+
+    // Stores and journals curSong's chartSummary after it was just updated, so the
+    // next launch doesn't have to read its MIDI again
+    void SaveChartSummary(const Song &song);
+    // Same for any number of songs at once, by song ID
+    void SaveChartSummaries(const std::vector<std::pair<int, ChartSummary> > &summaries);
 };
 
 extern SongList TheSongList;
\ No newline at end of file
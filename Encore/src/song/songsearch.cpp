@@ -0,0 +1,228 @@
+#include "songsearch.h"
+
+#include <algorithm>
+#include <iterator>
+#include "songcatalog.h"
+#include "util/collation.h"
+
+// Fields are joined with this, and no key may span it
+constexpr char FIELD_SEPARATOR = '\n';
+
+static bool IsWordByte(unsigned char c) {
+    return c >= 0x80 || (c >= '0' && c <= '9') || (c >= 'a' && c <= 'z');
+}
+
+// Top byte tells trigrams and the two kinds of word prefix apart
+static uint32_t TrigramKey(const char *text) {
+    return 3u << 24 | (uint8_t)text[0] << 16 | (uint8_t)text[1] << 8 | (uint8_t)text[2];
+}
+
+static uint32_t PrefixKey(std::string_view prefix) {
+    if (prefix.size() == 1) {
+        return 1u << 24 | (uint8_t)prefix[0];
+    }
+    return 2u << 24 | (uint8_t)prefix[0] << 8 | (uint8_t)prefix[1];
+}
+
+std::string SongSearchIndex::MakeDocument(const SongCatalog &catalog, int id) {
+    std::string document = Encore::MakeSortKey(catalog.Get(id, SongCatalog::Title), false);
+    for (auto field : { SongCatalog::Artist, SongCatalog::Album, SongCatalog::Source }) {
+        document += FIELD_SEPARATOR;
+        document += Encore::MakeSortKey(catalog.Get(id, field), false);
+    }
+    // Stored one per line
+    std::string_view charters = catalog.Get(id, SongCatalog::Charters);
+    while (!charters.empty()) {
+        size_t end = charters.find('\n');
+        document += FIELD_SEPARATOR;
+        document += Encore::MakeSortKey(charters.substr(0, end), false);
+        charters = end == std::string_view::npos ? std::string_view() : charters.substr(end + 1);
+    }
+    return document;
+}
+
+std::vector<uint32_t> SongSearchIndex::KeysFor(std::string_view document) {
+    std::vector<uint32_t> keys;
+    for (size_t i = 0; i + 3 <= document.size(); i++) {
+        if (document.substr(i, 3).find(FIELD_SEPARATOR) == std::string_view::npos) {
+            keys.push_back(TrigramKey(document.data() + i));
+        }
+    }
+    for (size_t i = 0; i < document.size(); i++) {
+        bool wordStart = IsWordByte(document[i]) && (i == 0 || !IsWordByte(document[i - 1]));
+        if (!wordStart) {
+            continue;
+        }
+        keys.push_back(PrefixKey(document.substr(i, 1)));
+        if (i + 1 < document.size() && IsWordByte(document[i + 1])) {
+            keys.push_back(PrefixKey(document.substr(i, 2)));
+        }
+    }
+    std::sort(keys.begin(), keys.end());
+    keys.erase(std::unique(keys.begin(), keys.end()), keys.end());
+    return keys;
+}
+
+void SongSearchIndex::Build(std::vector<std::string> songDocuments) {
+    text.clear();
+    documents.clear();
+    postings.clear();
+    size_t total = 0;
+    for (const auto &document : songDocuments) {
+        total += document.size();
+    }
+    text.reserve(total);
+    documents.reserve(songDocuments.size());
+    // IDs go in ascending order, so every postings list stays sorted by appending
+    for (int id = 0; id < (int)songDocuments.size(); id++) {
+        documents.emplace_back((uint32_t)text.size(), (uint32_t)songDocuments[id].size());
+        text += songDocuments[id];
+        for (uint32_t key : KeysFor(songDocuments[id])) {
+            postings[key].push_back(id);
+        }
+    }
+}
+
+void SongSearchIndex::Update(std::vector<std::pair<int, std::string> > songDocuments) {
+    // Only the last text given for a song counts; the sort is stable, so that's the
+    // last of each run of one ID
+    std::stable_sort(songDocuments.begin(), songDocuments.end(), [](const auto &a, const auto &b) {
+        return a.first < b.first;
+    });
+    // IDs each postings list loses and gains, so a list is rewritten once however many
+    // of its songs changed. IDs go in ascending, so both stay sorted.
+    std::unordered_map<uint32_t, std::pair<std::vector<int>, std::vector<int> > > edits;
+    for (size_t i = 0; i < songDocuments.size(); i++) {
+        auto &[id, document] = songDocuments[i];
+        if (i + 1 < songDocuments.size() && songDocuments[i + 1].first == id) {
+            continue;
+        }
+        if (id < (int)documents.size()) {
+            for (uint32_t key : KeysFor(Document(id))) {
+                edits[key].first.push_back(id);
+            }
+        } else {
+            documents.resize(id + 1, { 0, 0 });
+        }
+        documents[id] = { (uint32_t)text.size(), (uint32_t)document.size() };
+        text += document;
+        for (uint32_t key : KeysFor(document)) {
+            edits[key].second.push_back(id);
+        }
+    }
+
+    for (auto &[key, edit] : edits) {
+        const auto &[removed, added] = edit;
+        std::vector<int> &list = postings[key];
+        std::vector<int> kept;
+        kept.reserve(list.size());
+        std::set_difference(
+            list.begin(), list.end(), removed.begin(), removed.end(), std::back_inserter(kept)
+        );
+        list.clear();
+        std::set_union(
+            kept.begin(), kept.end(), added.begin(), added.end(), std::back_inserter(list)
+        );
+    }
+}
+
+// Postings lists for a term: every trigram, or its word prefix for short terms. Empty
+// if some key never occurs, since then nothing can match.
+std::vector<const std::vector<int> *> SongSearchIndex::ListsFor(std::string_view term
+) const {
+    std::vector<const std::vector<int> *> lists;
+    if (term.size() < 3) {
+        auto list = postings.find(PrefixKey(term));
+        if (list != postings.end()) {
+            lists.push_back(&list->second);
+        }
+        return lists;
+    }
+    for (size_t i = 0; i + 3 <= term.size(); i++) {
+        auto list = postings.find(TrigramKey(term.data() + i));
+        if (list == postings.end()) {
+            return {};
+        }
+        lists.push_back(&list->second);
+    }
+    std::sort(lists.begin(), lists.end(), [](auto *a, auto *b) { return a->size() < b->size(); });
+    lists.erase(std::unique(lists.begin(), lists.end()), lists.end());
+    return lists;
+}
+
+std::vector<int> SongSearchIndex::Query(std::string_view query) const {
+    std::string normalized = Encore::MakeSortKey(query, false);
+    struct Term {
+        std::string_view text;
+        std::vector<const std::vector<int> *> lists;
+    };
+    std::vector<Term> terms;
+    size_t start = 0;
+    while (start < normalized.size()) {
+        size_t end = normalized.find(' ', start);
+        if (end == std::string::npos) {
+            end = normalized.size();
+        }
+        std::string_view text = std::string_view(normalized).substr(start, end - start);
+        start = end + 1;
+        if (text.empty()) {
+            continue;
+        }
+        Term term { text, ListsFor(text) };
+        if (term.lists.empty()) {
+            return {};
+        }
+        terms.push_back(std::move(term));
+    }
+    if (terms.empty()) {
+        return {};
+    }
+
+    // Most selective term first, so every later step works on a short list
+    std::sort(terms.begin(), terms.end(), [](const Term &a, const Term &b) {
+        return a.lists[0]->size() < b.lists[0]->size();
+    });
+
+    std::vector<int> result;
+    std::vector<int> scratch;
+    bool first = true;
+    for (const Term &term : terms) {
+        for (const std::vector<int> *list : term.lists) {
+            if (first) {
+                result = *list;
+                first = false;
+                continue;
+            }
+            bool verified = term.text.size() > 3;
+            if (list->size() > result.size() * 8 && verified) {
+                // Filtering by a common trigram costs more than the substring check
+                // it would save
+                continue;
+            }
+            if (list->size() > result.size() * 8) {
+                // Much longer list: look each survivor up instead of walking it all
+                std::erase_if(result, [&](int id) {
+                    return !std::binary_search(list->begin(), list->end(), id);
+                });
+            } else {
+                scratch.clear();
+                std::set_intersection(
+                    result.begin(), result.end(), list->begin(), list->end(),
+                    std::back_inserter(scratch)
+                );
+                result.swap(scratch);
+            }
+            if (result.empty()) {
+                return result;
+            }
+        }
+        // Sharing every trigram doesn't mean they're in a row; one trigram or a word
+        // prefix is exact already
+        if (term.text.size() > 3) {
+            std::erase_if(result, [&](int id) {
+                return Document(id).find(term.text) == std::string_view::npos;
+            });
+        }
+    }
+    return result;
+}
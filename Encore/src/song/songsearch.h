@@ -0,0 +1,52 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+class SongCatalog;
+
+/// Full-text index over title, artist, album, source and charters, keyed by song ID
+/// (index into SongList::catalog).
+///
+/// Text is normalized with Encore::MakeSortKey. Terms of three or more bytes match
+/// anywhere: the postings of all their trigrams are intersected, rarest first, and the
+/// survivors checked with a substring search. Shorter terms match the start of a word through a
+/// word-prefix index, since "a" matching anywhere would return the whole library.
+/// Every term in a query has to match.
+class SongSearchIndex {
+    // Every document back to back, so verifying candidates stays cache-friendly.
+    // Update() appends the new text and leaves the old bytes until the next Build().
+    std::string text;
+    std::vector<std::pair<uint32_t, uint32_t> > documents; // offset, length by song ID
+
+    std::string_view Document(int id) const {
+        return std::string_view(text).substr(documents[id].first, documents[id].second);
+    }
+    // trigram or word-prefix key -> sorted song IDs
+    std::unordered_map<uint32_t, std::vector<int> > postings;
+
+    static std::vector<uint32_t> KeysFor(std::string_view document);
+    std::vector<const std::vector<int> *> ListsFor(std::string_view term) const;
+
+public:
+    /// Normalized, searchable text for a song.
+    static std::string MakeDocument(const SongCatalog &catalog, int id);
+
+    /// Replaces the index with the given documents, where documents[id] is song id.
+    void Build(std::vector<std::string> songDocuments);
+
+    /// Adds new songs or replaces the text of existing ones, as song ID and document
+    /// pairs; the last pair for an ID wins. An empty document takes a removed song out of
+    /// every result. Each postings list touched is rewritten once for the whole batch.
+    void Update(std::vector<std::pair<int, std::string> > songDocuments);
+
+    [[nodiscard]]
+    size_t size() const { return documents.size(); }
+
+    /// Sorted IDs of every song matching all terms in the query.
+    [[nodiscard]]
+    std::vector<int> Query(std::string_view query) const;
+};
@@ -0,0 +1,142 @@
+#include "collation.h"
+
+namespace {
+    // Base letters for U+00C0..U+00FF; empty entries are left alone (× and ÷)
+    const char *const LATIN1_FOLD[64] = {
+        "a", "a", "a", "a", "a", "a", "ae", "c", "e", "e", "e", "e", "i", "i", "i", "i",
+        "d", "n", "o", "o", "o", "o", "o", "",  "o", "u", "u", "u", "u", "y", "th", "ss",
+        "a", "a", "a", "a", "a", "a", "ae", "c", "e", "e", "e", "e", "i", "i", "i", "i",
+        "d", "n", "o", "o", "o", "o", "o", "",  "o", "u", "u", "u", "u", "y", "th", "y"
+    };
+
+    // Base letters for U+0100..U+017F (Latin Extended-A)
+    constexpr std::string_view LATIN_EXT_A_FOLD =
+        "aaaaaaccccccccdd"
+        "ddeeeeeeeeeegggg"
+        "gggghhhhiiiiiiii"
+        "iiiijjkkklllllll"
+        "lllnnnnnnnnnoooo"
+        "oooorrrrrrssssss"
+        "ssttttttuuuuuuuu"
+        "uuuuwwyyyzzzzzzs";
+
+    // Decodes one code point, advancing pos. Returns false for a malformed byte, which
+    // is consumed on its own so it still sorts deterministically.
+    bool DecodeUtf8(std::string_view text, size_t &pos, char32_t &cp) {
+        unsigned char lead = text[pos];
+        int length = lead < 0x80 ? 1 : (lead >> 5) == 0x6 ? 2 : (lead >> 4) == 0xE ? 3 : (lead >> 3) == 0x1E ? 4 : 0;
+        cp = lead;
+        if (length == 1) {
+            pos++;
+            return true;
+        }
+        if (length == 0 || pos + length > text.size()) {
+            pos++;
+            return false;
+        }
+        char32_t decoded = lead & (0x7F >> length);
+        for (int i = 1; i < length; i++) {
+            unsigned char next = text[pos + i];
+            if ((next & 0xC0) != 0x80) {
+                pos++;
+                return false;
+            }
+            decoded = (decoded << 6) | (next & 0x3F);
+        }
+        pos += length;
+        cp = decoded;
+        return true;
+    }
+
+    void EncodeUtf8(char32_t cp, std::string &out) {
+        if (cp < 0x80) {
+            out += (char)cp;
+        } else if (cp < 0x800) {
+            out += (char)(0xC0 | (cp >> 6));
+            out += (char)(0x80 | (cp & 0x3F));
+        } else if (cp < 0x10000) {
+            out += (char)(0xE0 | (cp >> 12));
+            out += (char)(0x80 | ((cp >> 6) & 0x3F));
+            out += (char)(0x80 | (cp & 0x3F));
+        } else {
+            out += (char)(0xF0 | (cp >> 18));
+            out += (char)(0x80 | ((cp >> 12) & 0x3F));
+            out += (char)(0x80 | ((cp >> 6) & 0x3F));
+            out += (char)(0x80 | (cp & 0x3F));
+        }
+    }
+
+    void AppendFolded(char32_t cp, std::string &out) {
+        if (cp >= 0xFF01 && cp <= 0xFF5E) { // fullwidth ASCII
+            cp -= 0xFEE0;
+        }
+        if (cp < 0x80) {
+            out += (char)(cp >= 'A' && cp <= 'Z' ? cp + 32 : cp);
+        } else if (cp >= 0xC0 && cp <= 0xFF && *LATIN1_FOLD[cp - 0xC0]) {
+            out += LATIN1_FOLD[cp - 0xC0];
+        } else if (cp >= 0x100 && cp <= 0x17F) {
+            out += LATIN_EXT_A_FOLD[cp - 0x100];
+        } else if ((cp >= 0x391 && cp <= 0x3A9 && cp != 0x3A2) || (cp >= 0x410 && cp <= 0x42F)) {
+            EncodeUtf8(cp + 0x20, out); // Greek and Cyrillic capitals
+        } else if (cp >= 0x400 && cp <= 0x40F) {
+            EncodeUtf8(cp + 0x50, out);
+        } else {
+            EncodeUtf8(cp, out);
+        }
+    }
+}
+
+std::string Encore::MakeSortKey(std::string_view text, bool stripArticle) {
+    std::string key;
+    key.reserve(text.size());
+    for (size_t pos = 0; pos < text.size();) {
+        char32_t cp;
+        if (DecodeUtf8(text, pos, cp)) {
+            AppendFolded(cp, key);
+        } else {
+            key += (char)cp;
+        }
+    }
+
+    size_t start = key.find_first_not_of(' ');
+    if (start == std::string::npos) {
+        return "";
+    }
+    if (stripArticle) {
+        for (std::string_view article : { "the ", "an ", "a " }) {
+            if (key.compare(start, article.size(), article) == 0) {
+                start += article.size();
+                break;
+            }
+        }
+    }
+    key.erase(0, start);
+    return key;
+}
+
+std::string Encore::SortKeyHeader(std::string_view key) {
+    if (key.empty()) {
+        return "#";
+    }
+    unsigned char lead = key[0];
+    if (lead >= 'a' && lead <= 'z') {
+        return std::string(1, (char)(lead - 32));
+    }
+    if (lead < 0x80) {
+        return std::string(1, (char)lead);
+    }
+    size_t pos = 0;
+    char32_t cp;
+    if (!DecodeUtf8(key, pos, cp)) {
+        return "#";
+    }
+    // Keys are folded to lowercase, headers read better in capitals
+    if ((cp >= 0x3B1 && cp <= 0x3C9 && cp != 0x3C2) || (cp >= 0x430 && cp <= 0x44F)) {
+        cp -= 0x20;
+    } else if (cp >= 0x450 && cp <= 0x45F) {
+        cp -= 0x50;
+    }
+    std::string header;
+    EncodeUtf8(cp, header);
+    return header;
+}
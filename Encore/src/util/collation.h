@@ -0,0 +1,16 @@
+#pragma once
+
+#include <string>
+#include <string_view>
+
+namespace Encore {
+    /// Normalizes text for sorting: case-folded, common Latin diacritics removed,
+    /// fullwidth ASCII narrowed, and optionally a leading "a", "an" or "the" dropped.
+    /// The result is UTF-8, so comparing keys byte-wise gives a stable, locale-free
+    /// order.
+    std::string MakeSortKey(std::string_view text, bool stripArticle);
+
+    /// First character of a sort key as a list header, uppercased if it's a Latin
+    /// letter, or "#" for an empty key. Never splits a multi-byte character.
+    std::string SortKeyHeader(std::string_view key);
+}
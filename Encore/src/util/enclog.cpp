@@ -8,24 +8,42 @@
 #include <iomanip>
 #include <iostream>
 #include <sstream>
+#include <string>
+#include <cstdio>
 #include <cstring>
+#include <ctime>
+
+// std::localtime shares one buffer between threads, and the song scan logs from a pool
+static std::tm LocalTime() {
+    std::time_t t = std::time(nullptr);
+    std::tm tm {};
+#ifdef _WIN32
+    localtime_s(&tm, &t);
+#else
+    localtime_r(&t, &tm);
+#endif
+    return tm;
+}
 
 void Encore::EncoreLog(int msgType, const char *text, va_list args) {
     std::ostringstream outputString;
 
-    auto t = std::time(nullptr);
-    auto tm = *std::localtime(&t);
+    auto tm = LocalTime();
     outputString << "[";
     outputString << std::put_time(&tm, "%H:%M:%S");
     outputString << "] ";
 
     outputString << "[Encore:";
 
-    char buffer[256] = { 0 };
-    char outputbuf[256] = { 0 };
-    unsigned int textSize = (unsigned int)strlen(text);
-    memcpy(buffer + strlen(buffer), text, (textSize < (256 - 12))? textSize : (256 - 12));
-    vsprintf(outputbuf, buffer, args);
+    // Sized by a first pass, so long paths in a message aren't cut off
+    va_list sizeArgs;
+    va_copy(sizeArgs, args);
+    int length = vsnprintf(nullptr, 0, text, sizeArgs);
+    va_end(sizeArgs);
+    std::string outputbuf(length > 0 ? (size_t)length : 0, '\0');
+    if (length > 0) {
+        vsnprintf(outputbuf.data(), outputbuf.size() + 1, text, args);
+    }
 
     switch (msgType)
     {
@@ -50,12 +68,18 @@ void Encore::EncoreLog(int msgType, const char *text, va_list args) {
 
 }
 
+void Encore::EncoreLogFormat(int msgType, const char *format, ...) {
+    va_list args;
+    va_start(args, format);
+    EncoreLog(msgType, format, args);
+    va_end(args);
+}
+
 void Encore::EncoreLog(int msgType, const char *text)
 {
     std::ostringstream outputString;
 
-    auto t = std::time(nullptr);
-    auto tm = *std::localtime(&t);
+    auto tm = LocalTime();
     outputString << "[";
     outputString << std::put_time(&tm, "%H:%M:%S");
     outputString << "] ";
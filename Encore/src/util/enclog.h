@@ -9,6 +9,12 @@
 namespace Encore {
     void EncoreLog(int msgType, const char *text, va_list args);
     void EncoreLog(int msgType, const char *text);
+    // printf-style, formatting into its own buffer rather than TextFormat's shared one,
+    // so it can be called from any thread
+#if defined(__GNUC__)
+    __attribute__((format(printf, 2, 3)))
+#endif
+    void EncoreLogFormat(int msgType, const char *format, ...);
 }
 
 #endif //ENCLOG_H
@@ -0,0 +1,40 @@
+#include "file-stamp.h"
+
+#include <fstream>
+#include <iterator>
+#include <sys/stat.h>
+#include "picosha2.h"
+
+bool Encore::GetFileStamp(const std::filesystem::path &path, FileStamp &stamp) {
+#ifdef _WIN32
+    struct _stat64 info;
+    if (_wstat64(path.c_str(), &info) != 0) {
+        return false;
+    }
+    stamp.modified = (int64_t)info.st_mtime * 1000000000;
+#else
+    struct stat info;
+    if (stat(path.c_str(), &info) != 0) {
+        return false;
+    }
+#ifdef __APPLE__
+    stamp.modified =
+        (int64_t)info.st_mtimespec.tv_sec * 1000000000 + info.st_mtimespec.tv_nsec;
+#else
+    stamp.modified = (int64_t)info.st_mtim.tv_sec * 1000000000 + info.st_mtim.tv_nsec;
+#endif
+#endif
+    stamp.size = (uint64_t)info.st_size;
+    return true;
+}
+
+std::string Encore::HashFile(const std::filesystem::path &path) {
+    std::ifstream file(path, std::ios::binary);
+    if (!file) {
+        return "";
+    }
+    std::string contents(
+        (std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>()
+    );
+    return picosha2::hash256_hex_string(contents);
+}
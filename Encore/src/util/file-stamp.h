@@ -0,0 +1,23 @@
+#pragma once
+
+#include <cstdint>
+#include <filesystem>
+#include <string>
+
+namespace Encore {
+    /// Size and modification time of a file, used to tell whether a cached file
+    /// changed without reading it.
+    struct FileStamp {
+        uint64_t size = 0;
+        int64_t modified = 0; // nanoseconds since the epoch
+
+        bool operator==(const FileStamp &other) const = default;
+    };
+
+    /// Stats the file with a single system call. Returns false if it doesn't exist.
+    bool GetFileStamp(const std::filesystem::path &path, FileStamp &stamp);
+
+    /// SHA-256 of the whole file as a hex string, or an empty string if it can't be
+    /// read.
+    std::string HashFile(const std::filesystem::path &path);
+}
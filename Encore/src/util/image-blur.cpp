@@ -0,0 +1,361 @@
+#include "image-blur.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <vector>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define ENCORE_BLUR_SSE2 1
+#include <emmintrin.h>
+#endif
+// AVX2 is built alongside SSE2 whatever the build targets, and only run on CPUs that
+// have it (see HasAvx2)
+#if defined(__x86_64__) || defined(_M_X64)
+#define ENCORE_BLUR_AVX2 1
+#include <immintrin.h>
+#if defined(__GNUC__) || defined(__clang__)
+#define ENCORE_TARGET_AVX2 __attribute__((target("avx2")))
+#else
+#define ENCORE_TARGET_AVX2
+#include <intrin.h>
+#endif
+#endif
+#if defined(__aarch64__) || defined(_M_ARM64)
+#define ENCORE_BLUR_NEON 1
+#include <arm_neon.h>
+#endif
+
+/*
+ * Every pass is a vertical box blur over whole rows at once: a running sum per byte of
+ * the row, one row added and one subtracted per output row. That reads memory in order
+ * and is the same operation on every byte, so it vectorizes without shuffles. The
+ * horizontal passes run on a transposed copy. Sums are at most 255 * window, so they
+ * fit in 32 bits; the average is sum * (1 / window) rounded to nearest even, which is
+ * what every path does, so they agree exactly.
+ */
+
+namespace {
+    constexpr int BOX_PASSES = 3;
+
+    // Which SlideXxx/StoreXxx pair BoxBlurRows uses. Baseline is SSE2 or NEON, whichever
+    // the build always has.
+    enum class BlurPath { Scalar, Baseline, Avx2 };
+
+    // Box radii whose repeated convolution best matches a Gaussian of this sigma
+    // (Kutskir, "Fastest Gaussian Blur")
+    void BoxRadiiForSigma(float sigma, int (&radii)[BOX_PASSES]) {
+        float idealWidth = std::sqrt(12.0f * sigma * sigma / BOX_PASSES + 1.0f);
+        int lower = (int)std::floor(idealWidth);
+        if (lower % 2 == 0) {
+            lower--;
+        }
+        lower = std::max(lower, 1);
+        int upper = lower + 2;
+        float idealLower = (12.0f * sigma * sigma - BOX_PASSES * lower * lower
+                            - 4.0f * BOX_PASSES * lower - 3.0f * BOX_PASSES)
+            / (-4.0f * lower - 4.0f);
+        int lowerCount = (int)std::lround(idealLower);
+        for (int i = 0; i < BOX_PASSES; i++) {
+            radii[i] = ((i < lowerCount ? lower : upper) - 1) / 2;
+        }
+    }
+
+    // sums[i] += add[i] - sub[i] for i in [begin, end)
+    void SlideScalar(int32_t *sums, const uint8_t *add, const uint8_t *sub, int begin, int end) {
+        for (int i = begin; i < end; i++) {
+            sums[i] += (int32_t)add[i] - (int32_t)sub[i];
+        }
+    }
+
+    void StoreScalar(uint8_t *out, const int32_t *sums, float scale, int begin, int end) {
+        for (int i = begin; i < end; i++) {
+            out[i] = (uint8_t)std::clamp((int)std::nearbyint((float)sums[i] * scale), 0, 255);
+        }
+    }
+
+#if ENCORE_BLUR_AVX2
+    bool HasAvx2() {
+        static const bool supported = [] {
+#if defined(__GNUC__) || defined(__clang__)
+            return __builtin_cpu_supports("avx2") != 0;
+#else
+            int info[4];
+            __cpuid(info, 0);
+            if (info[0] < 7) {
+                return false;
+            }
+            // The OS also has to save the YMM registers on a context switch
+            __cpuid(info, 1);
+            bool osSavesYmm = (info[2] & (1 << 27)) != 0 && (info[2] & (1 << 28)) != 0
+                && (_xgetbv(0) & 6) == 6;
+            __cpuidex(info, 7, 0);
+            return osSavesYmm && (info[1] & (1 << 5)) != 0;
+#endif
+        }();
+        return supported;
+    }
+
+    ENCORE_TARGET_AVX2
+    int SlideAvx2(int32_t *sums, const uint8_t *add, const uint8_t *sub, int count) {
+        int i = 0;
+        for (; i + 8 <= count; i += 8) {
+            __m256i a = _mm256_cvtepu8_epi32(_mm_loadl_epi64((const __m128i *)(add + i)));
+            __m256i s = _mm256_cvtepu8_epi32(_mm_loadl_epi64((const __m128i *)(sub + i)));
+            __m256i sum = _mm256_loadu_si256((const __m256i *)(sums + i));
+            sum = _mm256_add_epi32(sum, _mm256_sub_epi32(a, s));
+            _mm256_storeu_si256((__m256i *)(sums + i), sum);
+        }
+        return i;
+    }
+
+    ENCORE_TARGET_AVX2
+    int StoreAvx2(uint8_t *out, const int32_t *sums, float scale, int count) {
+        __m256 scales = _mm256_set1_ps(scale);
+        int i = 0;
+        for (; i + 8 <= count; i += 8) {
+            __m256 sum = _mm256_cvtepi32_ps(_mm256_loadu_si256((const __m256i *)(sums + i)));
+            __m256i rounded = _mm256_cvtps_epi32(_mm256_mul_ps(sum, scales));
+            __m128i packed = _mm_packs_epi32(
+                _mm256_castsi256_si128(rounded), _mm256_extracti128_si256(rounded, 1)
+            );
+            _mm_storel_epi64((__m128i *)(out + i), _mm_packus_epi16(packed, packed));
+        }
+        return i;
+    }
+#else
+    bool HasAvx2() { return false; }
+    int SlideAvx2(int32_t *, const uint8_t *, const uint8_t *, int) { return 0; }
+    int StoreAvx2(uint8_t *, const int32_t *, float, int) { return 0; }
+#endif
+
+#if ENCORE_BLUR_SSE2
+    int SlideSimd(int32_t *sums, const uint8_t *add, const uint8_t *sub, int count) {
+        const __m128i zero = _mm_setzero_si128();
+        int i = 0;
+        for (; i + 8 <= count; i += 8) {
+            __m128i a = _mm_unpacklo_epi8(_mm_loadl_epi64((const __m128i *)(add + i)), zero);
+            __m128i s = _mm_unpacklo_epi8(_mm_loadl_epi64((const __m128i *)(sub + i)), zero);
+            // 16-bit difference, sign extended to 32 bits
+            __m128i diff = _mm_sub_epi16(a, s);
+            __m128i sign = _mm_srai_epi16(diff, 15);
+            __m128i lo = _mm_loadu_si128((const __m128i *)(sums + i));
+            __m128i hi = _mm_loadu_si128((const __m128i *)(sums + i + 4));
+            lo = _mm_add_epi32(lo, _mm_unpacklo_epi16(diff, sign));
+            hi = _mm_add_epi32(hi, _mm_unpackhi_epi16(diff, sign));
+            _mm_storeu_si128((__m128i *)(sums + i), lo);
+            _mm_storeu_si128((__m128i *)(sums + i + 4), hi);
+        }
+        return i;
+    }
+
+    int StoreSimd(uint8_t *out, const int32_t *sums, float scale, int count) {
+        __m128 scales = _mm_set1_ps(scale);
+        int i = 0;
+        for (; i + 8 <= count; i += 8) {
+            __m128 lo = _mm_cvtepi32_ps(_mm_loadu_si128((const __m128i *)(sums + i)));
+            __m128 hi = _mm_cvtepi32_ps(_mm_loadu_si128((const __m128i *)(sums + i + 4)));
+            __m128i packed = _mm_packs_epi32(
+                _mm_cvtps_epi32(_mm_mul_ps(lo, scales)), _mm_cvtps_epi32(_mm_mul_ps(hi, scales))
+            );
+            _mm_storel_epi64((__m128i *)(out + i), _mm_packus_epi16(packed, packed));
+        }
+        return i;
+    }
+#elif ENCORE_BLUR_NEON
+    int SlideSimd(int32_t *sums, const uint8_t *add, const uint8_t *sub, int count) {
+        int i = 0;
+        for (; i + 8 <= count; i += 8) {
+            int16x8_t diff = vreinterpretq_s16_u16(vsubl_u8(vld1_u8(add + i), vld1_u8(sub + i)));
+            int32x4_t lo = vaddw_s16(vld1q_s32(sums + i), vget_low_s16(diff));
+            int32x4_t hi = vaddw_s16(vld1q_s32(sums + i + 4), vget_high_s16(diff));
+            vst1q_s32(sums + i, lo);
+            vst1q_s32(sums + i + 4, hi);
+        }
+        return i;
+    }
+
+    int StoreSimd(uint8_t *out, const int32_t *sums, float scale, int count) {
+        float32x4_t scales = vdupq_n_f32(scale);
+        int i = 0;
+        for (; i + 8 <= count; i += 8) {
+            int32x4_t lo = vcvtnq_s32_f32(vmulq_f32(vcvtq_f32_s32(vld1q_s32(sums + i)), scales));
+            int32x4_t hi = vcvtnq_s32_f32(vmulq_f32(vcvtq_f32_s32(vld1q_s32(sums + i + 4)), scales));
+            uint16x8_t packed = vcombine_u16(vqmovun_s32(lo), vqmovun_s32(hi));
+            vst1_u8(out + i, vqmovn_u16(packed));
+        }
+        return i;
+    }
+#else
+    int SlideSimd(int32_t *, const uint8_t *, const uint8_t *, int) { return 0; }
+    int StoreSimd(uint8_t *, const int32_t *, float, int) { return 0; }
+#endif
+
+    // Both return how many leading bytes they did, for the scalar code to finish
+    template <BlurPath Path>
+    int Slide(int32_t *sums, const uint8_t *add, const uint8_t *sub, int count) {
+        if constexpr (Path == BlurPath::Avx2) {
+            return SlideAvx2(sums, add, sub, count);
+        } else if constexpr (Path == BlurPath::Baseline) {
+            return SlideSimd(sums, add, sub, count);
+        }
+        return 0;
+    }
+
+    template <BlurPath Path>
+    int Store(uint8_t *out, const int32_t *sums, float scale, int count) {
+        if constexpr (Path == BlurPath::Avx2) {
+            return StoreAvx2(out, sums, scale, count);
+        } else if constexpr (Path == BlurPath::Baseline) {
+            return StoreSimd(out, sums, scale, count);
+        }
+        return 0;
+    }
+
+    // One vertical box blur of src into dst, both rows x rowBytes
+    template <BlurPath Path>
+    void BoxBlurRows(
+        const uint8_t *src, uint8_t *dst, int rowBytes, int rows, int radius, int32_t *sums
+    ) {
+        auto row = [&](int y) {
+            return src + (size_t)std::clamp(y, 0, rows - 1) * rowBytes;
+        };
+        // The window starts centered on row 0, with the rows above it clamped to row 0
+        for (int i = 0; i < rowBytes; i++) {
+            sums[i] = (int32_t)src[i] * (radius + 1);
+        }
+        for (int y = 1; y <= radius; y++) {
+            const uint8_t *add = row(y);
+            for (int i = 0; i < rowBytes; i++) {
+                sums[i] += add[i];
+            }
+        }
+        float scale = 1.0f / (float)(2 * radius + 1);
+        for (int y = 0; y < rows; y++) {
+            uint8_t *out = dst + (size_t)y * rowBytes;
+            int done = Store<Path>(out, sums, scale, rowBytes);
+            StoreScalar(out, sums, scale, done, rowBytes);
+
+            const uint8_t *add = row(y + radius + 1);
+            const uint8_t *sub = row(y - radius);
+            done = Slide<Path>(sums, add, sub, rowBytes);
+            SlideScalar(sums, add, sub, done, rowBytes);
+        }
+    }
+
+    void Transpose(const uint32_t *src, uint32_t *dst, int width, int height) {
+        // In tiles, so both sides stay in cache
+        constexpr int TILE = 32;
+        for (int y0 = 0; y0 < height; y0 += TILE) {
+            for (int x0 = 0; x0 < width; x0 += TILE) {
+                int yEnd = std::min(y0 + TILE, height);
+                int xEnd = std::min(x0 + TILE, width);
+                for (int y = y0; y < yEnd; y++) {
+                    for (int x = x0; x < xEnd; x++) {
+                        dst[(size_t)x * height + y] = src[(size_t)y * width + x];
+                    }
+                }
+            }
+        }
+    }
+
+    // Blurring straight alpha would bleed the color of transparent pixels into the
+    // visible ones, so images with any transparency are blurred premultiplied
+    bool Premultiply(uint8_t *pixels, size_t count) {
+        bool opaque = true;
+        for (size_t i = 0; i < count && opaque; i++) {
+            opaque = pixels[i * 4 + 3] == 255;
+        }
+        if (opaque) {
+            return false;
+        }
+        for (size_t i = 0; i < count; i++) {
+            uint8_t *p = pixels + i * 4;
+            for (int c = 0; c < 3; c++) {
+                p[c] = (uint8_t)((p[c] * p[3] + 127) / 255);
+            }
+        }
+        return true;
+    }
+
+    void Unpremultiply(uint8_t *pixels, size_t count) {
+        for (size_t i = 0; i < count; i++) {
+            uint8_t *p = pixels + i * 4;
+            if (p[3] == 0) {
+                continue;
+            }
+            for (int c = 0; c < 3; c++) {
+                p[c] = (uint8_t)std::min(255, (p[c] * 255 + p[3] / 2) / p[3]);
+            }
+        }
+    }
+
+    template <BlurPath Path>
+    void Blur(uint8_t *pixels, int width, int height, float sigma) {
+        if (pixels == nullptr || width <= 0 || height <= 0 || sigma <= 0.0f) {
+            return;
+        }
+        int radii[BOX_PASSES];
+        BoxRadiiForSigma(sigma, radii);
+        size_t count = (size_t)width * height;
+        bool premultiplied = Premultiply(pixels, count);
+
+        std::vector<uint8_t> scratch(count * 4);
+        std::vector<int32_t> sums((size_t)std::max(width, height) * 4);
+        uint8_t *a = pixels;
+        uint8_t *b = scratch.data();
+
+        // Vertical passes, ending in scratch after an odd number of them
+        for (int radius : radii) {
+            BoxBlurRows<Path>(a, b, width * 4, height, radius, sums.data());
+            std::swap(a, b);
+        }
+        // Transposed, so rows of b are the image's columns
+        Transpose((const uint32_t *)a, (uint32_t *)b, width, height);
+        std::swap(a, b);
+        for (int radius : radii) {
+            BoxBlurRows<Path>(a, b, height * 4, width, radius, sums.data());
+            std::swap(a, b);
+        }
+        Transpose((const uint32_t *)a, (uint32_t *)b, height, width);
+        if (b != pixels) {
+            std::memcpy(pixels, b, count * 4);
+        }
+
+        if (premultiplied) {
+            Unpremultiply(pixels, count);
+        }
+    }
+}
+
+float Encore::GaussianSigmaForBlurSize(int blurSize) {
+    // raylib runs four box blurs of width 2 * blurSize + 1 per axis, and the variance
+    // of a box of width w is (w^2 - 1) / 12
+    float width = 2.0f * blurSize + 1.0f;
+    return std::sqrt(4.0f * (width * width - 1.0f) / 12.0f);
+}
+
+void Encore::BlurRGBA8(uint8_t *pixels, int width, int height, float sigma) {
+    if (HasAvx2()) {
+        Blur<BlurPath::Avx2>(pixels, width, height, sigma);
+    } else {
+        Blur<BlurPath::Baseline>(pixels, width, height, sigma);
+    }
+}
+
+void Encore::BlurRGBA8Scalar(uint8_t *pixels, int width, int height, float sigma) {
+    Blur<BlurPath::Scalar>(pixels, width, height, sigma);
+}
+
+const char *Encore::BlurRGBA8Path() {
+    if (HasAvx2()) {
+        return "AVX2";
+    }
+#if ENCORE_BLUR_SSE2
+    return "SSE2";
+#elif ENCORE_BLUR_NEON
+    return "NEON";
+#else
+    return "scalar";
+#endif
+}
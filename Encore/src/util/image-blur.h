@@ -0,0 +1,22 @@
+#pragma once
+
+#include <cstdint>
+
+namespace Encore {
+    /// Sigma of the Gaussian raylib's ImageBlurGaussian(image, blurSize) approximates,
+    /// so BlurRGBA8 can stand in for it.
+    float GaussianSigmaForBlurSize(int blurSize);
+
+    /// Blurs tightly packed 8-bit RGBA pixels in place with three box blurs per axis,
+    /// which together approximate a Gaussian of the given sigma. Edges are clamped.
+    /// Uses AVX2 on x86-64 CPUs that have it and SSE2 on the rest, or NEON, with a
+    /// scalar fallback that gives the same result.
+    void BlurRGBA8(uint8_t *pixels, int width, int height, float sigma);
+
+    /// The instruction set BlurRGBA8 uses on this machine: "AVX2", "SSE2", "NEON" or
+    /// "scalar".
+    const char *BlurRGBA8Path();
+
+    /// The scalar path on its own, for checking the SIMD ones against.
+    void BlurRGBA8Scalar(uint8_t *pixels, int width, int height, float sigma);
+}
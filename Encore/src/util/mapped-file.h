@@ -0,0 +1,38 @@
+#pragma once
+
+#include <cstddef>
+#include <filesystem>
+
+namespace Encore {
+    /// Read-only memory mapping of a whole file. The mapping is released when the
+    /// object is destroyed or Close() is called.
+    class MappedFile {
+        const unsigned char *mData = nullptr;
+        size_t mSize = 0;
+#ifdef _WIN32
+        void *mFile = nullptr;
+        void *mMapping = nullptr;
+#endif
+
+    public:
+        MappedFile() = default;
+        ~MappedFile();
+
+        MappedFile(const MappedFile &) = delete;
+        MappedFile &operator=(const MappedFile &) = delete;
+        MappedFile(MappedFile &&other) noexcept;
+        MappedFile &operator=(MappedFile &&other) noexcept;
+
+        /// Maps the file, closing any previous mapping first. Returns false if the file
+        /// can't be opened or is empty.
+        bool Open(const std::filesystem::path &path);
+        void Close();
+
+        [[nodiscard]]
+        bool IsOpen() const { return mData != nullptr; }
+        [[nodiscard]]
+        const unsigned char *data() const { return mData; }
+        [[nodiscard]]
+        size_t size() const { return mSize; }
+    };
+}
@@ -0,0 +1,64 @@
+#pragma once
+
+#include <algorithm>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <optional>
+#include <thread>
+
+namespace Encore {
+
+    /// Number of worker threads to use for library-wide jobs. Song folders mostly wait
+    /// on disk (or the network), so this deliberately oversubscribes small machines.
+    inline unsigned int LibraryWorkerCount() {
+        unsigned int hardware = std::thread::hardware_concurrency();
+        return std::clamp(hardware, 4u, 16u);
+    }
+
+    /// Multi-producer, multi-consumer FIFO. Consumers block in Pop() until an item is
+    /// available or the queue is closed and drained.
+    template <typename T>
+    class WorkQueue {
+        std::deque<T> items;
+        std::mutex mutex;
+        std::condition_variable available;
+        bool closed = false;
+
+    public:
+        void Push(T item) {
+            {
+                std::lock_guard lock(mutex);
+                items.push_back(std::move(item));
+            }
+            available.notify_one();
+        }
+
+        /// No more items will be pushed; wakes every waiting consumer.
+        void Close() {
+            {
+                std::lock_guard lock(mutex);
+                closed = true;
+            }
+            available.notify_all();
+        }
+
+        /// Drops every queued item without closing the queue.
+        void Clear() {
+            std::lock_guard lock(mutex);
+            items.clear();
+        }
+
+        /// Returns std::nullopt once the queue is closed and empty.
+        std::optional<T> Pop() {
+            std::unique_lock lock(mutex);
+            available.wait(lock, [this] { return closed || !items.empty(); });
+            if (items.empty()) {
+                return std::nullopt;
+            }
+            T item = std::move(items.front());
+            items.pop_front();
+            return item;
+        }
+    };
+}